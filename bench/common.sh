@@ -0,0 +1,41 @@
+# Sourced by the benchmark scripts. Moves to the top of the repository and
+# sets BUILD, where build() puts its builds, and WORK, a scratch directory
+# removed on exit.
+
+cd "$(dirname "${BASH_SOURCE[0]}")/.."
+BUILD=bench/build
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+# Builds the tool and the library with optimizations into $BUILD/<name>,
+# passing the remaining arguments to make.
+build() {
+  local name=$1
+  shift
+  mkdir -p "$BUILD/$name/obj" "$BUILD/$name/bin"
+  make -s OBJ_DIR="$BUILD/$name/obj" BIN_DIR="$BUILD/$name/bin" \
+    OPT=-O2 "$@" >/dev/null
+}
+
+# The number of VM instructions dispatched running the count build, made
+# with build count COUNT_DISPATCH=1, with the given arguments.
+dispatched() {
+  "$BUILD/count/bin/dsl.out" "$@" 2>&1 >/dev/null |
+    awk '/^dispatched/ { print $2 }'
+}
+
+# The best wall time of $RUNS runs of a command, in microseconds.
+best_time() {
+  local best=
+  for ((run = 0; run < RUNS; run++)); do
+    local start end
+    start=$(date +%s%N)
+    "$@" >/dev/null 2>&1
+    end=$(date +%s%N)
+    local elapsed=$(((end - start) / 1000))
+    if [[ -z $best || $elapsed -lt $best ]]; then
+      best=$elapsed
+    fi
+  done
+  echo "$best"
+}
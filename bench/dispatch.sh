@@ -0,0 +1,59 @@
+#!/usr/bin/env bash
+# Compares the threaded and switch dispatch loops of the VM on scaled-up
+# versions of the nested-loop examples.
+#
+# Usage: bench/dispatch.sh [runs]
+#
+# Prints the best wall time of each build, the number of dispatched VM
+# instructions, and, when perf is available, CPU instructions and branch
+# misses per dispatched instruction.
+set -euo pipefail
+
+source "$(dirname "$0")/common.sh"
+RUNS=${1:-5}
+
+build threaded DISPATCH=threaded
+build switch DISPATCH=switch
+build count COUNT_DISPATCH=1
+
+# The prime sieve with a larger limit, and loop_in_loop with the inner
+# counter reset on every outer iteration and the print folded into a sum.
+sed 's/var int limit = 20/var int limit = 5000/' \
+  examples/very_complex_example.dsl >"$WORK/very_complex_example.dsl"
+sed -e 's/< 5/< 1500/g' \
+  -e 's/print x + y/sum = sum + x + y/' \
+  -e 's/^  x = x + 1/  y = 1\n  x = x + 1/' \
+  -e '1i var int sum = 0' \
+  -e 's/^print "Yay!"/print sum/' \
+  examples/loop_in_loop.dsl >"$WORK/loop_in_loop.dsl"
+
+perf_counters() {
+  local binary=$1 script=$2
+  perf stat -x, -e instructions,branch-misses \
+    "$binary" --engine=vm "$script" 2>&1 >/dev/null |
+    awk -F, '/instructions/ { i = $1 } /branch-misses/ { b = $1 }
+             END { print i, b }'
+}
+
+HAVE_PERF=0
+if command -v perf >/dev/null && perf stat true >/dev/null 2>&1; then
+  HAVE_PERF=1
+fi
+
+for script in "$WORK"/*.dsl; do
+  name=$(basename "$script" .dsl)
+  ops=$(dispatched --engine=vm "$script")
+  echo "$name: $ops VM instructions"
+  for mode in threaded switch; do
+    binary="$BUILD/$mode/bin/dsl.out"
+    micros=$(best_time "$binary" --engine=vm "$script")
+    line=$(printf '  %-8s %8d us  %6.2f ns/op' "$mode" "$micros" \
+      "$(awk -v t="$micros" -v n="$ops" 'BEGIN { print t * 1000 / n }')")
+    if ((HAVE_PERF)); then
+      read -r instructions misses < <(perf_counters "$binary" "$script")
+      line+=$(awk -v i="$instructions" -v b="$misses" -v n="$ops" \
+        'BEGIN { printf "  %6.2f insns/op  %6.4f misses/op", i / n, b / n }')
+    fi
+    echo "$line"
+  done
+done
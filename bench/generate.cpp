@@ -0,0 +1,156 @@
+// Writes a script for bench/throughput.sh to stdout, scaled by its size:
+//
+//   straight N    N assignments in a row, run ten times over
+//   nested N      ifs nested N deep, reached 20000 times
+//   loop N        a loop of N iterations doing arithmetic and a branch
+//   expression N  one expression of N terms, computed 50 times
+//   variables N   N variables, each updated from the one before, 20 times
+//
+// Every value depends on the state of an enclosing loop, so the optimizers
+// cannot fold the work away, and stays far from overflowing.
+//
+// Usage: generate straight|nested|loop|expression|variables N
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+namespace {
+
+void indent(std::ostream& out, int level) {
+  out << std::string(2 * level, ' ');
+}
+
+void straight(std::ostream& out, long size) {
+  out << "var int round = 0\n"
+         "var int a = 1\n"
+         "var int b = 2\n"
+         "var int c = 3\n"
+         "var int d = 4\n"
+         "var float f = 0.5\n"
+         "while (round < 10):\n";
+  static const char* const statements[] = {
+      "a = (a + b) / 2 + round", "b = (b + c) / 2 - 1",
+      "c = (c + d) / 2 + 5",     "d = (d + a) / 2 + 1",
+      "f = f * 0.5 + 1.25",
+  };
+  for (long i = 0; i < size; i++) {
+    out << "  " << statements[i % 5] << "\n";
+  }
+  out << "  round = round + 1\n"
+         "print a + b + c + d\n"
+         "print f\n"
+         "run\n";
+}
+
+void nested(std::ostream& out, long size) {
+  out << "var int i = 0\n"
+         "var int hits = 0\n"
+         "while (i < 20000):\n";
+  for (long level = 0; level < size; level++) {
+    indent(out, level + 1);
+    out << "if (i ! " << 20000 + level << "):\n";
+  }
+  indent(out, size + 1);
+  out << "hits = hits + 1\n"
+         "  i = i + 1\n"
+         "print hits\n"
+         "run\n";
+}
+
+void loop(std::ostream& out, long size) {
+  out << "var int i = 0\n"
+         "var int s = 0\n"
+         "var float f = 0.0\n"
+         "while (i < "
+      << size
+      << "):\n"
+         "  s = s + i * 3 / 7\n"
+         "  f = f + 0.5\n"
+         "  if (s > 1000000):\n"
+         "    s = s - 1000000\n"
+         "  i = i + 1\n"
+         "print s\n"
+         "print f\n"
+         "run\n";
+}
+
+// Splits the terms in halves down to short runs, so that no part of the
+// expression is nested more than a few dozen levels deep.
+void terms(std::ostream& out, long first, long count) {
+  static const char* const shapes[] = {"i * 7", "(a + 3) / 2", "i - 4",
+                                       "a * 2 + i", "(i + 5) / 3"};
+  if (count > 4) {
+    out << "(";
+    terms(out, first, count / 2);
+    out << ") + (";
+    terms(out, first + count / 2, count - count / 2);
+    out << ")";
+    return;
+  }
+  for (long i = first; i < first + count; i++) {
+    if (i > first) {
+      out << (i % 2 == 0 ? " + " : " - ");
+    }
+    out << shapes[i % 5];
+  }
+}
+
+void expression(std::ostream& out, long size) {
+  out << "var int i = 0\n"
+         "var int a = 1\n"
+         "var int e = 0\n"
+         "while (i < 50):\n"
+         "  e = ";
+  terms(out, 0, size);
+  out << "\n"
+         "  a = e / 100000 + i\n"
+         "  i = i + 1\n"
+         "print e\n"
+         "run\n";
+}
+
+void variables(std::ostream& out, long size) {
+  for (long i = 0; i < size; i++) {
+    out << "var int v" << i << " = " << i % 100 << "\n";
+  }
+  out << "var int round = 0\n"
+         "while (round < 20):\n"
+         "  v0 = v"
+      << size - 1 << " / 2 + round\n";
+  for (long i = 1; i < size; i++) {
+    out << "  v" << i << " = v" << i - 1 << " / 2 + v" << i << " / 2 + 1\n";
+  }
+  out << "  round = round + 1\n"
+         "print v"
+      << size - 1
+      << "\n"
+         "run\n";
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  long size = argc == 3 ? std::strtol(argv[2], nullptr, 10) : 0;
+  if (size <= 0) {
+    std::cerr << "Usage: generate straight|nested|loop|expression|variables N"
+              << std::endl;
+    return 1;
+  }
+  std::ios::sync_with_stdio(false);
+  if (std::strcmp(argv[1], "straight") == 0) {
+    straight(std::cout, size);
+  } else if (std::strcmp(argv[1], "nested") == 0) {
+    nested(std::cout, size);
+  } else if (std::strcmp(argv[1], "loop") == 0) {
+    loop(std::cout, size);
+  } else if (std::strcmp(argv[1], "expression") == 0) {
+    expression(std::cout, size);
+  } else if (std::strcmp(argv[1], "variables") == 0) {
+    variables(std::cout, size);
+  } else {
+    std::cerr << "Unknown kind of script: " << argv[1] << std::endl;
+    return 1;
+  }
+  return 0;
+}
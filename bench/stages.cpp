@@ -0,0 +1,154 @@
+// Times the stages of running a script one by one, the way the command line
+// tool runs it on the VM: lexing, parsing, compiling (the resolver, type
+// checker and optimizers, the Compiler and the peephole pass) and executing.
+// Every stage runs RUNS times and the fastest run counts. Lexing is timed on
+// its own, and parsing as lexing and parsing together minus that, since the
+// parser pulls its tokens from the lexer as it goes.
+//
+// Prints one JSON object with the times in seconds, the number of tokens
+// lexed and of AST nodes parsed, the peak resident set size in KiB and,
+// given the number of VM instructions the run dispatches, how many of them
+// run per second.
+//
+// Usage: stages [--runs=N] [--ops=N] file.dsl
+#include <sys/resource.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include "compiler.h"
+#include "error.h"
+#include "folder.h"
+#include "lexer.h"
+#include "optimizer.h"
+#include "output.h"
+#include "parser.h"
+#include "peephole.h"
+#include "resolver.h"
+#include "ssa.h"
+#include "typechecker.h"
+#include "vm.h"
+
+namespace {
+
+// The fastest of runs calls of stage, in seconds.
+template <typename Stage>
+double fastest(int runs, Stage stage) {
+  double best = 0;
+  for (int run = 0; run < runs; run++) {
+    auto start = std::chrono::steady_clock::now();
+    stage();
+    double elapsed = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - start)
+                         .count();
+    if (run == 0 || elapsed < best) {
+      best = elapsed;
+    }
+  }
+  return best;
+}
+
+std::unique_ptr<AST> parse(const std::shared_ptr<const Source>& source) {
+  Lexer lexer(source);
+  Parser parser(lexer);
+  return parser.parse();
+}
+
+Chunk compile(AST& ast) {
+  Resolver(ast).resolve();
+  TypeChecker(ast).check();
+  ConstantFolder(ast).fold();
+  SSAOptimizer(ast).optimize();
+  LoopOptimizer(ast).optimize();
+  Chunk chunk = Compiler(ast).compile();
+  Peephole(chunk).optimize();
+  return chunk;
+}
+
+double rate(double count, double seconds) {
+  return seconds > 0 ? count / seconds : 0;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  int runs = 3;
+  double ops = 0;
+  const char* file = nullptr;
+  for (int i = 1; i < argc; i++) {
+    if (std::strncmp(argv[i], "--runs=", 7) == 0) {
+      runs = std::atoi(argv[i] + 7);
+    } else if (std::strncmp(argv[i], "--ops=", 6) == 0) {
+      ops = std::strtod(argv[i] + 6, nullptr);
+    } else {
+      file = argv[i];
+    }
+  }
+  if (file == nullptr || runs <= 0) {
+    std::cerr << "Usage: stages [--runs=N] [--ops=N] file.dsl" << std::endl;
+    return 1;
+  }
+  std::shared_ptr<const Source> source = Source::fromFile(file);
+  if (!source) {
+    std::cerr << "Failed to open file: " << file << std::endl;
+    return 1;
+  }
+
+  try {
+    std::size_t tokens = 0;
+    double lexing = fastest(runs, [&]() {
+      Lexer lexer(source);
+      tokens = 0;
+      while (lexer.getNextToken().getType() != TokenType::TOKEN_EOF) {
+        tokens++;
+      }
+    });
+
+    std::size_t nodes = 0;
+    double parsing = fastest(runs, [&]() { nodes = parse(source)->size(); });
+    parsing = std::max(parsing - lexing, 0.0);
+
+    Chunk chunk;
+    double compiling = 0;
+    for (int run = 0; run < runs; run++) {
+      // The passes change the AST, so each run needs a fresh one.
+      auto ast = parse(source);
+      double elapsed = fastest(1, [&]() { chunk = compile(*ast); });
+      if (run == 0 || elapsed < compiling) {
+        compiling = elapsed;
+      }
+    }
+
+    Output out([](std::string_view) {}, FlushPolicy::Size);
+    double executing = fastest(runs, [&]() {
+      VM vm(out);
+      vm.interpret(chunk);
+      out.flush();
+    });
+
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    std::cout << "{\"bytes\": " << source->getText().size()
+              << ", \"tokens\": " << tokens << ", \"lex_s\": " << lexing
+              << ", \"tokens_per_s\": " << rate(tokens, lexing)
+              << ", \"nodes\": " << nodes << ", \"parse_s\": " << parsing
+              << ", \"nodes_per_s\": " << rate(nodes, parsing)
+              << ", \"compile_s\": " << compiling
+              << ", \"exec_s\": " << executing;
+    if (ops > 0) {
+      std::cout << ", \"ops\": " << static_cast<std::uint64_t>(ops)
+                << ", \"ops_per_s\": " << rate(ops, executing);
+    }
+    std::cout << ", \"peak_rss_kb\": " << usage.ru_maxrss << "}" << std::endl;
+  } catch (const Error& e) {
+    std::cerr << e.asString() << std::endl;
+    return 1;
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}
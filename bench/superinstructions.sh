@@ -0,0 +1,75 @@
+#!/usr/bin/env bash
+# Measures the VM's superinstructions on loops built from the shapes they
+# fuse: conditions comparing a variable with a constant or with another
+# variable, and updates such as `i = i + 1`.
+#
+# Usage: bench/superinstructions.sh [runs]
+#
+# Prints, with and without superinstructions, the number of VM instructions
+# dispatched per loop iteration and the best wall time of an optimized
+# build. The SSA and loop optimizers are turned off, since they would
+# otherwise fold the constants or the loops away.
+set -euo pipefail
+
+source "$(dirname "$0")/common.sh"
+RUNS=${1:-5}
+ITERATIONS=2000000
+
+build threaded DISPATCH=threaded
+build count COUNT_DISPATCH=1
+
+cat >"$WORK/counter.dsl" <<EOF
+var int i = 0
+while (i < $ITERATIONS):
+  i = i + 1
+print i
+run
+EOF
+
+cat >"$WORK/bound.dsl" <<EOF
+var int i = 0
+var int n = $ITERATIONS
+var int left = $ITERATIONS
+while (i < n):
+  left = left - 1
+  i = i + 1
+print left
+run
+EOF
+
+cat >"$WORK/branches.dsl" <<EOF
+var int i = 0
+var int odd = 0
+var int sevens = 0
+while (i < $ITERATIONS):
+  if (odd ? 0):
+    odd = 1
+  else:
+    odd = 0
+  if (i ! 7):
+    sevens = sevens + 0
+  else:
+    sevens = sevens + 1
+  i = i + 1
+print sevens
+run
+EOF
+
+FLAGS=(--engine=vm --no-ssa-opt --no-loop-opt)
+
+for script in "$WORK"/*.dsl; do
+  name=$(basename "$script" .dsl)
+  echo "$name: $ITERATIONS iterations"
+  for mode in fused plain; do
+    extra=()
+    if [[ $mode == plain ]]; then
+      extra=(--no-superinstructions)
+    fi
+    ops=$(dispatched "${FLAGS[@]}" "${extra[@]}" "$script")
+    micros=$(best_time "$BUILD/threaded/bin/dsl.out" "${FLAGS[@]}" \
+      "${extra[@]}" "$script")
+    printf '  %-6s %6.2f ops/iteration  %8d us\n' "$mode" \
+      "$(awk -v n="$ops" -v i="$ITERATIONS" 'BEGIN { print n / i }')" \
+      "$micros"
+  done
+done
@@ -0,0 +1,70 @@
+#!/usr/bin/env bash
+# Measures lexing, parsing, compiling and execution throughput on scripts
+# written by bench/generate.cpp: long straight-line code, deeply nested
+# ifs, a loop of millions of iterations, a huge expression and many
+# variables. bench/stages.cpp times each stage on an optimized build, and
+# the VM instructions the script dispatches are counted on a second one.
+#
+# Usage: bench/throughput.sh [scale] [runs]
+#
+# Every script grows with scale (1 by default), and every stage counts the
+# fastest of runs runs (3 by default). Prints a table, and writes the
+# results as JSON to $OUT, by default bench/results/<commit>.json, so that
+# they can be compared across releases.
+set -euo pipefail
+
+source "$(dirname "$0")/common.sh"
+SCALE=${1:-1}
+RUNS=${2:-3}
+CXX=${CXX:-g++}
+COMMIT=$(git rev-parse --short HEAD 2>/dev/null || echo unknown)
+OUT=${OUT:-bench/results/$COMMIT.json}
+
+build threaded DISPATCH=threaded
+build count COUNT_DISPATCH=1
+"$CXX" -O2 -std=c++17 bench/generate.cpp -o "$BUILD/generate"
+"$CXX" -O2 -std=c++17 -Isrc/include bench/stages.cpp \
+  "$BUILD/threaded/bin/libdsl.a" -pthread -o "$BUILD/stages"
+
+# Kind of script and its size at scale 1.
+WORKLOADS=(
+  "straight 20000"
+  "nested 100"
+  "loop 5000000"
+  "expression 20000"
+  "variables 10000"
+)
+
+# The value of a number in the JSON object the stages print.
+field() {
+  grep -o "\"$2\": [^,}]*" <<<"$1" | cut -d' ' -f2
+}
+
+printf '%-10s %9s %12s %12s %10s %12s %9s\n' workload size tokens/s \
+  nodes/s compile_ms ops/s rss_kb
+results=()
+for workload in "${WORKLOADS[@]}"; do
+  read -r kind size <<<"$workload"
+  size=$((size * SCALE))
+  script="$WORK/$kind.dsl"
+  "$BUILD/generate" "$kind" "$size" >"$script"
+  stages=$("$BUILD/stages" --runs="$RUNS" --ops="$(dispatched --engine=vm "$script")" \
+    "$script")
+  results+=("{\"name\": \"$kind\", \"size\": $size, ${stages#\{}")
+  printf '%-10s %9d %12.4g %12.4g %10.2f %12.4g %9d\n' "$kind" "$size" \
+    "$(field "$stages" tokens_per_s)" "$(field "$stages" nodes_per_s)" \
+    "$(awk -v s="$(field "$stages" compile_s)" 'BEGIN { print s * 1000 }')" \
+    "$(field "$stages" ops_per_s)" "$(field "$stages" peak_rss_kb)"
+done
+
+mkdir -p "$(dirname "$OUT")"
+{
+  printf '{"commit": "%s", "date": "%s", "scale": %d, "runs": %d,\n' \
+    "$COMMIT" "$(date -u +%Y-%m-%dT%H:%M:%SZ)" "$SCALE" "$RUNS"
+  printf ' "workloads": [\n'
+  for ((i = 0; i < ${#results[@]}; i++)); do
+    printf '  %s%s\n' "${results[i]}" "$([[ $i -lt $((${#results[@]} - 1)) ]] && echo ,)"
+  done
+  printf ']}\n'
+} >"$OUT"
+echo "Results written to $OUT"
@@ -0,0 +1,216 @@
+#include "AST.h"
+#include <sstream>
+
+AST::AST() : globalCount(0), root(0), resolved(false) {}
+
+NodeId AST::addNode(NodeType type,
+                    std::uint32_t position,
+                    const NodeId* childIds,
+                    std::uint32_t childCount,
+                    std::uint8_t op,
+                    std::uint32_t value) {
+  NodeId id = static_cast<NodeId>(nodes.size());
+  std::uint32_t firstChild = static_cast<std::uint32_t>(children.size());
+  children.insert(children.end(), childIds, childIds + childCount);
+  nodes.push_back(
+      {type, op, DataType::Int, firstChild, childCount, value, position});
+  return id;
+}
+
+void AST::setChildren(NodeId id,
+                      const NodeId* childIds,
+                      std::uint32_t count) {
+  // The old range is simply abandoned; it goes away with the AST.
+  std::uint32_t firstChild = static_cast<std::uint32_t>(children.size());
+  children.insert(children.end(), childIds, childIds + count);
+  nodes[id].firstChild = firstChild;
+  nodes[id].childCount = count;
+}
+
+NodeId AST::copyNode(NodeId id) {
+  ASTNode node = nodes[id];
+  nodes.push_back(node);
+  return static_cast<NodeId>(nodes.size() - 1);
+}
+
+std::uint32_t AST::addString(std::string_view text) {
+  strings.emplace_back(text);
+  return static_cast<std::uint32_t>(strings.size() - 1);
+}
+
+const std::string& AST::getString(std::uint32_t index) const {
+  return strings[index];
+}
+
+std::uint32_t AST::addFloat(double value) {
+  floats.push_back(value);
+  return static_cast<std::uint32_t>(floats.size() - 1);
+}
+
+double AST::getFloat(std::uint32_t index) const {
+  return floats[index];
+}
+
+void AST::setNames(std::vector<std::string> names) {
+  this->names = std::move(names);
+}
+
+std::uint32_t AST::addName(std::string name) {
+  names.push_back(std::move(name));
+  return static_cast<std::uint32_t>(names.size() - 1);
+}
+
+std::uint32_t AST::getNameCount() const {
+  return static_cast<std::uint32_t>(names.size());
+}
+
+const std::string& AST::getName(std::uint32_t id) const {
+  return names[id];
+}
+
+const std::string& AST::getIdentifierName(NodeId id) const {
+  std::uint32_t value = nodes[id].value;
+  return resolved ? getSlotName(value) : names[value];
+}
+
+std::uint32_t AST::addSlot(std::uint32_t nameId) {
+  slotNames.push_back(nameId);
+  slotTypes.push_back(DataType::Int);
+  return static_cast<std::uint32_t>(slotNames.size() - 1);
+}
+
+std::uint32_t AST::getSlotCount() const {
+  return static_cast<std::uint32_t>(slotNames.size());
+}
+
+const std::string& AST::getSlotName(std::uint32_t slot) const {
+  return names[slotNames[slot]];
+}
+
+void AST::setSlotType(std::uint32_t slot, DataType type) {
+  slotTypes[slot] = type;
+}
+
+DataType AST::getSlotType(std::uint32_t slot) const {
+  return slotTypes[slot];
+}
+
+void AST::setGlobals(std::vector<std::uint32_t> nameIds,
+                     const std::vector<DataType>& types) {
+  slotNames = std::move(nameIds);
+  slotTypes = types;
+  globalCount = static_cast<std::uint32_t>(slotNames.size());
+}
+
+std::uint32_t AST::getGlobalCount() const {
+  return globalCount;
+}
+
+void AST::setResolved() {
+  resolved = true;
+}
+
+bool AST::isResolved() const {
+  return resolved;
+}
+
+void AST::setSource(std::shared_ptr<const Source> source) {
+  this->source = std::move(source);
+}
+
+const Source* AST::getSource() const {
+  return source.get();
+}
+
+Position AST::getPosition(NodeId id) const {
+  return Position(static_cast<int>(nodes[id].position), source.get());
+}
+
+void AST::setRoot(NodeId id) {
+  root = id;
+}
+
+NodeId AST::getRoot() const {
+  return root;
+}
+
+std::size_t AST::size() const {
+  return nodes.size();
+}
+
+const char* AST::getNodeName(NodeType type) {
+  static const char* const nodeNames[] = {"Program",
+                                          "Expression",
+                                          "Term",
+                                          "Factor",
+                                          "Literal",
+                                          "UnaryMinus",
+                                          "Operator",
+                                          "PrintStatement",
+                                          "VarDeclaration",
+                                          "Assignment",
+                                          "DataType",
+                                          "Identifier",
+                                          "StringLiteral",
+                                          "WhileStatement",
+                                          "IfStatement",
+                                          "ElifStatement",
+                                          "ElseStatement",
+                                          "Comparison",
+                                          "Comparator",
+                                          "IndentedStatementList",
+                                          "Convert",
+                                          "TripCount"};
+  return nodeNames[static_cast<int>(type)];
+}
+
+std::string AST::asString(NodeId id, int depth) const {
+  static const char* const operatorNames[] = {"+", "-", "*", "/"};
+  static const char* const comparatorNames[] = {"<", ">", "?", "!"};
+  static const char* const dataTypeNames[] = {"int", "float"};
+
+  const ASTNode& node = nodes[id];
+  std::string value;
+  switch (node.type) {
+    case NodeType::Operator:
+      value = operatorNames[node.op];
+      break;
+    case NodeType::Comparator:
+      value = comparatorNames[node.op];
+      break;
+    case NodeType::DataType:
+      value = dataTypeNames[node.op];
+      break;
+    case NodeType::Convert:
+      value = dataTypeNames[static_cast<int>(node.dataType)];
+      break;
+    case NodeType::Identifier:
+      value = getIdentifierName(id);
+      break;
+    case NodeType::Literal:
+      if (static_cast<DataType>(node.op) == DataType::Float) {
+        std::ostringstream stream;
+        stream << floats[node.value];
+        value = stream.str();
+      } else {
+        value = std::to_string(static_cast<std::int32_t>(node.value));
+      }
+      break;
+    case NodeType::StringLiteral:
+      value = strings[node.value];
+      break;
+    default:
+      break;
+  }
+
+  std::string indent(depth * 2, ' ');
+  std::string result = indent + "Node type: " + getNodeName(node.type) + "\n";
+  if (!value.empty()) {
+    result += indent + "Value: " + value + "\n";
+  }
+  for (const NodeId* child = beginChildren(id); child != endChildren(id);
+       child++) {
+    result += asString(*child, depth + 1);
+  }
+  return result;
+}
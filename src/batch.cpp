@@ -0,0 +1,89 @@
+#include "batch.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+namespace fs = std::filesystem;
+
+BatchRunner::BatchRunner(std::vector<std::string> paths, unsigned threads)
+    : paths(std::move(paths)), pool(threads), written(0), failures(0) {}
+
+bool BatchRunner::expand(const std::vector<std::string>& arguments,
+                         std::vector<std::string>& paths) {
+  for (const std::string& argument : arguments) {
+    if (!argument.empty() && argument[0] == '@') {
+      std::ifstream list(argument.substr(1));
+      if (!list) {
+        std::cerr << "Failed to open file: " << argument.substr(1)
+                  << std::endl;
+        return false;
+      }
+      std::string line;
+      while (std::getline(list, line)) {
+        if (!line.empty()) {
+          paths.push_back(line);
+        }
+      }
+      continue;
+    }
+
+    std::error_code error;
+    if (!fs::is_directory(argument, error)) {
+      paths.push_back(argument);
+      continue;
+    }
+    std::vector<std::string> scripts;
+    for (fs::recursive_directory_iterator it(argument, error), end;
+         !error && it != end; it.increment(error)) {
+      if (it->path().extension() == ".dsl" && !it->is_directory(error)) {
+        scripts.push_back(it->path().string());
+      }
+    }
+    if (error) {
+      std::cerr << "Failed to read directory: " << argument << std::endl;
+      return false;
+    }
+    std::sort(scripts.begin(), scripts.end());
+    paths.insert(paths.end(), scripts.begin(), scripts.end());
+  }
+  return true;
+}
+
+std::size_t BatchRunner::run(const Script& script) {
+  results.assign(paths.size(), Result());
+  written = 0;
+  failures = 0;
+  pool.run(paths.size(), [&](std::size_t index) {
+    std::string output;
+    std::string error;
+    bool succeeded = script(paths[index], output, error);
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      Result& result = results[index];
+      result.output = std::move(output);
+      result.error = std::move(error);
+      result.failed = !succeeded;
+      result.done = true;
+    }
+    finish();
+  });
+  return failures;
+}
+
+// Whichever worker completes the script next in line writes it out, along
+// with the ones after it that are already done.
+void BatchRunner::finish() {
+  std::lock_guard<std::mutex> lock(mutex);
+  for (; written < results.size() && results[written].done; written++) {
+    Result& result = results[written];
+    std::cout << "==> " << paths[written] << " <==\n" << result.output;
+    std::cout.flush();
+    if (result.failed) {
+      failures++;
+      std::cerr << result.error << std::endl;
+    }
+    result = Result();
+    result.done = true;
+  }
+}
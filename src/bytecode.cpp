@@ -0,0 +1,105 @@
+#include "bytecode.h"
+#include <atomic>
+#include <sstream>
+
+std::uint64_t ChunkId::next() {
+  static std::atomic<std::uint64_t> last{0};
+  return ++last;
+}
+
+const char* Chunk::getOpName(OpCode op) {
+  static const char* const opNames[] = {"CONSTANT",
+                                        "CONSTANT_FLOAT",
+                                        "LOAD",
+                                        "STORE",
+                                        "ADD",
+                                        "SUBTRACT",
+                                        "MULTIPLY",
+                                        "DIVIDE",
+                                        "NEGATE",
+                                        "ADD_FLOAT",
+                                        "SUBTRACT_FLOAT",
+                                        "MULTIPLY_FLOAT",
+                                        "DIVIDE_FLOAT",
+                                        "NEGATE_FLOAT",
+                                        "INT_TO_FLOAT",
+                                        "FLOAT_TO_INT",
+                                        "LESS",
+                                        "GREATER",
+                                        "EQUAL",
+                                        "NOT_EQUAL",
+                                        "LESS_FLOAT",
+                                        "GREATER_FLOAT",
+                                        "EQUAL_FLOAT",
+                                        "NOT_EQUAL_FLOAT",
+                                        "TRIP_COUNT_LESS",
+                                        "TRIP_COUNT_GREATER",
+                                        "TRIP_COUNT_EQUAL",
+                                        "TRIP_COUNT_NOT_EQUAL",
+                                        "BRANCH_LESS",
+                                        "BRANCH_GREATER",
+                                        "BRANCH_EQUAL",
+                                        "BRANCH_NOT_EQUAL",
+                                        "BRANCH_LESS_CONSTANT",
+                                        "BRANCH_GREATER_CONSTANT",
+                                        "BRANCH_EQUAL_CONSTANT",
+                                        "BRANCH_NOT_EQUAL_CONSTANT",
+                                        "ADD_CONSTANT",
+                                        "SUBTRACT_CONSTANT",
+                                        "JUMP",
+                                        "JUMP_IF_FALSE",
+                                        "PRINT",
+                                        "PRINT_FLOAT",
+                                        "PRINT_STRING",
+                                        "NATIVE",
+                                        "HALT"};
+  return opNames[static_cast<int>(op)];
+}
+
+std::string Chunk::asString() const {
+  std::string result;
+  for (std::size_t i = 0; i < code.size(); i++) {
+    const Instruction& instruction = code[i];
+    result += std::to_string(i) + "\t" + getOpName(instruction.op);
+    switch (instruction.op) {
+      case OpCode::Constant:
+      case OpCode::Load:
+      case OpCode::Store:
+      case OpCode::Jump:
+      case OpCode::JumpIfFalse:
+      case OpCode::TripCountLess:
+      case OpCode::TripCountGreater:
+      case OpCode::TripCountEqual:
+      case OpCode::TripCountNotEqual:
+      case OpCode::BranchLess:
+      case OpCode::BranchGreater:
+      case OpCode::BranchEqual:
+      case OpCode::BranchNotEqual:
+      case OpCode::BranchLessConstant:
+      case OpCode::BranchGreaterConstant:
+      case OpCode::BranchEqualConstant:
+      case OpCode::BranchNotEqualConstant:
+      case OpCode::AddConstant:
+      case OpCode::SubtractConstant:
+        result += " " + std::to_string(instruction.operand);
+        break;
+      case OpCode::Native:
+        result += " " + std::to_string(instruction.operand) + " -> " +
+                  std::to_string(natives[instruction.operand].exit);
+        break;
+      case OpCode::ConstantFloat: {
+        std::ostringstream stream;
+        stream << floats[instruction.operand];
+        result += " " + stream.str();
+        break;
+      }
+      case OpCode::PrintString:
+        result += " \"" + strings[instruction.operand] + "\"";
+        break;
+      default:
+        break;
+    }
+    result += "\n";
+  }
+  return result;
+}
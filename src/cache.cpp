@@ -0,0 +1,406 @@
+#include "cache.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define CACHE_HAS_POSIX 1
+#endif
+
+namespace {
+
+// Reads "DSLC" on little-endian machines, and differently on the others.
+constexpr std::uint32_t MAGIC = 0x434c5344;
+
+struct Header {
+  std::uint32_t magic;
+  std::uint32_t version;
+  std::uint64_t sourceHash;
+  std::uint64_t sourceSize;
+  std::uint32_t options;
+  std::uint32_t slotCount;
+  std::uint32_t maxStack;
+  std::uint32_t codeCount;
+  std::uint32_t floatCount;
+  std::uint32_t stringCount;
+  // Of the header, with this field zero, and everything after it.
+  std::uint64_t checksum;
+};
+static_assert(sizeof(Header) == 56, "Header must not be padded");
+
+constexpr std::size_t INSTRUCTION_SIZE = 8;
+
+constexpr std::uint64_t FNV_OFFSET = 0xcbf29ce484222325;
+
+std::uint64_t fnv1a(const char* data,
+                    std::size_t size,
+                    std::uint64_t hash = FNV_OFFSET) {
+  for (std::size_t i = 0; i < size; i++) {
+    hash ^= static_cast<unsigned char>(data[i]);
+    hash *= 0x100000001b3;
+  }
+  return hash;
+}
+
+template <typename T>
+void put(std::string& bytes, const T& value) {
+  bytes.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+template <typename T>
+T get(const char*& data) {
+  T value;
+  std::memcpy(&value, data, sizeof(value));
+  data += sizeof(value);
+  return value;
+}
+
+std::uint64_t checksum(Header header, const char* payload, std::size_t size) {
+  header.checksum = 0;
+  std::uint64_t hash =
+      fnv1a(reinterpret_cast<const char*>(&header), sizeof(header));
+  return fnv1a(payload, size, hash);
+}
+
+struct StackEffect {
+  std::uint32_t pops;
+  std::uint32_t pushes;
+};
+
+// Of the instructions isValid() lets through, as Compiler::emit counts them.
+StackEffect stackEffect(OpCode op) {
+  switch (op) {
+    case OpCode::Constant:
+    case OpCode::ConstantFloat:
+    case OpCode::Load:
+      return {0, 1};
+    case OpCode::Store:
+    case OpCode::JumpIfFalse:
+    case OpCode::Print:
+    case OpCode::PrintFloat:
+      return {1, 0};
+    case OpCode::Negate:
+    case OpCode::NegateFloat:
+    case OpCode::IntToFloat:
+    case OpCode::FloatToInt:
+      return {1, 1};
+    case OpCode::Jump:
+    case OpCode::PrintString:
+    case OpCode::Halt:
+      return {0, 0};
+    default:
+      return {2, 1};
+  }
+}
+
+// The deepest the operand stack gets, following every path through the
+// code. Fails when a path pops more than it pushed, or when two paths reach
+// an instruction with different depths, as no compiled chunk does.
+bool findMaxStack(const Chunk& chunk, std::uint32_t& maxStack) {
+  constexpr std::uint32_t UNSEEN = UINT32_MAX;
+  std::vector<std::uint32_t> depths(chunk.code.size(), UNSEEN);
+  std::vector<std::uint32_t> pending = {0};
+  depths[0] = 0;
+  maxStack = 0;
+  auto reach = [&](std::size_t next, std::uint32_t depth) {
+    if (depths[next] == UNSEEN) {
+      depths[next] = depth;
+      pending.push_back(static_cast<std::uint32_t>(next));
+    }
+    return depths[next] == depth;
+  };
+  while (!pending.empty()) {
+    std::uint32_t at = pending.back();
+    pending.pop_back();
+    const Instruction& instruction = chunk.code[at];
+    StackEffect effect = stackEffect(instruction.op);
+    if (depths[at] < effect.pops) {
+      return false;
+    }
+    std::uint32_t depth = depths[at] - effect.pops + effect.pushes;
+    maxStack = std::max(maxStack, depth);
+    std::size_t target = static_cast<std::uint32_t>(instruction.operand);
+    switch (instruction.op) {
+      case OpCode::Halt:
+        break;
+      case OpCode::Jump:
+        if (!reach(target, depth)) {
+          return false;
+        }
+        break;
+      case OpCode::JumpIfFalse:
+        if (!reach(target, depth) || !reach(at + 1, depth)) {
+          return false;
+        }
+        break;
+      default:
+        if (!reach(at + 1, depth)) {
+          return false;
+        }
+    }
+  }
+  return true;
+}
+
+// Rejects anything save() does not write: the Jit's Native instructions,
+// superinstructions, operands out of range, and a stack or variable array
+// smaller than the code needs. Together with the checksum this keeps a
+// damaged or forged file from making the VM read or write out of bounds.
+bool isValid(const Chunk& chunk) {
+  if (chunk.code.empty() || chunk.code.back().op != OpCode::Halt ||
+      chunk.slotTypes.size() != chunk.slotCount) {
+    return false;
+  }
+  for (const Instruction& instruction : chunk.code) {
+    std::uint32_t operand = static_cast<std::uint32_t>(instruction.operand);
+    switch (instruction.op) {
+      case OpCode::Load:
+      case OpCode::Store:
+        if (operand >= chunk.slotCount) {
+          return false;
+        }
+        break;
+      case OpCode::ConstantFloat:
+        if (operand >= chunk.floats.size()) {
+          return false;
+        }
+        break;
+      case OpCode::PrintString:
+        if (operand >= chunk.strings.size()) {
+          return false;
+        }
+        break;
+      case OpCode::Jump:
+      case OpCode::JumpIfFalse:
+        if (operand >= chunk.code.size()) {
+          return false;
+        }
+        break;
+      case OpCode::Native:
+        return false;
+      default:
+        if (instruction.op > OpCode::Halt ||
+            (instruction.op >= OpCode::BranchLess &&
+             instruction.op <= OpCode::SubtractConstant)) {
+          return false;
+        }
+    }
+  }
+  for (DataType type : chunk.slotTypes) {
+    if (type != DataType::Int && type != DataType::Float) {
+      return false;
+    }
+  }
+  std::uint32_t maxStack;
+  return findMaxStack(chunk, maxStack) && chunk.maxStack >= maxStack;
+}
+
+// Writes bytes to a new file beside path and returns its name, or an empty
+// string when that fails. Every call gets a file of its own, so two runs
+// saving the same cache never write into each other's.
+std::string writeTemporary(const std::string& path, const std::string& bytes) {
+#ifdef CACHE_HAS_POSIX
+  std::string name = path + ".XXXXXX";
+  int fd = mkstemp(name.data());
+  if (fd < 0) {
+    return "";
+  }
+  // mkstemp leaves the file readable by its owner only.
+  fchmod(fd, 0644);
+  const char* data = bytes.data();
+  std::size_t left = bytes.size();
+  while (left > 0) {
+    ssize_t written = write(fd, data, left);
+    if (written < 0 && errno != EINTR) {
+      break;
+    }
+    if (written > 0) {
+      data += written;
+      left -= static_cast<std::size_t>(written);
+    }
+  }
+  if (close(fd) != 0 || left > 0) {
+    std::remove(name.c_str());
+    return "";
+  }
+#else
+  std::string name = path + ".tmp";
+  std::ofstream file(name, std::ios::binary | std::ios::trunc);
+  if (!file.write(bytes.data(), bytes.size()).flush()) {
+    file.close();
+    std::remove(name.c_str());
+    return "";
+  }
+#endif
+  return name;
+}
+
+bool decode(const char* data,
+            std::size_t size,
+            std::string_view text,
+            std::uint32_t options,
+            Chunk& result) {
+  if (size < sizeof(Header)) {
+    return false;
+  }
+  Header header = get<Header>(data);
+  if (header.magic != MAGIC || header.version != ChunkCache::VERSION ||
+      header.sourceHash != ChunkCache::hash(text) ||
+      header.sourceSize != text.size() || header.options != options) {
+    return false;
+  }
+
+  // Everything but the string bytes has a fixed size; the counts are 32-bit,
+  // so none of this can overflow.
+  std::uint64_t fixedSize =
+      std::uint64_t{header.codeCount} * (INSTRUCTION_SIZE + 4) +
+      std::uint64_t{header.floatCount} * sizeof(double) +
+      std::uint64_t{header.stringCount} * 4 + header.slotCount;
+  std::uint64_t payloadSize = size - sizeof(Header);
+  if (fixedSize > payloadSize ||
+      checksum(header, data, payloadSize) != header.checksum) {
+    return false;
+  }
+
+  Chunk chunk;
+  chunk.slotCount = header.slotCount;
+  chunk.maxStack = header.maxStack;
+  chunk.code.resize(header.codeCount);
+  for (Instruction& instruction : chunk.code) {
+    instruction.op = static_cast<OpCode>(get<std::uint8_t>(data));
+    data += 3;
+    instruction.operand = get<std::int32_t>(data);
+  }
+  chunk.floats.resize(header.floatCount);
+  std::memcpy(chunk.floats.data(), data, header.floatCount * sizeof(double));
+  data += header.floatCount * sizeof(double);
+  chunk.positions.resize(header.codeCount);
+  std::memcpy(chunk.positions.data(), data, header.codeCount * 4);
+  data += header.codeCount * 4;
+
+  std::uint64_t stringBytes = 0;
+  std::vector<std::uint32_t> lengths(header.stringCount);
+  for (std::uint32_t& length : lengths) {
+    length = get<std::uint32_t>(data);
+    stringBytes += length;
+  }
+  chunk.slotTypes.resize(header.slotCount);
+  std::memcpy(chunk.slotTypes.data(), data, header.slotCount);
+  data += header.slotCount;
+  if (fixedSize + stringBytes != payloadSize) {
+    return false;
+  }
+  chunk.strings.reserve(header.stringCount);
+  for (std::uint32_t length : lengths) {
+    chunk.strings.emplace_back(data, length);
+    data += length;
+  }
+
+  if (!isValid(chunk)) {
+    return false;
+  }
+  result = std::move(chunk);
+  return true;
+}
+
+}  // namespace
+
+namespace ChunkCache {
+
+std::uint64_t hash(std::string_view text) {
+  return fnv1a(text.data(), text.size());
+}
+
+bool load(const std::string& path,
+          std::string_view text,
+          std::uint32_t options,
+          Chunk& chunk) {
+#ifdef CACHE_HAS_POSIX
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat info;
+  if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+    std::size_t fileSize = static_cast<std::size_t>(info.st_size);
+    void* mapped = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapped != MAP_FAILED) {
+      close(fd);
+      bool loaded = decode(static_cast<const char*>(mapped), fileSize, text,
+                           options, chunk);
+      munmap(mapped, fileSize);
+      return loaded;
+    }
+  }
+  close(fd);
+#endif
+
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    return false;
+  }
+  std::string bytes((std::istreambuf_iterator<char>(file)),
+                    std::istreambuf_iterator<char>());
+  return decode(bytes.data(), bytes.size(), text, options, chunk);
+}
+
+// The file is written under a temporary name of its own and renamed into
+// place, so that a run reading it at the same time never sees half of it.
+bool save(const std::string& path,
+          std::string_view text,
+          std::uint32_t options,
+          const Chunk& chunk) {
+  std::string payload;
+  for (const Instruction& instruction : chunk.code) {
+    put(payload, static_cast<std::uint8_t>(instruction.op));
+    payload.append(3, '\0');
+    put(payload, instruction.operand);
+  }
+  payload.append(reinterpret_cast<const char*>(chunk.floats.data()),
+                 chunk.floats.size() * sizeof(double));
+  payload.append(reinterpret_cast<const char*>(chunk.positions.data()),
+                 chunk.positions.size() * 4);
+  for (const std::string& string : chunk.strings) {
+    put(payload, static_cast<std::uint32_t>(string.size()));
+  }
+  payload.append(reinterpret_cast<const char*>(chunk.slotTypes.data()),
+                 chunk.slotTypes.size());
+  for (const std::string& string : chunk.strings) {
+    payload += string;
+  }
+
+  Header header = {MAGIC,
+                   VERSION,
+                   hash(text),
+                   text.size(),
+                   options,
+                   chunk.slotCount,
+                   chunk.maxStack,
+                   static_cast<std::uint32_t>(chunk.code.size()),
+                   static_cast<std::uint32_t>(chunk.floats.size()),
+                   static_cast<std::uint32_t>(chunk.strings.size()),
+                   0};
+  header.checksum = checksum(header, payload.data(), payload.size());
+
+  std::string bytes(reinterpret_cast<const char*>(&header), sizeof(header));
+  bytes += payload;
+  std::string temporary = writeTemporary(path, bytes);
+  if (temporary.empty()) {
+    return false;
+  }
+  if (std::rename(temporary.c_str(), path.c_str()) != 0) {
+    std::remove(temporary.c_str());
+    return false;
+  }
+  return true;
+}
+
+}  // namespace ChunkCache
@@ -0,0 +1,393 @@
+#include "cgen.h"
+#include <unistd.h>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include "error.h"
+
+namespace {
+
+const char* const includes = R"(#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+)";
+
+// Follows the errors table. The arithmetic mirrors arithmetic.h.
+const char* const helpers = R"(static void fail(int site) {
+  fflush(stdout);
+  fputs(errors[site], stderr);
+  exit(1);
+}
+
+static inline int32_t add(int32_t left, int32_t right) {
+  return (int32_t)((uint32_t)left + (uint32_t)right);
+}
+
+static inline int32_t subtract(int32_t left, int32_t right) {
+  return (int32_t)((uint32_t)left - (uint32_t)right);
+}
+
+static inline int32_t multiply(int32_t left, int32_t right) {
+  return (int32_t)((uint32_t)left * (uint32_t)right);
+}
+
+static inline int32_t negate(int32_t value) {
+  return (int32_t)(0u - (uint32_t)value);
+}
+
+static inline int32_t divide(int32_t left, int32_t right) {
+  return right == -1 ? negate(left) : left / right;
+}
+
+static inline int32_t checkedDivide(int32_t left, int32_t right, int site) {
+  if (right == 0) {
+    fail(site);
+  }
+  return divide(left, right);
+}
+
+static inline double checkedDivideFloat(double left, double right, int site) {
+  if (right == 0) {
+    fail(site);
+  }
+  return left / right;
+}
+
+static inline int32_t toInt(double value) {
+  if (!(value == value)) {
+    return 0;
+  }
+  if (value >= 2147483647.0) {
+    return INT32_MAX;
+  }
+  if (value <= -2147483648.0) {
+    return INT32_MIN;
+  }
+  return (int32_t)value;
+}
+
+static inline double fromBits(uint64_t bits) {
+  double value;
+  memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+)";
+
+const char* const intOperators[] = {"add", "subtract", "multiply", "divide"};
+const char* const floatOperators[] = {" + ", " - ", " * ", " / "};
+const char* const comparators[] = {" < ", " > ", " == ", " != "};
+
+std::string shellQuote(const std::string& text) {
+  std::string result = "'";
+  for (char c : text) {
+    result += c == '\'' ? std::string("'\\''") : std::string(1, c);
+  }
+  return result + "'";
+}
+
+}  // namespace
+
+CGenerator::CGenerator(const AST& ast) : ast(ast), temporaries(0), depth(1) {}
+
+std::string CGenerator::generate() {
+  if (!ast.isResolved()) {
+    throw std::runtime_error("AST has not been resolved");
+  }
+  code.clear();
+  errors.clear();
+  temporaries = 0;
+  depth = 1;
+  generateStatementList(ast.getRoot());
+
+  std::string result = includes;
+  result += "static const char* const errors[] = {";
+  for (const std::string& error : errors) {
+    result += "\n    " + quote(error) + ",";
+  }
+  result += "\n    0};\n\n";
+  result += helpers;
+  result += "int main(void) {\n";
+  for (std::uint32_t slot = 0; slot < ast.getSlotCount(); slot++) {
+    result += std::string("  ") +
+              (ast.getSlotType(slot) == DataType::Float ? "double "
+                                                        : "int32_t ") +
+              variable(slot) + " = 0; /* " + ast.getSlotName(slot) + " */\n";
+  }
+  return result + code + "  return 0;\n}\n";
+}
+
+bool CGenerator::buildExecutable(const std::string& source,
+                                 const std::string& output) {
+  char path[] = "/tmp/dslXXXXXX.c";
+  int fd = mkstemps(path, 2);
+  if (fd < 0) {
+    return false;
+  }
+  bool written =
+      write(fd, source.data(), source.size()) ==
+      static_cast<ssize_t>(source.size());
+  close(fd);
+
+  bool built = false;
+  if (written) {
+    const char* compiler = std::getenv("CC");
+    if (compiler == nullptr || *compiler == '\0') {
+      compiler = "cc";
+    }
+    std::string command = std::string(compiler) + " -O2 -o " +
+                          shellQuote(output) + " " + shellQuote(path);
+    built = std::system(command.c_str()) == 0;
+  }
+  std::remove(path);
+  return built;
+}
+
+void CGenerator::line(const std::string& text) {
+  code += std::string(depth * 2, ' ') + text + "\n";
+}
+
+void CGenerator::generateStatement(NodeId node) {
+  switch (ast[node].type) {
+    case NodeType::VarDeclaration:
+      if (ast[node].childCount > 2) {
+        std::string value = generateExpression(ast.getChild(node, 2));
+        line(variable(ast[ast.getChild(node, 1)].value) + " = " + value + ";");
+      }
+      break;
+    case NodeType::Assignment: {
+      std::string value = generateExpression(ast.getChild(node, 1));
+      line(variable(ast[ast.getChild(node, 0)].value) + " = " + value + ";");
+      break;
+    }
+    case NodeType::PrintStatement: {
+      NodeId child = ast.getChild(node, 0);
+      if (ast[child].type == NodeType::StringLiteral) {
+        line("fputs(" + quote("> " + ast.getString(ast[child].value) + "\n") +
+             ", stdout);");
+      } else if (ast[child].dataType == DataType::Float) {
+        line("printf(\"> %g\\n\", " + generateExpression(child) + ");");
+      } else {
+        line("printf(\"> %\" PRId32 \"\\n\", " + generateExpression(child) +
+             ");");
+      }
+      break;
+    }
+    case NodeType::IfStatement:
+      generateIfStatement(node);
+      break;
+    case NodeType::WhileStatement:
+      generateWhileStatement(node);
+      break;
+    case NodeType::StatementList:
+      generateStatementList(node);
+      break;
+    default:
+      throw std::runtime_error("Unexpected statement type");
+  }
+}
+
+void CGenerator::generateStatementList(NodeId node) {
+  for (const NodeId* child = ast.beginChildren(node);
+       child != ast.endChildren(node); child++) {
+    generateStatement(*child);
+  }
+}
+
+// A condition that can fail needs statements computing it, so its clause
+// goes into the else block of the previous one.
+void CGenerator::generateIfStatement(NodeId node) {
+  int nested = 0;
+  for (std::uint32_t i = 1; i < ast[node].childCount; i++) {
+    NodeId child = (i == 1) ? node : ast.getChild(node, i);
+    if (ast[child].type == NodeType::ElseStatement) {
+      line("} else {");
+      depth++;
+      generateStatementList(ast.getChild(child, 0));
+      depth--;
+      break;
+    }
+
+    NodeId condition = ast.getChild(child, 0);
+    if (i == 1) {
+      line("if " + generateCondition(condition) + " {");
+    } else if (!canFail(condition)) {
+      line("} else if " + generateCondition(condition) + " {");
+    } else {
+      line("} else {");
+      depth++;
+      nested++;
+      line("if " + generateCondition(condition) + " {");
+    }
+    depth++;
+    generateStatementList(ast.getChild(child, 1));
+    depth--;
+  }
+  line("}");
+  for (; nested > 0; nested--) {
+    depth--;
+    line("}");
+  }
+}
+
+void CGenerator::generateWhileStatement(NodeId node) {
+  NodeId condition = ast.getChild(node, 0);
+  if (!canFail(condition)) {
+    line("while " + generateCondition(condition) + " {");
+  } else {
+    line("for (;;) {");
+    depth++;
+    line("if (!" + generateCondition(condition) + ") {");
+    line("  break;");
+    line("}");
+    depth--;
+  }
+  depth++;
+  generateStatementList(ast.getChild(node, 1));
+  depth--;
+  line("}");
+}
+
+std::string CGenerator::generateCondition(NodeId node) {
+  std::string left = generateExpression(ast.getChild(node, 0));
+  std::string right = generateExpression(ast.getChild(node, 2));
+  return "(" + left + comparators[ast[ast.getChild(node, 1)].op] + right +
+         ")";
+}
+
+// Expressions that cannot fail are generated inline. A division that can
+// is computed into a temporary first, so that divisions fail in the order
+// the interpreter evaluates them in.
+std::string CGenerator::generateExpression(NodeId node) {
+  bool isFloat = ast[node].dataType == DataType::Float;
+  switch (ast[node].type) {
+    case NodeType::Literal:
+      return generateLiteral(node);
+    case NodeType::Identifier:
+      return variable(ast[node].value);
+    case NodeType::UnaryMinus: {
+      std::string operand = generateExpression(ast.getChild(node, 0));
+      return isFloat ? "(-" + operand + ")" : "negate(" + operand + ")";
+    }
+    case NodeType::Convert: {
+      std::string operand = generateExpression(ast.getChild(node, 0));
+      return isFloat ? "((double)" + operand + ")" : "toInt(" + operand + ")";
+    }
+    case NodeType::Expression:
+    case NodeType::Term: {
+      std::string result = generateExpression(ast.getChild(node, 0));
+      for (std::uint32_t i = 1; i < ast[node].childCount; i += 2) {
+        NodeId opNode = ast.getChild(node, i);
+        NodeId rightNode = ast.getChild(node, i + 1);
+        std::string right = generateExpression(rightNode);
+        Operator op = static_cast<Operator>(ast[opNode].op);
+        if (op == Operator::Divide && !isNonzeroLiteral(rightNode)) {
+          result = temporary(
+              ast[node].dataType,
+              std::string(isFloat ? "checkedDivideFloat(" : "checkedDivide(") +
+                  result + ", " + right + ", " + addErrorSite(opNode) + ")");
+        } else if (isFloat) {
+          result = "(" + result + floatOperators[static_cast<int>(op)] +
+                   right + ")";
+        } else {
+          result = std::string(intOperators[static_cast<int>(op)]) + "(" +
+                   result + ", " + right + ")";
+        }
+      }
+      return result;
+    }
+    default:
+      throw std::runtime_error("Unexpected expression type");
+  }
+}
+
+std::string CGenerator::generateLiteral(NodeId node) const {
+  if (ast[node].dataType == DataType::Int) {
+    std::int32_t value = static_cast<std::int32_t>(ast[node].value);
+    return value == INT32_MIN ? "INT32_MIN" : std::to_string(value);
+  }
+  double value = ast.getFloat(ast[node].value);
+  char text[64];
+  if (std::isfinite(value)) {
+    std::snprintf(text, sizeof(text), "%a", value);
+    return value < 0 ? std::string("(") + text + ")" : text;
+  }
+  std::uint64_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  std::snprintf(text, sizeof(text), "fromBits(UINT64_C(0x%016llx))",
+                static_cast<unsigned long long>(bits));
+  return text;
+}
+
+std::string CGenerator::temporary(DataType type, const std::string& value) {
+  std::string name = "t" + std::to_string(temporaries++);
+  line(std::string("const ") +
+       (type == DataType::Float ? "double " : "int32_t ") + name + " = " +
+       value + ";");
+  return name;
+}
+
+std::string CGenerator::addErrorSite(NodeId node) {
+  Position position = ast.getPosition(node);
+  errors.push_back(
+      RuntimeError(position, position, "Division by zero.").asString() + "\n");
+  return std::to_string(errors.size() - 1);
+}
+
+bool CGenerator::canFail(NodeId node) const {
+  if (ast[node].type == NodeType::Expression ||
+      ast[node].type == NodeType::Term) {
+    for (std::uint32_t i = 1; i < ast[node].childCount; i += 2) {
+      if (static_cast<Operator>(ast[ast.getChild(node, i)].op) ==
+              Operator::Divide &&
+          !isNonzeroLiteral(ast.getChild(node, i + 1))) {
+        return true;
+      }
+    }
+  }
+  for (const NodeId* child = ast.beginChildren(node);
+       child != ast.endChildren(node); child++) {
+    if (canFail(*child)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool CGenerator::isNonzeroLiteral(NodeId node) const {
+  if (ast[node].type != NodeType::Literal) {
+    return false;
+  }
+  if (ast[node].dataType == DataType::Float) {
+    return ast.getFloat(ast[node].value) != 0;
+  }
+  return ast[node].value != 0;
+}
+
+std::string CGenerator::variable(std::uint32_t slot) {
+  return "v" + std::to_string(slot);
+}
+
+std::string CGenerator::quote(const std::string& text) {
+  std::string result = "\"";
+  for (unsigned char c : text) {
+    if (c == '"' || c == '\\') {
+      result += '\\';
+      result += static_cast<char>(c);
+    } else if (c == '\n') {
+      result += "\\n";
+    } else if (c < 0x20 || c >= 0x7f) {
+      char escaped[8];
+      std::snprintf(escaped, sizeof(escaped), "\\%03o", c);
+      result += escaped;
+    } else {
+      result += static_cast<char>(c);
+    }
+  }
+  return result + "\"";
+}
@@ -0,0 +1,238 @@
+#include "compiler.h"
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+Compiler::Compiler(const AST& ast) : ast(ast), stackDepth(0) {}
+
+Chunk Compiler::compile() {
+  reset();
+  NodeId root = ast.getRoot();
+  for (const NodeId* child = ast.beginChildren(root);
+       child != ast.endChildren(root); child++) {
+    compileStatement(*child);
+  }
+  emit(OpCode::Halt, 0, root);
+  return std::move(chunk);
+}
+
+Chunk Compiler::compileLoop(NodeId node) {
+  reset();
+  compileWhileStatement(node);
+  emit(OpCode::Halt, 0, node);
+  return std::move(chunk);
+}
+
+void Compiler::reset() {
+  if (!ast.isResolved()) {
+    throw std::runtime_error("AST has not been resolved");
+  }
+  chunk = Chunk();
+  chunk.slotCount = ast.getSlotCount();
+  chunk.slotTypes.reserve(chunk.slotCount);
+  for (std::uint32_t slot = 0; slot < chunk.slotCount; slot++) {
+    chunk.slotTypes.push_back(ast.getSlotType(slot));
+  }
+  chunk.source = ast.getSource() != nullptr
+                     ? ast.getSource()->shared_from_this()
+                     : nullptr;
+  stackDepth = 0;
+}
+
+std::size_t Compiler::emit(OpCode op, std::int32_t operand, NodeId node) {
+  switch (op) {
+    case OpCode::Constant:
+    case OpCode::ConstantFloat:
+    case OpCode::Load:
+      stackDepth++;
+      break;
+    case OpCode::Store:
+    case OpCode::Add:
+    case OpCode::Subtract:
+    case OpCode::Multiply:
+    case OpCode::Divide:
+    case OpCode::AddFloat:
+    case OpCode::SubtractFloat:
+    case OpCode::MultiplyFloat:
+    case OpCode::DivideFloat:
+    case OpCode::Less:
+    case OpCode::Greater:
+    case OpCode::Equal:
+    case OpCode::NotEqual:
+    case OpCode::LessFloat:
+    case OpCode::GreaterFloat:
+    case OpCode::EqualFloat:
+    case OpCode::NotEqualFloat:
+    case OpCode::TripCountLess:
+    case OpCode::TripCountGreater:
+    case OpCode::TripCountEqual:
+    case OpCode::TripCountNotEqual:
+    case OpCode::JumpIfFalse:
+    case OpCode::Print:
+    case OpCode::PrintFloat:
+      stackDepth--;
+      break;
+    default:
+      break;
+  }
+  if (stackDepth > chunk.maxStack) {
+    chunk.maxStack = stackDepth;
+  }
+  chunk.code.push_back({op, operand});
+  chunk.positions.push_back(ast[node].position);
+  return chunk.code.size() - 1;
+}
+
+// Points a previously emitted jump at the next instruction.
+void Compiler::patchJump(std::size_t at) {
+  chunk.code[at].operand = static_cast<std::int32_t>(chunk.code.size());
+}
+
+void Compiler::compileStatement(NodeId node) {
+  switch (ast[node].type) {
+    case NodeType::VarDeclaration:
+      if (ast[node].childCount > 2) {  // Check for expression
+        compileExpression(ast.getChild(node, 2));
+        emit(OpCode::Store, ast[ast.getChild(node, 1)].value, node);
+      }
+      break;
+    case NodeType::Assignment:
+      compileExpression(ast.getChild(node, 1));
+      emit(OpCode::Store, ast[ast.getChild(node, 0)].value, node);
+      break;
+    case NodeType::PrintStatement: {
+      NodeId childNode = ast.getChild(node, 0);
+      if (ast[childNode].type == NodeType::StringLiteral) {
+        chunk.strings.push_back(ast.getString(ast[childNode].value));
+        emit(OpCode::PrintString,
+             static_cast<std::int32_t>(chunk.strings.size() - 1), node);
+      } else {
+        compileExpression(childNode);
+        emit(ast[childNode].dataType == DataType::Float ? OpCode::PrintFloat
+                                                         : OpCode::Print,
+             0, node);
+      }
+      break;
+    }
+    case NodeType::IfStatement:
+      compileIfStatement(node);
+      break;
+    case NodeType::WhileStatement:
+      compileWhileStatement(node);
+      break;
+    case NodeType::StatementList:
+      compileStatementList(node);
+      break;
+    default:
+      throw std::runtime_error("Unknown statement type.");
+  }
+}
+
+void Compiler::compileStatementList(NodeId node) {
+  for (const NodeId* child = ast.beginChildren(node);
+       child != ast.endChildren(node); child++) {
+    compileStatement(*child);
+  }
+}
+
+void Compiler::compileIfStatement(NodeId node) {
+  std::vector<std::size_t> jumpsToEnd;
+
+  std::size_t skipBody = compileCondition(ast.getChild(node, 0));
+  compileStatementList(ast.getChild(node, 1));
+
+  for (std::uint32_t i = 2; i < ast[node].childCount; i++) {
+    NodeId child = ast.getChild(node, i);
+    jumpsToEnd.push_back(emit(OpCode::Jump, 0, child));
+    patchJump(skipBody);
+    if (ast[child].type == NodeType::ElifStatement) {
+      skipBody = compileCondition(ast.getChild(child, 0));
+      compileStatementList(ast.getChild(child, 1));
+    } else {
+      compileStatementList(ast.getChild(child, 0));
+      skipBody = SIZE_MAX;
+    }
+  }
+
+  if (skipBody != SIZE_MAX) {
+    patchJump(skipBody);
+  }
+  for (std::size_t jump : jumpsToEnd) {
+    patchJump(jump);
+  }
+}
+
+void Compiler::compileWhileStatement(NodeId node) {
+  std::int32_t loopStart = static_cast<std::int32_t>(chunk.code.size());
+  std::size_t exitLoop = compileCondition(ast.getChild(node, 0));
+  compileStatementList(ast.getChild(node, 1));
+  emit(OpCode::Jump, loopStart, node);
+  patchJump(exitLoop);
+}
+
+// Emits the comparison and a JumpIfFalse, returning the jump to patch.
+std::size_t Compiler::compileCondition(NodeId node) {
+  static const OpCode comparisons[][4] = {
+      {OpCode::Less, OpCode::Greater, OpCode::Equal, OpCode::NotEqual},
+      {OpCode::LessFloat, OpCode::GreaterFloat, OpCode::EqualFloat,
+       OpCode::NotEqualFloat}};
+  compileExpression(ast.getChild(node, 0));
+  compileExpression(ast.getChild(node, 2));
+  NodeId comparator = ast.getChild(node, 1);
+  emit(comparisons[static_cast<int>(ast[node].dataType)][ast[comparator].op],
+       0, comparator);
+  return emit(OpCode::JumpIfFalse, 0, node);
+}
+
+void Compiler::compileExpression(NodeId node) {
+  static const OpCode operations[][4] = {
+      {OpCode::Add, OpCode::Subtract, OpCode::Multiply, OpCode::Divide},
+      {OpCode::AddFloat, OpCode::SubtractFloat, OpCode::MultiplyFloat,
+       OpCode::DivideFloat}};
+  bool isFloat = ast[node].dataType == DataType::Float;
+  switch (ast[node].type) {
+    case NodeType::Literal:
+      if (isFloat) {
+        chunk.floats.push_back(ast.getFloat(ast[node].value));
+        emit(OpCode::ConstantFloat,
+             static_cast<std::int32_t>(chunk.floats.size() - 1), node);
+      } else {
+        emit(OpCode::Constant, static_cast<std::int32_t>(ast[node].value),
+             node);
+      }
+      break;
+    case NodeType::Identifier:
+      emit(OpCode::Load, ast[node].value, node);
+      break;
+    case NodeType::UnaryMinus:
+      compileExpression(ast.getChild(node, 0));
+      emit(isFloat ? OpCode::NegateFloat : OpCode::Negate, 0, node);
+      break;
+    case NodeType::Convert:
+      compileExpression(ast.getChild(node, 0));
+      emit(isFloat ? OpCode::IntToFloat : OpCode::FloatToInt, 0, node);
+      break;
+    case NodeType::TripCount: {
+      static const OpCode tripCounts[] = {
+          OpCode::TripCountLess, OpCode::TripCountGreater,
+          OpCode::TripCountEqual, OpCode::TripCountNotEqual};
+      compileExpression(ast.getChild(node, 0));
+      compileExpression(ast.getChild(node, 1));
+      emit(tripCounts[ast[node].op], static_cast<std::int32_t>(ast[node].value),
+           node);
+      break;
+    }
+    case NodeType::Expression:
+    case NodeType::Term:
+      compileExpression(ast.getChild(node, 0));
+      for (std::uint32_t i = 1; i < ast[node].childCount; i += 2) {
+        NodeId opNode = ast.getChild(node, i);
+        compileExpression(ast.getChild(node, i + 1));
+        emit(operations[isFloat][ast[opNode].op], 0, opNode);
+      }
+      break;
+    default:
+      throw std::runtime_error("Invalid node type in expression.");
+  }
+}
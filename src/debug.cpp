@@ -1,19 +1,23 @@
 #include <iostream>
 #include <vector>
 #include "AST.h"
+#include "ir.h"
 #include "lexer.h"
-#include "parser.h"
 
-void printDebugInfo(Lexer& lexer, Parser& parser) {
+void printDebugInfo(Lexer& lexer, const AST& ast) {
   std::cout << "\nDebug info:";
 
-  std::vector<Token> tokens = lexer.getAllTokens();
+  const TokenBuffer& tokens = lexer.getAllTokens();
   std::cout << "\nTokens:\n";
-  for (const Token& token : tokens) {
-    std::cout << token.asString() << std::endl;
+  for (std::size_t i = 0; i < tokens.size(); i++) {
+    std::cout << tokens.get(i).asString() << std::endl;
   }
 
-  std::shared_ptr<ASTNode> root = parser.getAST();
   std::cout << "\nAST:\n";
-  std::cout << root->asString(0) << std::endl;
-}
\ No newline at end of file
+  std::cout << ast.asString(ast.getRoot(), 0) << std::endl;
+}
+
+void printIR(const AST& ast, const IRProgram& ir) {
+  std::cout << "\nIR:\n";
+  std::cout << ir.asString(ast) << std::endl;
+}
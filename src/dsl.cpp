@@ -0,0 +1,158 @@
+#include "dsl.h"
+#include <stdexcept>
+#include <utility>
+#include "compiler.h"
+#include "error.h"
+#include "folder.h"
+#include "lexer.h"
+#include "optimizer.h"
+#include "parser.h"
+#include "peephole.h"
+#include "resolver.h"
+#include "ssa.h"
+#include "typechecker.h"
+
+namespace dsl {
+
+namespace {
+
+// Finds the first top-level declaration of every parameter and takes its
+// initializer out, so the optimizers treat the variable's value as unknown.
+// The folded constant it had becomes the parameter's default.
+bool takeParameters(AST& ast,
+                    const std::vector<std::string>& names,
+                    std::vector<std::uint32_t>& slots,
+                    std::vector<Value>& defaults,
+                    std::string& error) {
+  std::unordered_map<std::string, NodeId> declarations;
+  for (const NodeId* child = ast.beginChildren(ast.getRoot());
+       child != ast.endChildren(ast.getRoot()); child++) {
+    if (ast[*child].type == NodeType::VarDeclaration) {
+      std::uint32_t slot = ast[ast.getChild(*child, 1)].value;
+      declarations.emplace(ast.getSlotName(slot), *child);
+    }
+  }
+
+  for (const std::string& name : names) {
+    auto it = declarations.find(name);
+    if (it == declarations.end()) {
+      error = "Not a top-level variable: '" + name + "'";
+      return false;
+    }
+    ASTNode& declaration = ast[it->second];
+    std::uint32_t slot = ast[ast.getChild(it->second, 1)].value;
+    slots.push_back(slot);
+    if (declaration.childCount <= 2) {
+      continue;
+    }
+    const ASTNode& initializer = ast[ast.getChild(it->second, 2)];
+    if (initializer.type != NodeType::Literal) {
+      error = "The initializer of parameter '" + name + "' is not constant";
+      return false;
+    }
+    if (initializer.dataType == DataType::Float) {
+      defaults[slot].f = ast.getFloat(initializer.value);
+    } else {
+      defaults[slot].i = static_cast<std::int32_t>(initializer.value);
+    }
+    declaration.childCount = 2;
+  }
+  return true;
+}
+
+}  // namespace
+
+std::shared_ptr<const Program> Program::compile(std::string_view text,
+                                                const CompileOptions& options,
+                                                std::string& error,
+                                                const std::string& name) {
+  std::shared_ptr<Program> program(new Program());
+  try {
+    Lexer lexer(Source::fromString(std::string(text), name));
+    Parser parser(lexer);
+    auto ast = parser.parse();
+    Resolver(*ast).resolve();
+    TypeChecker(*ast).check();
+    ConstantFolder(*ast).fold();
+
+    std::vector<std::uint32_t> slots;
+    program->variables.assign(ast->getSlotCount(), Value{});
+    if (!takeParameters(*ast, options.parameters, slots, program->variables,
+                        error)) {
+      return nullptr;
+    }
+    for (std::size_t i = 0; i < slots.size(); i++) {
+      program->parameters[options.parameters[i]] = {
+          slots[i], ast->getSlotType(slots[i])};
+    }
+
+    if (options.optimizeSSA) {
+      SSAOptimizer(*ast).optimize();
+    }
+    if (options.optimizeLoops) {
+      LoopOptimizer(*ast).optimize();
+    }
+    program->chunk = Compiler(*ast).compile();
+  } catch (const Error& e) {
+    error = e.asString();
+    return nullptr;
+  } catch (const std::exception& e) {
+    error = e.what();
+    return nullptr;
+  }
+
+  // The optimizers may add variables of their own.
+  program->variables.resize(program->chunk.slotCount, Value{});
+  if (options.jit) {
+    program->jit.compile(program->chunk);
+  }
+  if (options.superinstructions) {
+    Peephole(program->chunk).optimize();
+  }
+  return program;
+}
+
+Context::Context(std::shared_ptr<const Program> program,
+                 std::function<void(std::string_view text)> output,
+                 FlushPolicy flush)
+    : program(std::move(program)),
+      initial(this->program->variables),
+      out(std::move(output), flush),
+      vm(out) {}
+
+bool Context::set(const std::string& name, std::int32_t value) {
+  auto it = program->parameters.find(name);
+  if (it == program->parameters.end()) {
+    return false;
+  }
+  if (it->second.type == DataType::Float) {
+    initial[it->second.slot].f = value;
+  } else {
+    initial[it->second.slot].i = value;
+  }
+  return true;
+}
+
+bool Context::set(const std::string& name, double value) {
+  auto it = program->parameters.find(name);
+  if (it == program->parameters.end() || it->second.type != DataType::Float) {
+    return false;
+  }
+  initial[it->second.slot].f = value;
+  return true;
+}
+
+bool Context::run(std::string& error) {
+  variables = initial;
+  try {
+    vm.run(program->chunk, variables.data());
+  } catch (const Error& e) {
+    out.flush();
+    error = e.asString();
+    return false;
+  }
+  out.flush();
+  return true;
+}
+
+}  // namespace dsl
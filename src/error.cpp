@@ -4,7 +4,10 @@ Error::Error(const Position& posStart,
              const Position& posEnd,
              const std::string& errorName,
              const std::string& details)
-    : posStart(posStart),
+    : source(posStart.getSource() != nullptr
+                 ? posStart.getSource()->shared_from_this()
+                 : nullptr),
+      posStart(posStart),
       posEnd(posEnd),
       errorName(errorName),
       details(details) {}
@@ -14,7 +17,13 @@ std::string Error::asString() const {
                        std::to_string(posStart.getCol()) + "-" +
                        std::to_string(posEnd.getLine()) + ":" +
                        std::to_string(posEnd.getCol()) + " > " + errorName +
-                       ": " + details + "\n\n";
+                       ": " + details + "\n";
+  if (source != nullptr) {
+    int column = posStart.getCol();
+    result += "  " + std::string(source->lineText(posStart.getLine())) +
+              "\n  " + std::string(column > 0 ? column : 0, ' ') + "^\n";
+  }
+  result += "\n";
   return result;
 }
 
@@ -28,6 +37,11 @@ InvalidSyntaxError::InvalidSyntaxError(const Position& posStart,
                                        const std::string& details)
     : Error(posStart, posEnd, "Illegal Syntax", details) {}
 
+SemanticError::SemanticError(const Position& posStart,
+                             const Position& posEnd,
+                             const std::string& details)
+    : Error(posStart, posEnd, "Semantic Error", details) {}
+
 RuntimeError::RuntimeError(const Position& posStart,
                            const Position& posEnd,
                            const std::string& details)
@@ -0,0 +1,293 @@
+#include "folder.h"
+#include <algorithm>
+#include <stdexcept>
+#include "arithmetic.h"
+
+ConstantFolder::ConstantFolder(AST& ast) : ast(ast) {}
+
+template <>
+std::int32_t ConstantFolder::getConstant<std::int32_t>(NodeId node) const {
+  return static_cast<std::int32_t>(ast[node].value);
+}
+
+template <>
+double ConstantFolder::getConstant<double>(NodeId node) const {
+  return ast.getFloat(ast[node].value);
+}
+
+void ConstantFolder::fold() {
+  if (!ast.isResolved()) {
+    throw std::runtime_error("AST has not been resolved");
+  }
+  foldStatementList(ast.getRoot());
+}
+
+void ConstantFolder::foldStatement(NodeId node) {
+  switch (ast[node].type) {
+    case NodeType::VarDeclaration:
+      if (ast[node].childCount > 2) {  // Check for expression
+        foldExpression(ast.getChild(node, 2));
+      }
+      break;
+    case NodeType::Assignment:
+      foldExpression(ast.getChild(node, 1));
+      break;
+    case NodeType::PrintStatement:
+      if (ast[ast.getChild(node, 0)].type != NodeType::StringLiteral) {
+        foldExpression(ast.getChild(node, 0));
+      }
+      break;
+    case NodeType::IfStatement:
+      foldIfStatement(node);
+      break;
+    case NodeType::WhileStatement:
+      foldWhileStatement(node);
+      break;
+    case NodeType::StatementList:
+      foldStatementList(node);
+      break;
+    default:
+      throw std::runtime_error("Unknown statement type.");
+  }
+}
+
+void ConstantFolder::foldStatementList(NodeId node) {
+  // Folding may append to the AST's arrays, so children are visited by index
+  // rather than through pointers into them.
+  for (std::uint32_t i = 0; i < ast[node].childCount; i++) {
+    foldStatement(ast.getChild(node, i));
+  }
+}
+
+void ConstantFolder::foldIfStatement(NodeId node) {
+  std::vector<NodeId> clauses(ast.beginChildren(node), ast.endChildren(node));
+  // The new children of the if: the first live condition and its body, then
+  // the remaining live elif clauses and possibly an else.
+  std::vector<NodeId> kept;
+
+  // Index 1 stands for the if's own condition and body.
+  for (std::size_t i = 1; i < clauses.size(); i++) {
+    NodeId clause = (i == 1) ? node : clauses[i];
+    if (ast[clause].type == NodeType::ElseStatement) {
+      NodeId body = ast.getChild(clause, 0);
+      foldStatementList(body);
+      if (kept.empty()) {
+        ast[node] = ast[body];
+        return;
+      }
+      kept.push_back(clause);
+      break;
+    }
+
+    NodeId condition = (i == 1) ? clauses[0] : ast.getChild(clause, 0);
+    NodeId body = (i == 1) ? clauses[1] : ast.getChild(clause, 1);
+    Truth truth = foldCondition(condition);
+    if (truth == Truth::False) {
+      continue;
+    }
+    foldStatementList(body);
+    if (truth == Truth::True) {
+      // Every later clause is unreachable.
+      if (kept.empty()) {
+        ast[node] = ast[body];
+        return;
+      }
+      ASTNode& elseClause = ast[clause];
+      elseClause.type = NodeType::ElseStatement;
+      elseClause.firstChild++;
+      elseClause.childCount = 1;
+      kept.push_back(clause);
+      break;
+    }
+    if (kept.empty()) {
+      kept.push_back(condition);
+      kept.push_back(body);
+    } else {
+      kept.push_back(clause);
+    }
+  }
+
+  if (kept.empty()) {
+    makeEmpty(node);
+  } else if (kept.size() != clauses.size() ||
+             !std::equal(kept.begin(), kept.end(), clauses.begin())) {
+    ast.setChildren(node, kept.data(), static_cast<std::uint32_t>(kept.size()));
+  }
+}
+
+void ConstantFolder::foldWhileStatement(NodeId node) {
+  if (foldCondition(ast.getChild(node, 0)) == Truth::False) {
+    makeEmpty(node);
+    return;
+  }
+  foldStatementList(ast.getChild(node, 1));
+}
+
+ConstantFolder::Truth ConstantFolder::foldCondition(NodeId node) {
+  NodeId left = ast.getChild(node, 0);
+  NodeId right = ast.getChild(node, 2);
+  foldExpression(left);
+  foldExpression(right);
+  if (!isConstant(left) || !isConstant(right)) {
+    return Truth::Unknown;
+  }
+  if (ast[node].dataType == DataType::Float) {
+    return compare<double>(node);
+  }
+  return compare<std::int32_t>(node);
+}
+
+template <typename T>
+ConstantFolder::Truth ConstantFolder::compare(NodeId node) const {
+  T left = getConstant<T>(ast.getChild(node, 0));
+  T right = getConstant<T>(ast.getChild(node, 2));
+  bool result = false;
+  switch (static_cast<Comparator>(ast[ast.getChild(node, 1)].op)) {
+    case Comparator::Less:
+      result = left < right;
+      break;
+    case Comparator::Greater:
+      result = left > right;
+      break;
+    case Comparator::Equal:
+      result = left == right;
+      break;
+    case Comparator::NotEqual:
+      result = left != right;
+      break;
+  }
+  return result ? Truth::True : Truth::False;
+}
+
+void ConstantFolder::foldExpression(NodeId node) {
+  switch (ast[node].type) {
+    case NodeType::UnaryMinus: {
+      NodeId operand = ast.getChild(node, 0);
+      foldExpression(operand);
+      if (!isConstant(operand)) {
+        break;
+      }
+      if (ast[node].dataType == DataType::Float) {
+        makeConstant(node, arithmetic::negate(getConstant<double>(operand)));
+      } else {
+        makeConstant(node,
+                     arithmetic::negate(getConstant<std::int32_t>(operand)));
+      }
+      break;
+    }
+    case NodeType::Convert:
+      foldConvert(node);
+      break;
+    case NodeType::Expression:
+    case NodeType::Term:
+      if (ast[node].dataType == DataType::Float) {
+        foldOperands<double>(node);
+      } else {
+        foldOperands<std::int32_t>(node);
+      }
+      break;
+    default:
+      break;
+  }
+}
+
+void ConstantFolder::foldConvert(NodeId node) {
+  NodeId operand = ast.getChild(node, 0);
+  foldExpression(operand);
+  if (!isConstant(operand)) {
+    return;
+  }
+  if (ast[node].dataType == DataType::Float) {
+    makeConstant(node, arithmetic::toFloat(getConstant<std::int32_t>(operand)));
+  } else {
+    makeConstant(node, arithmetic::toInt(getConstant<double>(operand)));
+  }
+}
+
+template <typename T>
+void ConstantFolder::foldOperands(NodeId node) {
+  std::uint32_t count = ast[node].childCount;
+  for (std::uint32_t i = 0; i < count; i += 2) {
+    foldExpression(ast.getChild(node, i));
+  }
+
+  // Operators are left-associative, so only a constant prefix can be
+  // combined without reordering the operands.
+  NodeId first = ast.getChild(node, 0);
+  std::uint32_t end = 1;
+  if (isConstant(first)) {
+    T value = getConstant<T>(first);
+    for (; end + 1 < count; end += 2) {
+      NodeId right = ast.getChild(node, end + 1);
+      if (!isConstant(right)) {
+        break;
+      }
+      T rightValue = getConstant<T>(right);
+      switch (static_cast<Operator>(ast[ast.getChild(node, end)].op)) {
+        case Operator::Add:
+          value = arithmetic::add(value, rightValue);
+          continue;
+        case Operator::Subtract:
+          value = arithmetic::subtract(value, rightValue);
+          continue;
+        case Operator::Multiply:
+          value = arithmetic::multiply(value, rightValue);
+          continue;
+        case Operator::Divide:
+          if (rightValue != 0) {
+            value = arithmetic::divide(value, rightValue);
+            continue;
+          }
+          break;
+      }
+      break;
+    }
+
+    if (end >= count) {
+      makeConstant(node, value);
+      return;
+    }
+    if (end > 1) {
+      std::vector<NodeId> operands;
+      operands.push_back(ast.copyNode(first));
+      makeConstant(operands[0], value);
+      operands.insert(operands.end(), ast.beginChildren(node) + end,
+                      ast.endChildren(node));
+      ast.setChildren(node, operands.data(),
+                      static_cast<std::uint32_t>(operands.size()));
+    }
+  }
+
+  // An Expression or Term wrapping a single operand is replaced by it.
+  if (ast[node].childCount == 1) {
+    ast[node] = ast[ast.getChild(node, 0)];
+  }
+}
+
+bool ConstantFolder::isConstant(NodeId node) const {
+  return ast[node].type == NodeType::Literal;
+}
+
+void ConstantFolder::makeConstant(NodeId node, std::int32_t value) {
+  ASTNode& literal = ast[node];
+  literal.type = NodeType::Literal;
+  literal.op = static_cast<std::uint8_t>(DataType::Int);
+  literal.dataType = DataType::Int;
+  literal.childCount = 0;
+  literal.value = static_cast<std::uint32_t>(value);
+}
+
+void ConstantFolder::makeConstant(NodeId node, double value) {
+  std::uint32_t index = ast.addFloat(value);
+  ASTNode& literal = ast[node];
+  literal.type = NodeType::Literal;
+  literal.op = static_cast<std::uint8_t>(DataType::Float);
+  literal.dataType = DataType::Float;
+  literal.childCount = 0;
+  literal.value = index;
+}
+
+void ConstantFolder::makeEmpty(NodeId node) {
+  ast[node].type = NodeType::StatementList;
+  ast[node].childCount = 0;
+}
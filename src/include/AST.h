@@ -1,10 +1,13 @@
 #pragma once
-#include <map>
+#include <cstdint>
 #include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
+#include "position.h"
+#include "source.h"
 
-enum class NodeType {
+enum class NodeType : std::uint8_t {
   Program,
   Expression,
   Term,
@@ -24,26 +27,126 @@ enum class NodeType {
   ElseStatement,
   Comparison,
   Comparator,
-  StatementList
+  StatementList,
+  Convert,
+  TripCount
 };
 
+enum class Operator : std::uint8_t { Add, Subtract, Multiply, Divide };
+
+enum class Comparator : std::uint8_t { Less, Greater, Equal, NotEqual };
+
+enum class DataType : std::uint8_t { Int, Float };
+
 struct VariableInfo {
   std::string name;
   std::string dataType;
 };
 
-class ASTNode {
+using NodeId = std::uint32_t;
+
+// One AST node. Nodes live in a single array owned by the AST and refer to
+// each other by index; the children of a node are a contiguous range of the
+// AST's child list.
+//
+// op holds the Operator, Comparator or DataType of the matching node types.
+// dataType is the static type of an expression, a Comparison's operands or a
+// Convert's result; the TypeChecker fills it in.
+// value is the interned name of an Identifier (its variable slot once the
+// resolver has run) and the string pool index of a StringLiteral. A Literal
+// is decoded by the parser: op is its DataType, and value holds the bits of
+// an int or the index of a float in the AST's float pool.
+// A TripCount, which the LoopOptimizer creates, counts the iterations of a
+// loop `while (i op bound): i = i + step` with its children i and bound: op
+// is its Comparator and value the bits of step.
+// position is the source offset of the node's first token.
+struct ASTNode {
+  NodeType type;
+  std::uint8_t op;
+  DataType dataType;
+  std::uint32_t firstChild;
+  std::uint32_t childCount;
+  std::uint32_t value;
+  std::uint32_t position;
+};
+
+// All nodes of one program, bump-allocated into a few flat arrays and freed
+// together with the AST.
+class AST {
  public:
-  ASTNode(NodeType type);
-  void addChild(std::shared_ptr<ASTNode> child) { children.push_back(child); }
+  AST();
 
-  static std::map<NodeType, std::string> nodeNames;
+  NodeId addNode(NodeType type,
+                 std::uint32_t position,
+                 const NodeId* children = nullptr,
+                 std::uint32_t childCount = 0,
+                 std::uint8_t op = 0,
+                 std::uint32_t value = 0);
 
-  NodeType type;
-  std::vector<std::shared_ptr<ASTNode>> children;
-  std::string value;
+  const ASTNode& operator[](NodeId id) const { return nodes[id]; }
+  ASTNode& operator[](NodeId id) { return nodes[id]; }
+
+  NodeId getChild(NodeId id, std::uint32_t index) const {
+    return children[nodes[id].firstChild + index];
+  }
+  const NodeId* beginChildren(NodeId id) const {
+    return children.data() + nodes[id].firstChild;
+  }
+  const NodeId* endChildren(NodeId id) const {
+    return beginChildren(id) + nodes[id].childCount;
+  }
 
-  std::string asString(int depth) const;
+  // Replaces the children of a node with a new contiguous range.
+  void setChildren(NodeId id, const NodeId* childIds, std::uint32_t count);
+  NodeId copyNode(NodeId id);
 
-  std::string nodeName;
-};
\ No newline at end of file
+  std::uint32_t addString(std::string_view text);
+  const std::string& getString(std::uint32_t index) const;
+  std::uint32_t addFloat(double value);
+  double getFloat(std::uint32_t index) const;
+
+  void setNames(std::vector<std::string> names);
+  std::uint32_t addName(std::string name);
+  std::uint32_t getNameCount() const;
+  const std::string& getName(std::uint32_t id) const;
+  const std::string& getIdentifierName(NodeId id) const;
+
+  // Variable slots handed out by the resolver, each remembering its name.
+  std::uint32_t addSlot(std::uint32_t nameId);
+  std::uint32_t getSlotCount() const;
+  const std::string& getSlotName(std::uint32_t slot) const;
+  void setSlotType(std::uint32_t slot, DataType type);
+  DataType getSlotType(std::uint32_t slot) const;
+  // Gives the first slots, before any other is added, to variables declared
+  // before the program, by earlier inputs of a REPL session.
+  void setGlobals(std::vector<std::uint32_t> nameIds,
+                  const std::vector<DataType>& types);
+  std::uint32_t getGlobalCount() const;
+  void setResolved();
+  bool isResolved() const;
+
+  void setSource(std::shared_ptr<const Source> source);
+  const Source* getSource() const;
+  Position getPosition(NodeId id) const;
+
+  void setRoot(NodeId id);
+  NodeId getRoot() const;
+  std::size_t size() const;
+
+  std::string asString(NodeId id, int depth) const;
+
+  static const char* getNodeName(NodeType type);
+
+ private:
+  std::vector<ASTNode> nodes;
+  std::vector<NodeId> children;
+  std::vector<std::string> strings;
+  std::vector<double> floats;
+  std::vector<std::string> names;
+  std::vector<std::uint32_t> slotNames;
+  std::vector<DataType> slotTypes;
+  std::uint32_t globalCount;
+  std::shared_ptr<const Source> source;
+  NodeId root;
+  bool resolved;
+};
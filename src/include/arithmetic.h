@@ -0,0 +1,138 @@
+#pragma once
+#include <cstdint>
+#include <limits>
+
+// Numeric semantics shared by every execution engine: 32-bit two's
+// complement int arithmetic that wraps on overflow, and IEEE double float
+// arithmetic. Division by zero is the only operation that can fail, for
+// either type; callers check for it before dividing.
+namespace arithmetic {
+
+inline int add(int left, int right) {
+  return static_cast<int>(static_cast<std::uint32_t>(left) +
+                          static_cast<std::uint32_t>(right));
+}
+
+inline int subtract(int left, int right) {
+  return static_cast<int>(static_cast<std::uint32_t>(left) -
+                          static_cast<std::uint32_t>(right));
+}
+
+inline int multiply(int left, int right) {
+  return static_cast<int>(static_cast<std::uint32_t>(left) *
+                          static_cast<std::uint32_t>(right));
+}
+
+inline int negate(int value) {
+  return static_cast<int>(0u - static_cast<std::uint32_t>(value));
+}
+
+// Truncates towards zero; INT_MIN / -1 wraps to INT_MIN.
+inline int divide(int left, int right) {
+  if (right == -1) {
+    return negate(left);
+  }
+  return left / right;
+}
+
+inline double add(double left, double right) {
+  return left + right;
+}
+
+inline double subtract(double left, double right) {
+  return left - right;
+}
+
+inline double multiply(double left, double right) {
+  return left * right;
+}
+
+inline double negate(double value) {
+  return -value;
+}
+
+inline double divide(double left, double right) {
+  return left / right;
+}
+
+inline double toFloat(int value) {
+  return static_cast<double>(value);
+}
+
+// Truncates towards zero, saturating out-of-range values; NaN becomes 0.
+inline int toInt(double value) {
+  if (!(value == value)) {
+    return 0;
+  }
+  if (value >= 2147483647.0) {
+    return std::numeric_limits<int>::max();
+  }
+  if (value <= -2147483648.0) {
+    return std::numeric_limits<int>::min();
+  }
+  return static_cast<int>(value);
+}
+
+// The number of iterations of `while (i < bound): i = i + step`, worked out
+// without running it, or -1 when the loop does not end before i wraps
+// around, or runs more than INT_MAX times. The others likewise for the
+// other comparators.
+inline int tripCountLess(int i, int bound, int step) {
+  if (i >= bound) {
+    return 0;
+  }
+  if (step <= 0) {
+    return -1;
+  }
+  std::int64_t count =
+      (static_cast<std::int64_t>(bound) - i - 1) / step + 1;
+  if (count * step > std::numeric_limits<int>::max() -
+                         static_cast<std::int64_t>(i) ||
+      count > std::numeric_limits<int>::max()) {
+    return -1;
+  }
+  return static_cast<int>(count);
+}
+
+inline int tripCountGreater(int i, int bound, int step) {
+  if (i <= bound) {
+    return 0;
+  }
+  if (step >= 0) {
+    return -1;
+  }
+  std::int64_t stride = -static_cast<std::int64_t>(step);
+  std::int64_t count =
+      (static_cast<std::int64_t>(i) - bound - 1) / stride + 1;
+  if (count * stride > static_cast<std::int64_t>(i) -
+                           std::numeric_limits<int>::min() ||
+      count > std::numeric_limits<int>::max()) {
+    return -1;
+  }
+  return static_cast<int>(count);
+}
+
+inline int tripCountEqual(int i, int bound, int step) {
+  if (i != bound) {
+    return 0;
+  }
+  return step == 0 ? -1 : 1;
+}
+
+inline int tripCountNotEqual(int i, int bound, int step) {
+  if (i == bound) {
+    return 0;
+  }
+  if (step == 0) {
+    return -1;
+  }
+  std::int64_t distance = static_cast<std::int64_t>(bound) - i;
+  std::int64_t count = distance / step;
+  if (distance % step != 0 || count < 0 ||
+      count > std::numeric_limits<int>::max()) {
+    return -1;
+  }
+  return static_cast<int>(count);
+}
+
+}  // namespace arithmetic
@@ -0,0 +1,49 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "pool.h"
+
+// Runs many independent scripts on a WorkStealingPool. What each script
+// prints is collected in a buffer of its own, and written out in the order
+// the scripts were given, preceded by a "==> path <==" line, as soon as
+// every script before it is done; its error, if any, goes to stderr.
+class BatchRunner {
+ public:
+  // Runs the script at path, appending what it prints to output. Returns
+  // false, with a message in error, when it could not be opened, compiled or
+  // run to the end.
+  using Script = std::function<bool(const std::string& path,
+                                    std::string& output,
+                                    std::string& error)>;
+
+  BatchRunner(std::vector<std::string> paths, unsigned threads = 0);
+
+  // Replaces every directory with the .dsl files below it, sorted, and every
+  // argument of the form @file with the paths listed in file, one per line.
+  // Returns false, and reports why on stderr, when one cannot be read.
+  static bool expand(const std::vector<std::string>& arguments,
+                     std::vector<std::string>& paths);
+
+  // Returns the number of scripts that failed.
+  std::size_t run(const Script& script);
+
+ private:
+  struct Result {
+    std::string output;
+    std::string error;
+    bool done = false;
+    bool failed = false;
+  };
+
+  std::vector<std::string> paths;
+  WorkStealingPool pool;
+  std::vector<Result> results;
+  std::mutex mutex;
+  std::size_t written;
+  std::size_t failures;
+
+  void finish();
+};
@@ -0,0 +1,121 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "AST.h"
+#include "source.h"
+#include "value.h"
+
+// Instructions of the stack machine run by the VM. Operands are immediate:
+// a constant, a variable slot, a jump target or a string or float index.
+// Arithmetic, comparisons and printing come in an int and a float flavour,
+// picked at compile time from the static types.
+enum class OpCode : std::uint8_t {
+  Constant,       // push operand
+  ConstantFloat,  // push floats[operand]
+  Load,           // push variables[operand]
+  Store,          // variables[operand] = pop
+  Add,            // push (pop2 + pop1), likewise for the other binary ops
+  Subtract,
+  Multiply,
+  Divide,
+  Negate,
+  AddFloat,
+  SubtractFloat,
+  MultiplyFloat,
+  DivideFloat,
+  NegateFloat,
+  IntToFloat,
+  FloatToInt,
+  Less,  // push 1 when pop2 < pop1, else 0
+  Greater,
+  Equal,
+  NotEqual,
+  LessFloat,
+  GreaterFloat,
+  EqualFloat,
+  NotEqualFloat,
+  TripCountLess,  // push arithmetic::tripCountLess(pop2, pop1, operand)
+  TripCountGreater,
+  TripCountEqual,
+  TripCountNotEqual,
+  // Superinstructions, selected by the Peephole pass. Each one takes the
+  // place of the first instruction of the sequence it fuses, reads its
+  // other operands from the rest (code[i + 1] to code[i + 3]) and skips them.
+  //
+  // Load, Load, Less, JumpIfFalse: continue at the jump's target unless
+  // variables[operand] < variables[code[i + 1].operand].
+  BranchLess,
+  BranchGreater,
+  BranchEqual,
+  BranchNotEqual,
+  // Load, Constant, Less, JumpIfFalse.
+  BranchLessConstant,
+  BranchGreaterConstant,
+  BranchEqualConstant,
+  BranchNotEqualConstant,
+  // Load, Constant, Add, Store: the store's variable becomes
+  // variables[operand] + code[i + 1].operand.
+  AddConstant,
+  SubtractConstant,
+  Jump,         // continue at operand
+  JumpIfFalse,  // continue at operand when pop is 0
+  Print,        // print pop
+  PrintFloat,
+  PrintString,  // print strings[operand]
+  Native,       // run natives[operand], then continue at its exit
+  Halt
+};
+
+struct Instruction {
+  OpCode op;
+  std::int32_t operand;
+};
+
+// Machine code for one loop of a chunk, installed by the Jit. It runs on the
+// variable array and returns -1, or the index of the instruction that failed
+// (a division by zero).
+using NativeFunction = std::int32_t (*)(Value* variables);
+
+struct NativeLoop {
+  NativeFunction entry;
+  std::int32_t exit;
+};
+
+// Identifies a Chunk for as long as the program runs. A new one is drawn
+// whenever a Chunk is made, copied or assigned to, so a Chunk that takes the
+// place or the address of another is never mistaken for it.
+class ChunkId {
+ public:
+  ChunkId() : value(next()) {}
+  ChunkId(const ChunkId&) : value(next()) {}
+  ChunkId& operator=(const ChunkId&) {
+    value = next();
+    return *this;
+  }
+  std::uint64_t get() const { return value; }
+
+ private:
+  std::uint64_t value;
+
+  static std::uint64_t next();
+};
+
+// A compiled program or loop: straight-line code with jumps, plus the source
+// offset each instruction came from for error messages.
+struct Chunk {
+  std::vector<Instruction> code;
+  std::vector<std::uint32_t> positions;
+  std::vector<std::string> strings;
+  std::vector<double> floats;
+  std::vector<NativeLoop> natives;
+  std::vector<DataType> slotTypes;
+  std::uint32_t slotCount = 0;
+  std::uint32_t maxStack = 0;
+  std::shared_ptr<const Source> source;
+  ChunkId id;
+
+  std::string asString() const;
+  static const char* getOpName(OpCode op);
+};
@@ -0,0 +1,47 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include "bytecode.h"
+
+// Compiled chunks saved to disk, so that running an unchanged script again
+// skips the lexer, the parser and every compiler pass.
+//
+// A cache file holds a header followed by the chunk's flattened arrays:
+//
+//   header   magic "DSLC", format version, FNV-1a hash and size of the
+//            script, the options it was compiled with, the counts below
+//            and a checksum of the whole file
+//   code     8 bytes per instruction: opcode, 3 zero bytes, operand
+//   floats   the float pool, as doubles
+//   positions, string lengths (uint32 each), slot types (a byte each)
+//   the string pool, concatenated
+//
+// Everything is in the byte order of the machine that wrote it; a file
+// from another kind of machine fails the magic check. A cache is only used
+// when its version, hash, size and options all match, and is read through a
+// memory mapping where there is one. A loaded chunk is checked before it
+// runs, so that a damaged file is treated as a stale one. Native loops are
+// not cached: the Jit compiles a loaded chunk again, and the Peephole pass
+// runs on it again.
+namespace ChunkCache {
+
+// Bumped whenever the layout or the OpCode numbering changes.
+constexpr std::uint32_t VERSION = 2;
+
+std::uint64_t hash(std::string_view text);
+
+// Fills in chunk from the cache file at path, unless the file is missing,
+// stale or damaged. The chunk's source is left for the caller to set.
+// Chunks are saved as the Compiler produced them, before the Jit and the
+// Peephole pass.
+bool load(const std::string& path,
+          std::string_view text,
+          std::uint32_t options,
+          Chunk& chunk);
+bool save(const std::string& path,
+          std::string_view text,
+          std::uint32_t options,
+          const Chunk& chunk);
+
+}  // namespace ChunkCache
@@ -0,0 +1,48 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "AST.h"
+
+// Translates a resolved, type-checked AST into a standalone C99 program
+// that prints exactly what the interpreter would. Variables become locals
+// of main; int arithmetic goes through small helpers that wrap around like
+// the interpreter's. Runtime errors are rendered while translating, so the
+// program only has to print the message of the division that failed, after
+// which it exits with status 1.
+//
+// The program must not contain TripCount nodes: the C compiler optimizes
+// loops by itself, so the LoopOptimizer is not run first.
+class CGenerator {
+ public:
+  CGenerator(const AST& ast);
+  std::string generate();
+
+  // Builds an executable from C source with the compiler named by $CC, or
+  // cc, which reports its own errors. Returns whether that succeeded.
+  static bool buildExecutable(const std::string& source,
+                              const std::string& output);
+
+ private:
+  const AST& ast;
+  std::string code;
+  std::vector<std::string> errors;
+  std::uint32_t temporaries;
+  int depth;
+
+  void line(const std::string& text);
+  void generateStatement(NodeId node);
+  void generateStatementList(NodeId node);
+  void generateIfStatement(NodeId node);
+  void generateWhileStatement(NodeId node);
+  std::string generateCondition(NodeId node);
+  std::string generateExpression(NodeId node);
+  std::string generateLiteral(NodeId node) const;
+  std::string temporary(DataType type, const std::string& value);
+  std::string addErrorSite(NodeId node);
+  bool canFail(NodeId node) const;
+  bool isNonzeroLiteral(NodeId node) const;
+
+  static std::string variable(std::uint32_t slot);
+  static std::string quote(const std::string& text);
+};
@@ -0,0 +1,34 @@
+#pragma once
+#include <cstdint>
+#include "AST.h"
+#include "bytecode.h"
+
+// Lowers a resolved, type-checked AST into bytecode for the VM. Conditions
+// compile to a comparison followed by a conditional jump; if/elif/else and
+// while become forward and backward jumps.
+//
+// compileLoop() compiles a single while statement instead of the program,
+// for a loop that the Interpreter hands over to the VM while it runs: the
+// chunk starts at the loop's condition and halts when the loop exits.
+class Compiler {
+ public:
+  Compiler(const AST& ast);
+  Chunk compile();
+  Chunk compileLoop(NodeId node);
+
+ private:
+  const AST& ast;
+  Chunk chunk;
+  std::uint32_t stackDepth;
+
+  void reset();
+  void compileStatement(NodeId node);
+  void compileStatementList(NodeId node);
+  void compileIfStatement(NodeId node);
+  void compileWhileStatement(NodeId node);
+  std::size_t compileCondition(NodeId node);
+  void compileExpression(NodeId node);
+
+  std::size_t emit(OpCode op, std::int32_t operand, NodeId node);
+  void patchJump(std::size_t at);
+};
@@ -0,0 +1,99 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "bytecode.h"
+#include "jit.h"
+#include "output.h"
+#include "value.h"
+#include "vm.h"
+
+// The API of libdsl, for running scripts inside another program. A script is
+// compiled once into a Program, which never changes afterwards and can be
+// shared by any number of threads. Each thread runs it through Contexts of
+// its own, which are cheap to create and to run again:
+//
+//   std::string error;
+//   dsl::CompileOptions options;
+//   options.parameters = {"n"};
+//   auto program = dsl::Program::compile(text, options, error);
+//   dsl::Context context(program, [](std::string_view text) { ... });
+//   context.set("n", 10);
+//   if (!context.run(error)) { ... }
+namespace dsl {
+
+struct CompileOptions {
+  bool optimizeSSA = true;
+  bool optimizeLoops = true;
+  bool superinstructions = true;
+  // Compiles the loops it can to machine code (x86-64 Linux only).
+  bool jit = false;
+  // Top-level variables that a Context gives initial values. The
+  // initializer of a parameter's `var` declaration, which must be constant,
+  // only provides the value it starts with when the Context sets none.
+  std::vector<std::string> parameters;
+};
+
+class Program {
+ public:
+  // Returns null, with the message of the first error in error, when the
+  // script does not compile.
+  static std::shared_ptr<const Program> compile(
+      std::string_view text,
+      const CompileOptions& options,
+      std::string& error,
+      const std::string& name = "<input>");
+
+  Program(const Program&) = delete;
+  Program& operator=(const Program&) = delete;
+
+ private:
+  struct Parameter {
+    std::uint32_t slot;
+    DataType type;
+  };
+
+  Program() = default;
+
+  Chunk chunk;
+  // Owns the machine code of the chunk's native loops.
+  Jit jit;
+  std::unordered_map<std::string, Parameter> parameters;
+  // The variables at the start of a run, holding the parameter defaults.
+  std::vector<Value> variables;
+
+  friend class Context;
+};
+
+// The state of one run of a Program at a time. A Context must only be used
+// by one thread at once, but can run its program any number of times.
+class Context {
+ public:
+  // output receives what the program prints, in pieces of whole lines, by
+  // the end of every run.
+  Context(std::shared_ptr<const Program> program,
+          std::function<void(std::string_view text)> output,
+          FlushPolicy flush = FlushPolicy::Size);
+
+  // Set the initial value of a parameter for the following runs. Returns
+  // false when the program has no such parameter, or when it is an int and
+  // value a float.
+  bool set(const std::string& name, std::int32_t value);
+  bool set(const std::string& name, double value);
+  // Runs the program from the start. Returns false, with the message in
+  // error, when it stops on a runtime error.
+  bool run(std::string& error);
+
+ private:
+  std::shared_ptr<const Program> program;
+  std::vector<Value> initial;
+  std::vector<Value> variables;
+  Output out;
+  VM vm;
+};
+
+}  // namespace dsl
@@ -1,6 +1,7 @@
 #ifndef ERROR_H
 #define ERROR_H
 
+#include <memory>
 #include <string>
 #include "position.h"
 
@@ -14,6 +15,8 @@ class Error {
   std::string asString() const;
 
  private:
+  // Keeps the source alive so the positions stay valid after the lexer is gone.
+  std::shared_ptr<const Source> source;
   Position posStart;
   Position posEnd;
   std::string errorName;
@@ -34,6 +37,13 @@ class InvalidSyntaxError : public Error {
                      const std::string& details);
 };
 
+class SemanticError : public Error {
+ public:
+  SemanticError(const Position& posStart,
+                const Position& posEnd,
+                const std::string& details);
+};
+
 class RuntimeError : public Error {
  public:
   RuntimeError(const Position& posStart,
@@ -0,0 +1,41 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "AST.h"
+
+// Runs after the TypeChecker. Arithmetic and conversions on literals are
+// evaluated once here instead of on every execution, with the same semantics
+// as the engines; a division by a constant zero is left in place so that it
+// still fails at run time.
+//
+// Conditions that fold to a constant decide their branch statically: dead
+// if/elif/else branches and never-entered loops are pruned, and a statement
+// may be replaced by the StatementList of the branch that is always taken.
+class ConstantFolder {
+ public:
+  ConstantFolder(AST& ast);
+  void fold();
+
+ private:
+  enum class Truth { False, True, Unknown };
+
+  AST& ast;
+
+  void foldStatement(NodeId node);
+  void foldStatementList(NodeId node);
+  void foldIfStatement(NodeId node);
+  void foldWhileStatement(NodeId node);
+  void foldExpression(NodeId node);
+  void foldConvert(NodeId node);
+  template <typename T>
+  void foldOperands(NodeId node);
+  Truth foldCondition(NodeId node);
+  template <typename T>
+  Truth compare(NodeId node) const;
+  bool isConstant(NodeId node) const;
+  template <typename T>
+  T getConstant(NodeId node) const;
+  void makeConstant(NodeId node, std::int32_t value);
+  void makeConstant(NodeId node, double value);
+  void makeEmpty(NodeId node);
+};
@@ -0,0 +1,41 @@
+#ifndef INTERNER_H
+#define INTERNER_H
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+// Keywords are interned first, so their ids are fixed and a token is a
+// keyword exactly when its id is below KEYWORD_COUNT.
+enum Keyword : std::uint32_t {
+  KEYWORD_IF,
+  KEYWORD_ELIF,
+  KEYWORD_ELSE,
+  KEYWORD_WHILE,
+  KEYWORD_VAR,
+  KEYWORD_INT,
+  KEYWORD_FLOAT,
+  KEYWORD_PRINT,
+  KEYWORD_RUN,
+  KEYWORD_COUNT
+};
+
+// Maps every distinct identifier spelling to a small integer id, so the
+// parser and later passes compare names as integers.
+class Interner {
+ public:
+  Interner();
+
+  std::uint32_t intern(std::string_view name);
+  const std::string& getName(std::uint32_t id) const;
+  std::size_t size() const;
+
+ private:
+  // A deque never moves its elements, so the views used as keys stay valid.
+  std::deque<std::string> names;
+  std::unordered_map<std::string_view, std::uint32_t> ids;
+};
+
+#endif
@@ -1,32 +1,95 @@
 #pragma once
+#include <cstdint>
 #include <iostream>
 #include <memory>
 #include <string>
+#include <unordered_map>
+#include <vector>
 #include "AST.h"
+#include "bytecode.h"
 #include "error.h"
+#include "jit.h"
+#include "output.h"
+#include "profile.h"
+#include "value.h"
+#include "vm.h"
 
+// Controls when loops leave the tree walker. A loop whose iterations, summed
+// over all of its executions, reach the threshold is compiled on its own and
+// finished by the VM, or as native code where the JIT accepts it.
+struct TieringOptions {
+  bool enabled = false;
+  std::uint32_t threshold = 1000;
+  bool useJit = true;
+  bool superinstructions = true;
+  // Reports every tier-up, and a summary at the end, on stderr.
+  bool stats = false;
+};
+
+// Walks a resolved and type-checked AST. Variables live in a flat array
+// indexed by the slots the Resolver assigned. Every expression is evaluated
+// either as int or as double, as decided by the TypeChecker.
+//
+// Given a Profile, it records into it how often each statement runs and for
+// how long, how many iterations each loop makes and which branches of each
+// if are taken, and no loop is tiered up. The statements are executed by a
+// second instantiation of their functions for that, so that a run without
+// a Profile does not pay for it.
 class Interpreter {
-  std::unordered_map<std::string, std::optional<int>> symbolTable;
+  std::vector<Value> variables;
 
  public:
-  Interpreter();
-  int interpret(std::shared_ptr<ASTNode> root);
+  Interpreter(const TieringOptions& tiering,
+              Output& out,
+              Profile* profile = nullptr);
+  int interpret(const AST& ast);
 
  private:
-  void executeStatement(std::shared_ptr<ASTNode> node);
-  void executeVarDeclaration(std::shared_ptr<ASTNode> node);
-  void executeAssignment(std::shared_ptr<ASTNode> node);
-  void executeIfStatement(std::shared_ptr<ASTNode> node);
-  void executeWhileStatement(std::shared_ptr<ASTNode> node);
-  void executeStatementList(std::shared_ptr<ASTNode> node);
-  bool evaluateCondition(std::shared_ptr<ASTNode> node);
-  int visit(std::shared_ptr<ASTNode> node);
-  int visitExpression(std::shared_ptr<ASTNode> node);
-  int visitIdentifier(std::shared_ptr<ASTNode> node);
-  int visitTerm(std::shared_ptr<ASTNode> node);
-  int visitFactor(std::shared_ptr<ASTNode> node);
-  int visitLiteral(std::shared_ptr<ASTNode> node);
-  int visitUnaryMinus(std::shared_ptr<ASTNode> node);
-  int visitPrintStatement(std::shared_ptr<ASTNode> node);
-  int visitOperator(std::shared_ptr<ASTNode> node);
+  struct HotLoop {
+    std::uint32_t iterations = 0;
+    std::unique_ptr<Chunk> chunk;
+  };
+
+  const AST* ast;
+  TieringOptions tiering;
+  Output& out;
+  Profile* profile;
+  std::unordered_map<NodeId, HotLoop> loops;
+  VM vm;
+  Jit jit;
+
+  template <bool PROFILE>
+  void executeProgram(NodeId root);
+  template <bool PROFILE>
+  void executeStatement(NodeId node);
+  void executeVarDeclaration(NodeId node);
+  void executeAssignment(NodeId node);
+  template <bool PROFILE>
+  void executeIfStatement(NodeId node);
+  template <bool PROFILE>
+  void executeWhileStatement(NodeId node);
+  void tierUp(NodeId node, HotLoop& loop);
+  void printTieringStats() const;
+  template <bool PROFILE>
+  void executeStatementList(NodeId node);
+  void store(NodeId identifier, NodeId expression);
+  bool evaluateCondition(NodeId node);
+  template <typename T>
+  bool compare(NodeId node);
+  template <typename T>
+  T visit(NodeId node);
+  template <typename T>
+  T visitExpression(NodeId node);
+  template <typename T>
+  T visitIdentifier(NodeId node);
+  template <typename T>
+  T visitTerm(NodeId node);
+  template <typename T>
+  T visitLiteral(NodeId node);
+  template <typename T>
+  T visitUnaryMinus(NodeId node);
+  template <typename T>
+  T visitConvert(NodeId node);
+  std::int32_t visitTripCount(NodeId node);
+  void visitPrintStatement(NodeId node);
 };
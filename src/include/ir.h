@@ -0,0 +1,74 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "AST.h"
+
+using ValueId = std::uint32_t;
+
+constexpr std::uint32_t IR_NONE = UINT32_MAX;
+
+enum class IROp : std::uint8_t {
+  Constant,
+  Undefined,
+  Phi,
+  Add,
+  Subtract,
+  Multiply,
+  Divide,
+  Negate,
+  IntToFloat,
+  FloatToInt,
+  Less,
+  Greater,
+  Equal,
+  NotEqual
+};
+
+// One SSA value. type is the type of the result, or of the operands for a
+// comparison, whose result is 0 or 1.
+struct IRValue {
+  IROp op;
+  DataType type;
+  std::uint32_t slot;  // Phi and Undefined: the variable
+  std::uint64_t bits;  // Constant: the int, or the bits of the double
+  // A phi has one operand per predecessor of its block, in the same order.
+  std::vector<ValueId> operands;
+  // A phi that turned out to always equal another value forwards to it.
+  ValueId replacement;
+};
+
+enum class IRKind : std::uint8_t {
+  Value,        // defines value
+  Store,        // variables[operand] = value
+  Print,        // print value
+  PrintString,  // print strings[operand]
+  Jump,         // continue at targets[0]
+  Branch        // continue at targets[0] if value, else at targets[1]
+};
+
+struct IRInstruction {
+  IRKind kind;
+  ValueId value;
+  std::uint32_t operand;
+  std::uint32_t targets[2];
+  // A store the SSAOptimizer deleted from the AST.
+  bool removed;
+};
+
+struct IRBlock {
+  std::vector<IRInstruction> code;
+  std::vector<std::uint32_t> predecessors;
+};
+
+// A program in SSA form: basic blocks of instructions, with the pure values
+// they compute numbered so that equal computations share one value.
+// Constants are not placed in any block.
+struct IRProgram {
+  std::vector<IRBlock> blocks;
+  std::vector<IRValue> values;
+
+  ValueId resolve(ValueId value) const;
+  bool isConstant(ValueId value) const;
+  std::string asString(const AST& ast) const;
+};
@@ -0,0 +1,35 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+#include "bytecode.h"
+
+// Compiles while loops of a Chunk to x86-64 machine code. A loop qualifies
+// when it holds nothing but int/float arithmetic, conversions, loads and
+// stores, comparisons and jumps that stay inside it, i.e. no print; its
+// most used variables are kept in registers while it runs. The first
+// instruction of a compiled loop becomes a Native instruction, and anything
+// that is not compiled keeps running in the VM.
+//
+// Only x86-64 Linux is supported; elsewhere compile() leaves every chunk
+// untouched. The machine code lives as long as the Jit.
+class Jit {
+ public:
+  Jit();
+  ~Jit();
+  Jit(const Jit&) = delete;
+  Jit& operator=(const Jit&) = delete;
+
+  // Returns the number of loops that were compiled.
+  std::size_t compile(Chunk& chunk);
+  static bool isAvailable();
+
+ private:
+  struct Mapping {
+    void* address;
+    std::size_t size;
+  };
+  std::vector<Mapping> mappings;
+
+  bool compileLoop(Chunk& chunk, std::size_t start, std::size_t end);
+  NativeFunction install(const std::vector<std::uint8_t>& code);
+};
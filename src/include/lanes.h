@@ -0,0 +1,80 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// The values one expression takes in LANES instances of a program run in
+// lockstep, and SIMD operations on them with the semantics of arithmetic.h.
+// They use AVX2 where the compiler targets it (make SIMD=avx2), SSE2 on
+// other x86-64 builds, and plain loops elsewhere or with make SIMD=scalar.
+//
+// A Mask selects lanes by holding -1 in them, and 0 in the others.
+#if defined(__AVX2__) && !defined(LANES_SCALAR)
+#define LANES_AVX2
+#elif defined(__SSE2__) && !defined(LANES_SCALAR)
+#define LANES_SSE2
+#endif
+
+constexpr std::size_t LANES = 8;
+
+template <typename T>
+struct Lanes {
+  alignas(32) T v[LANES];
+};
+
+using Mask = Lanes<std::int32_t>;
+
+namespace lanes {
+
+const char* getInstructionSet();
+
+template <typename T>
+Lanes<T> broadcast(T value) {
+  Lanes<T> result;
+  for (std::size_t lane = 0; lane < LANES; lane++) {
+    result.v[lane] = value;
+  }
+  return result;
+}
+
+Lanes<std::int32_t> add(const Lanes<std::int32_t>& left,
+                        const Lanes<std::int32_t>& right);
+Lanes<std::int32_t> subtract(const Lanes<std::int32_t>& left,
+                             const Lanes<std::int32_t>& right);
+Lanes<std::int32_t> multiply(const Lanes<std::int32_t>& left,
+                             const Lanes<std::int32_t>& right);
+Lanes<std::int32_t> negate(const Lanes<std::int32_t>& value);
+Lanes<double> add(const Lanes<double>& left, const Lanes<double>& right);
+Lanes<double> subtract(const Lanes<double>& left, const Lanes<double>& right);
+Lanes<double> multiply(const Lanes<double>& left, const Lanes<double>& right);
+// Lanes divided by zero hold infinities or NaN, for the caller to mask off.
+Lanes<double> divide(const Lanes<double>& left, const Lanes<double>& right);
+Lanes<double> negate(const Lanes<double>& value);
+
+Mask less(const Lanes<std::int32_t>& left, const Lanes<std::int32_t>& right);
+Mask greater(const Lanes<std::int32_t>& left,
+             const Lanes<std::int32_t>& right);
+Mask equal(const Lanes<std::int32_t>& left, const Lanes<std::int32_t>& right);
+Mask notEqual(const Lanes<std::int32_t>& left,
+              const Lanes<std::int32_t>& right);
+Mask less(const Lanes<double>& left, const Lanes<double>& right);
+Mask greater(const Lanes<double>& left, const Lanes<double>& right);
+Mask equal(const Lanes<double>& left, const Lanes<double>& right);
+Mask notEqual(const Lanes<double>& left, const Lanes<double>& right);
+
+Lanes<double> toFloat(const Lanes<std::int32_t>& value);
+Lanes<std::int32_t> toInt(const Lanes<double>& value);
+
+// The lanes of whenTrue that mask selects, and those of whenFalse elsewhere.
+Lanes<std::int32_t> select(const Mask& mask,
+                           const Lanes<std::int32_t>& whenTrue,
+                           const Lanes<std::int32_t>& whenFalse);
+Lanes<double> select(const Mask& mask,
+                     const Lanes<double>& whenTrue,
+                     const Lanes<double>& whenFalse);
+
+Mask both(const Mask& left, const Mask& right);
+// The lanes of left that right does not select.
+Mask without(const Mask& left, const Mask& right);
+bool any(const Mask& mask);
+
+}  // namespace lanes
@@ -1,39 +1,49 @@
 #ifndef LEXER_H
 #define LEXER_H
 
+#include <memory>
 #include <string>
 #include <vector>
 #include "error.h"
+#include "interner.h"
 #include "position.h"
+#include "source.h"
 #include "token.h"
 
+// Produces tokens one at a time as the parser asks for them, so the whole
+// token stream never has to exist at once.
 class Lexer {
  public:
-  Lexer(std::string& inputText);
-  
-  const std::string& getInputText() const;
+  Lexer(std::shared_ptr<const Source> source);
+
+  const Source& getSource() const;
+  const Interner& getInterner() const;
   const Position& getPosition() const;
   char getCurrentChar() const;
   Token getNextToken();
-  Token peekNextToken(std::size_t offset = 1);
 
-  std::vector<Token> getAllTokens() const;
+  // Lexes the whole source into a TokenBuffer for debug output, then rewinds.
+  const TokenBuffer& getAllTokens() const;
   void tokenize();
 
  private:
-  std::string inputText;
+  std::shared_ptr<const Source> source;
   Position position;
   char currentChar;
   char nextChar;
+  bool atLineStart;
+  bool lastTokenWasNewline;
 
-  std::vector<Token> tokens;
-  std::size_t currentTokenIndex;
-  std::size_t nextTokenIndex;
+  Interner interner;
+  TokenBuffer tokens;
 
   void advance();
+  void reset();
+  Token makeToken(TokenType type,
+                  const Position& posStart,
+                  std::uint32_t id = 0);
 
-  void skipWhitespace();
-
+  Token scanIndent();
   Token scanString(Position posStart);
   Token scanNumber(Position posStart);
   Token scanIdentifier(Position posStart);
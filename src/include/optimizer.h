@@ -0,0 +1,77 @@
+#pragma once
+#include <cstdint>
+#include <map>
+#include <utility>
+#include <vector>
+#include "AST.h"
+
+// Runs after the ConstantFolder and rewrites while loops, innermost first:
+//
+// - An expression that only reads variables the loop never assigns is
+//   computed once, into a fresh variable, right before the loop. Only
+//   expressions that cannot fail are moved, since the loop might not run at
+//   all; a division qualifies when it divides by a nonzero literal.
+// - An int variable whose only assignment in the loop is `i = i + c` (or
+//   `- c`) at the top level of its body is an induction variable. A product
+//   `i * k` with a literal k is then kept in a fresh variable as well, which
+//   is initialized before the loop and advanced by c * k right after i is.
+//   Int arithmetic wraps, so this gives exactly the same values.
+// - A loop whose body only holds int updates `x = x + e` (or `- e`) with
+//   invariant e, one of them the induction variable tested by its condition
+//   against an invariant bound, is a counting loop. Its trip count is
+//   computed by a TripCount node, and every variable is advanced by that
+//   many steps at once. When the count cannot be computed, because the
+//   induction variable would wrap around first, the loop runs as before.
+//
+// The loop becomes a StatementList holding the new assignments followed by
+// the loop itself, or by the if choosing between its closed form and it.
+class LoopOptimizer {
+ public:
+  LoopOptimizer(AST& ast);
+  void optimize();
+
+ private:
+  struct Induction {
+    std::int32_t step;
+    NodeId update;
+  };
+
+  AST& ast;
+  // Per slot, the number of statements of the current loop storing to it.
+  std::vector<std::uint32_t> assignments;
+  std::map<std::uint32_t, Induction> inductions;
+  // Variables holding induction products, by induction slot and factor.
+  std::map<std::pair<std::uint32_t, std::int32_t>, std::uint32_t> products;
+  std::vector<NodeId> preheader;
+  std::vector<std::pair<NodeId, NodeId>> productUpdates;
+
+  void optimizeStatement(NodeId node);
+  void optimizeStatementList(NodeId node);
+  void optimizeLoop(NodeId node);
+  void countAssignments(NodeId node);
+  void findInductions(NodeId body);
+  void solveLoop(NodeId node);
+  void rewriteStatement(NodeId node);
+  void rewriteStatementList(NodeId node);
+  void rewriteCondition(NodeId node);
+  void rewriteRoot(NodeId node);
+  bool rewriteExpression(NodeId node);
+  bool reduceProduct(NodeId node);
+  bool canFail(NodeId node, std::uint32_t operatorIndex) const;
+  bool isInvariant(NodeId node, bool safe) const;
+  void hoist(NodeId node);
+
+  std::uint32_t addVariable(DataType type);
+  NodeId makeIdentifier(std::uint32_t slot, std::uint32_t position);
+  NodeId makeConstant(std::int32_t value, std::uint32_t position);
+  NodeId makeBinary(NodeType type,
+                    NodeId left,
+                    Operator op,
+                    NodeId right,
+                    std::uint32_t position);
+  NodeId makeAssignment(std::uint32_t slot, NodeId expression);
+  NodeId makeComparison(NodeId left,
+                        Comparator comparator,
+                        NodeId right,
+                        std::uint32_t position);
+};
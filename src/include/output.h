@@ -0,0 +1,65 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+
+// When buffered output reaches the file: only when the Output is flushed or
+// destroyed, whenever the buffer fills up, or after every line.
+enum class FlushPolicy { Exit, Size, Line };
+
+// Where print statements write to. Lines are formatted with std::to_chars
+// into a buffer in memory, which goes out in one write system call when the
+// flush policy says so. With a background writer, that call is made by a
+// thread of its own while the program fills a second buffer.
+//
+// Anything written to std::cout before the Output is created comes out
+// first. An Output flushes when it is destroyed, also while an exception
+// unwinds, so what a program printed appears before its runtime error.
+class Output {
+ public:
+  static constexpr std::size_t CAPACITY = 64 * 1024;
+
+  // Writes to the file descriptor fd.
+  Output(int fd, FlushPolicy policy, bool background = false);
+  // Hands the buffered text to sink instead, in pieces of whole lines.
+  Output(std::function<void(std::string_view text)> sink, FlushPolicy policy);
+  // Appends everything to text, which must outlive the Output.
+  Output(std::string& text);
+  ~Output();
+  Output(const Output&) = delete;
+  Output& operator=(const Output&) = delete;
+
+  // Each prints a line: "> ", then the value.
+  void printInt(std::int32_t value);
+  void printFloat(double value);
+  void printString(std::string_view text);
+  void flush();
+
+ private:
+  int fd;
+  std::function<void(std::string_view text)> sink;
+  FlushPolicy policy;
+  // The buffer when writing to a file, or the text.
+  std::string* target;
+  std::string buffer;
+
+  bool background;
+  std::thread writer;
+  std::mutex mutex;
+  std::condition_variable changed;
+  // The buffer being written by the writer thread, if writing is set.
+  std::string pending;
+  bool writing;
+  bool stopping;
+
+  void endLine();
+  void send();
+  void waitForWriter();
+  void runWriter();
+  void writeAll(const std::string& bytes) const;
+};
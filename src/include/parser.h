@@ -1,6 +1,7 @@
 #pragma once
+#include <array>
 #include <iostream>
-#include <stack>
+#include <memory>
 #include <vector>
 #include "AST.h"
 #include "lexer.h"
@@ -8,32 +9,54 @@
 class Parser {
  public:
   Parser(Lexer& lexer);
-  std::shared_ptr<ASTNode> parse();
-  std::shared_ptr<ASTNode> getAST();
+  std::unique_ptr<AST> parse();
 
  private:
-  Lexer lexer;
+  // Tokens are pulled from the lexer on demand; only the current token and a
+  // few tokens of lookahead are ever held.
+  static constexpr std::size_t LOOKAHEAD = 4;
+
+  Lexer& lexer;
   Token currentToken;
-  Token nextToken;
+  std::array<Token, LOOKAHEAD> lookahead;
+  std::size_t lookaheadStart;
+  std::size_t lookaheadCount;
 
-  std::shared_ptr<ASTNode> parseStatement(int indentLevel = 0);
-  std::shared_ptr<ASTNode> parseExpression();
-  std::shared_ptr<ASTNode> parseTerm();
-  std::shared_ptr<ASTNode> parseFactor();
-  std::shared_ptr<ASTNode> parsePrintStatement();
-  std::shared_ptr<ASTNode> parseVarDeclaration();
-  std::shared_ptr<ASTNode> parseAssignment();
-  std::shared_ptr<ASTNode> parseDataType();
-  std::shared_ptr<ASTNode> parseIdentifier();
-  std::shared_ptr<ASTNode> parseIfStatement(int indentLevel);
-  std::shared_ptr<ASTNode> parseWhileStatement(int indentLevel);
-  std::shared_ptr<ASTNode> parseComparison();
-  std::shared_ptr<ASTNode> parseElifStatement(int indentLevel);
-  std::shared_ptr<ASTNode> parseElseStatement(int indentLevel);
-  std::shared_ptr<ASTNode> parseComparator();
-  std::shared_ptr<ASTNode> parseIndentedStatementList(int indentLevel);
+  NodeId parseStatement(int indentLevel = 0);
+  NodeId parseExpression();
+  NodeId parseTerm();
+  NodeId parseFactor();
+  NodeId parseLiteral();
+  NodeId parseOperator();
+  NodeId parsePrintStatement();
+  NodeId parseVarDeclaration();
+  NodeId parseAssignment();
+  NodeId parseDataType();
+  NodeId parseIdentifier();
+  NodeId parseIfStatement(int indentLevel);
+  NodeId parseWhileStatement(int indentLevel);
+  NodeId parseComparison();
+  NodeId parseElifStatement(int indentLevel);
+  NodeId parseElseStatement(int indentLevel);
+  NodeId parseComparator();
+  NodeId parseIndentedStatementList(int indentLevel);
   void advance();
   void eat(TokenType type);
+  Token peekToken(std::size_t offset);
+  bool nextLineStartsWith(int indentLevel, Keyword keyword);
+  void skipToNextLine(int indentLevel);
+
+  std::size_t openNode() const;
+  NodeId closeNode(NodeType type,
+                   std::size_t mark,
+                   std::uint8_t op = 0,
+                   std::uint32_t value = 0);
+  NodeId addLeaf(NodeType type,
+                 std::uint32_t position,
+                 std::uint8_t op = 0,
+                 std::uint32_t value = 0);
+  std::uint32_t tokenPosition() const;
 
-  std::shared_ptr<ASTNode> root;
+  std::unique_ptr<AST> ast;
+  std::vector<NodeId> pendingChildren;
 };
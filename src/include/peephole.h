@@ -0,0 +1,26 @@
+#pragma once
+#include <cstddef>
+#include "bytecode.h"
+
+// Replaces the most common instruction sequences of a chunk with
+// superinstructions that do their work in a single dispatch:
+//
+// - `Load a, Load b, <int comparison>, JumpIfFalse`, a condition `a < b`;
+// - `Load a, Constant k, <int comparison>, JumpIfFalse`, a condition `a < k`;
+// - `Load a, Constant k, Add or Subtract, Store b`, an update `b = a + k`.
+//
+// Only the first instruction of a sequence is replaced, so jump targets,
+// source positions and native loops keep pointing where they did. A
+// sequence that a jump enters halfway is left alone. The Jit only knows
+// the plain instructions, so this runs after it.
+class Peephole {
+ public:
+  Peephole(Chunk& chunk);
+  // Returns the number of superinstructions selected.
+  std::size_t optimize();
+
+ private:
+  Chunk& chunk;
+
+  OpCode select(std::size_t at) const;
+};
@@ -0,0 +1,36 @@
+#pragma once
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Runs a fixed number of independent tasks on a set of threads. Tasks are
+// dealt out round-robin up front; each worker takes its own tasks from the
+// front of its queue, lowest index first, and once that is empty steals from
+// the back of another worker's queue. Tasks that run long therefore do not
+// hold up the ones queued behind them, and low indices tend to finish first.
+class WorkStealingPool {
+ public:
+  // Zero picks the number of hardware threads.
+  WorkStealingPool(unsigned threads = 0);
+
+  unsigned size() const;
+  // Calls task(i) for every i below count and returns once all have run.
+  // Tasks must not throw.
+  void run(std::size_t count, const std::function<void(std::size_t)>& task);
+
+ private:
+  struct Queue {
+    std::mutex mutex;
+    std::deque<std::size_t> tasks;
+  };
+
+  unsigned threads;
+  std::vector<std::unique_ptr<Queue>> queues;
+
+  void work(unsigned worker, const std::function<void(std::size_t)>& task);
+  bool take(unsigned worker, std::size_t& index);
+  bool steal(unsigned worker, std::size_t& index);
+};
@@ -2,27 +2,24 @@
 #ifndef POSITION_H
 #define POSITION_H
 
-#include <string>
+#include "source.h"
 
+// A byte offset into a Source. Line and column are looked up from the source
+// only when asked for, so a Position is cheap to copy.
 class Position {
  public:
-  Position(int index = 0,
-           int line = 0,
-           int column = 0,
-           std::string inputText = "");
-  Position advance(char currentChar);
+  Position(int index = 0, const Source* source = nullptr);
+  Position advance();
   Position copy();
 
   int getIndex() const;
   int getLine() const;
   int getCol() const;
-  const std::string& getInputText() const;
+  const Source* getSource() const;
 
  private:
   int index;
-  int line;
-  int column;
-  std::string inputText;
+  const Source* source;
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,121 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+#include "AST.h"
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define PROFILE_HAS_TSC
+#endif
+
+// What the Interpreter recorded about each statement of a program while it
+// ran with profiling on, and the report made of it per source line.
+//
+// Counts are exact, but reading the time twice around every statement would
+// cost more than most statements do, so a statement is only timed on its
+// first executions and then on one in eight of them, picked at random; its
+// time is extrapolated from those. Times are taken with the time stamp
+// counter where there is one, which costs far less to read than a clock,
+// and converted to nanoseconds against the steady clock over the whole run.
+class Profile {
+ public:
+  // Per statement, and per elif or else clause, by NodeId.
+  struct Counter {
+    // Executions of a statement, or evaluations of an elif's condition.
+    std::uint64_t count = 0;
+    // Time spent in the statement over the executions that were timed.
+    std::uint64_t ticks = 0;
+    std::uint64_t timed = 0;
+    // Iterations of a while loop, or how often a branch of an if was taken.
+    std::uint64_t taken = 0;
+  };
+
+  Profile(const AST& ast);
+
+  static std::uint64_t now() {
+#ifdef PROFILE_HAS_TSC
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+#endif
+  }
+
+  Counter& operator[](NodeId node) { return counters[node]; }
+
+  // Whether to time the execution of a statement that has just been counted.
+  bool sample(const Counter& counter) {
+    random ^= random << 13;
+    random ^= random >> 7;
+    random ^= random << 17;
+    return counter.count <= 16 || (random & 7) == 0;
+  }
+
+  void finish();
+  // Lines sorted by the time spent in them, the hottest first.
+  void report(std::ostream& out) const;
+  void writeJson(std::ostream& out) const;
+
+ private:
+  struct Line {
+    int line = 0;
+    // The statement or clause starting the line.
+    NodeType type = NodeType::StatementList;
+    std::uint64_t count = 0;
+    std::uint64_t taken = 0;
+    // Estimated time in the line's statements, and in them but not in the
+    // statements nested in them.
+    double ticks = 0;
+    double selfTicks = 0;
+  };
+
+  const AST& ast;
+  std::vector<Counter> counters;
+  std::uint64_t random;
+  std::uint64_t startTicks;
+  std::uint64_t endTicks;
+  std::chrono::steady_clock::time_point start;
+  std::chrono::steady_clock::time_point end;
+
+  double estimatedTicks(NodeId node) const;
+  double nestedTicks(NodeId node) const;
+  std::vector<Line> collectLines() const;
+  double toNanoseconds(double ticks) const;
+};
+
+// Times a statement from its construction to its destruction into the
+// statement's Counter. Disabled, it does nothing at all.
+template <bool ENABLED>
+class StatementTimer {
+ public:
+  StatementTimer(Profile*, NodeId) {}
+};
+
+template <>
+class StatementTimer<true> {
+ public:
+  StatementTimer(Profile* profile, NodeId node) : counter((*profile)[node]) {
+    counter.count++;
+    timing = profile->sample(counter);
+    if (timing) {
+      start = Profile::now();
+    }
+  }
+
+  ~StatementTimer() {
+    if (timing) {
+      counter.ticks += Profile::now() - start;
+      counter.timed++;
+    }
+  }
+
+  StatementTimer(const StatementTimer&) = delete;
+  StatementTimer& operator=(const StatementTimer&) = delete;
+
+ private:
+  Profile::Counter& counter;
+  bool timing;
+  std::uint64_t start = 0;
+};
@@ -0,0 +1,47 @@
+#pragma once
+#include <istream>
+#include <string>
+#include <vector>
+#include "output.h"
+#include "resolver.h"
+#include "value.h"
+
+struct ReplOptions {
+  bool optimizeLoops = true;
+  bool superinstructions = true;
+  bool jit = false;
+};
+
+// An interactive session that keeps its variables from one input to the
+// next. Every input, a statement or a block, is lexed, parsed and compiled
+// on its own, against the variables the earlier ones declared, and then run
+// on the VM straight away; nothing that came before is looked at again.
+//
+// The SSA optimizer is not used, since it would drop stores that only later
+// inputs read.
+class Repl {
+ public:
+  Repl(const ReplOptions& options, Output& out);
+
+  // Compiles and runs one input, which must end with a newline. Errors in
+  // it are thrown; the variables it declared are kept once it compiles,
+  // even when it then stops on a runtime error.
+  void execute(const std::string& text);
+  // Runs the inputs read from in until it ends, reporting errors on stderr.
+  // With prompt set, asks for each line on stdout; without, in is read as a
+  // script would be, with empty lines allowed inside blocks. Returns false
+  // if any input failed.
+  bool run(std::istream& in, bool prompt);
+
+ private:
+  ReplOptions options;
+  Output& out;
+  // The variables declared so far, in the first slots of variables.
+  Globals globals;
+  std::vector<Value> variables;
+  // The line that ended the last block read without a prompt, which starts
+  // the next input.
+  std::string pending;
+
+  bool read(std::istream& in, std::string& text, bool prompt);
+};
@@ -0,0 +1,56 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "AST.h"
+#include "error.h"
+
+// The variables that exist before the program starts, declared by earlier
+// inputs of a REPL session. They take the first slots.
+struct Globals {
+  std::unordered_map<std::string, std::uint32_t> slots;
+  std::vector<DataType> types;
+  // Whether each is assigned on every path through the earlier inputs.
+  std::vector<bool> assigned;
+};
+
+// Runs between Parser::parse and Interpreter::interpret. Every Identifier is
+// bound to a numeric variable slot, so the interpreter reads and writes a
+// flat array instead of looking names up.
+//
+// Using an undeclared variable, or one that is not assigned on every path
+// leading to the use, is reported here as a SemanticError.
+//
+// Given globals, which must outlive the Resolver, the program can use them
+// as if it had declared them itself.
+class Resolver {
+ public:
+  Resolver(AST& ast);
+  Resolver(AST& ast, const Globals& globals);
+  void resolve();
+  // Whether each slot is assigned on every path through the program, once it
+  // has been resolved.
+  const std::vector<bool>& getAssigned() const;
+
+ private:
+  static constexpr std::uint32_t NO_SLOT = UINT32_MAX;
+
+  AST& ast;
+  const Globals* globals;
+  std::vector<std::uint32_t> slotOfName;
+  // Whether each slot is assigned on every path reaching the current node.
+  std::vector<bool> assigned;
+
+  void declareGlobals();
+  void resolveStatement(NodeId node);
+  void resolveStatementList(NodeId node);
+  void resolveIfStatement(NodeId node);
+  void resolveWhileStatement(NodeId node);
+  void resolveExpression(NodeId node);
+  std::uint32_t bindDeclaration(NodeId identifier);
+  std::uint32_t bindUse(NodeId identifier, bool isRead);
+  void restoreAssigned(const std::vector<bool>& state);
+  void mergeAssigned(std::vector<bool>& merged) const;
+  [[noreturn]] void fail(NodeId node, const std::string& details) const;
+};
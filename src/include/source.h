@@ -0,0 +1,81 @@
+#ifndef SOURCE_H
+#define SOURCE_H
+
+#include <cstddef>
+#include <istream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Immutable text of one script. Positions, tokens and errors refer into it by
+// byte offset instead of keeping their own copies of the input.
+//
+// A regular file is memory-mapped and scanned in place; anything else is
+// read whole before the Source is made. The text never changes afterwards,
+// so views into it stay valid for as long as the Source lives.
+//
+// A Source can only be made by its factories, so it is always owned by a
+// shared_ptr and whatever holds a Position into it, such as an Error, can
+// keep it alive with shared_from_this().
+class Source : public std::enable_shared_from_this<Source> {
+  // Only Source can make one, which keeps the constructors to the factories
+  // while still letting make_shared call them.
+  struct Private {
+    explicit Private() = default;
+  };
+
+ public:
+  Source(Private, std::string text, std::string name);
+  Source(Private,
+         const char* mapping,
+         std::size_t mappingSize,
+         std::string name);
+  ~Source();
+  Source(const Source&) = delete;
+  Source& operator=(const Source&) = delete;
+
+  static std::shared_ptr<const Source> fromString(
+      std::string text,
+      const std::string& name = "<input>");
+  // Reads the stream to its end.
+  static std::shared_ptr<const Source> fromStream(std::istream& stream,
+                                                  const std::string& name);
+  // Returns nullptr when the file cannot be opened.
+  static std::shared_ptr<const Source> fromFile(const std::string& path);
+
+  const std::string& getName() const;
+  std::string_view getText() const;
+  std::string_view getText(int start, int end) const;
+  std::size_t size() const;
+
+  char at(int index) const {
+    if (index >= 0 && static_cast<std::size_t>(index) < length) {
+      return data[index];
+    }
+    return '\0';
+  }
+
+  // Line and column are derived on demand from a line-start index that is
+  // built the first time one of them is asked for.
+  int lineOf(int index) const;
+  int columnOf(int index) const;
+  std::string_view lineText(int line) const;
+
+ private:
+  // data and length describe the text, either inside text or inside the
+  // file mapping.
+  const std::string text;
+  const char* const data;
+  const std::size_t length;
+  const char* const mapping;
+  std::string name;
+
+  mutable std::once_flag lineIndexFlag;
+  mutable std::vector<int> lineStarts;
+
+  const std::vector<int>& getLineStarts() const;
+};
+
+#endif
@@ -0,0 +1,94 @@
+#pragma once
+#include <cstdint>
+#include <map>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "AST.h"
+#include "ir.h"
+
+// Builds the SSA form of a typed, resolved program and uses it to clean up
+// the AST before the LoopOptimizer and the engines see it:
+//
+// - Expressions are value numbered, with phis where if branches merge and at
+//   loop headers. An expression whose value is a constant becomes a literal;
+//   one whose value some variable already holds, on every path to it, reads
+//   that variable instead. This covers common subexpressions, copies and
+//   propagated constants alike.
+// - A store whose value is never read afterwards is removed, unless
+//   computing that value can fail. A declaration keeps the variable but
+//   loses its initializer.
+class SSAOptimizer {
+ public:
+  SSAOptimizer(AST& ast);
+  // Builds the IR of the program without changing it.
+  const IRProgram& build();
+  // Optimizes the program and returns its final IR, in which the removed
+  // stores are marked.
+  const IRProgram& optimize();
+
+ private:
+  using DefId = std::uint32_t;
+
+  // A definition of a variable: a store, or the merge of the definitions
+  // reaching an if's end or a loop header. A definition is live if a print,
+  // a condition or a live definition may read it.
+  struct Definition {
+    NodeId statement;
+    std::uint32_t block;
+    std::uint32_t index;
+    std::vector<DefId> uses;
+    bool mayFail;
+  };
+
+  AST& ast;
+  IRProgram ir;
+  bool rewriting;
+  std::uint32_t block;
+  // Per slot, its current value and definition.
+  std::vector<ValueId> values;
+  std::vector<DefId> current;
+  std::vector<Definition> definitions;
+  std::vector<DefId> roots;
+  std::vector<DefId>* reads;
+  bool mayFail;
+
+  std::map<std::pair<DataType, std::uint64_t>, ValueId> constants;
+  std::vector<ValueId> undefined;
+  // Numbered operations, keyed by op, type and operands. Entries made in a
+  // block are dropped once the blocks it dominates have been visited.
+  std::map<std::vector<std::uint32_t>, ValueId> numbering;
+  std::vector<std::vector<std::uint32_t>> scope;
+  // Per value, the variables it was stored to.
+  std::unordered_map<ValueId, std::vector<std::uint32_t>> holders;
+
+  void run(bool rewrite);
+  void removeDeadStores();
+
+  void visitStatement(NodeId node);
+  void visitStatementList(NodeId node);
+  void visitIfStatement(NodeId node);
+  void visitWhileStatement(NodeId node);
+  void visitStore(NodeId statement, NodeId identifier, NodeId expression);
+  ValueId visitCondition(NodeId node);
+  ValueId visitExpression(NodeId node);
+  bool rewrite(NodeId node, ValueId value);
+  void collectAssigned(NodeId node, std::vector<bool>& assigned) const;
+
+  ValueId constant(DataType type, std::uint64_t bits);
+  ValueId operation(IROp op, DataType type, std::vector<ValueId> operands);
+  bool fold(IROp op,
+            DataType type,
+            const std::vector<ValueId>& operands,
+            ValueId& result);
+  ValueId addValue(IROp op,
+                   DataType type,
+                   std::uint32_t slot,
+                   std::vector<ValueId> operands);
+  DefId addMerge(std::vector<DefId> uses);
+  void popScope(std::size_t mark);
+
+  std::uint32_t addBlock();
+  std::size_t emit(IRKind kind, ValueId value, std::uint32_t operand = 0);
+  void jump(std::uint32_t target);
+};
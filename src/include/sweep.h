@@ -0,0 +1,89 @@
+#pragma once
+#include <cstdint>
+#include <istream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "AST.h"
+#include "lanes.h"
+#include "value.h"
+
+// Initial values for the instances of a parameter sweep, read from CSV: a
+// header row naming top-level variables, then one row per instance. A value
+// replaces the initializer of its variable's top-level `var` declaration.
+struct SweepInputs {
+  std::vector<std::uint32_t> slots;
+  std::vector<std::vector<Value>> rows;
+
+  // Returns false, with a message in error, when a column does not name a
+  // top-level variable or a value does not fit its type.
+  static bool read(std::istream& csv,
+                   const AST& ast,
+                   SweepInputs& inputs,
+                   std::string& error);
+};
+
+// Walks a resolved and type-checked AST for LANES instances at once, one
+// per row of the inputs, with every expression evaluated for all of them by
+// the operations of lanes.h. Instances that take different sides of an if,
+// or leave a while loop at different times, are masked off while the others
+// go on; a division by zero stops only the instances it happens in.
+//
+// The AST must not contain TripCount nodes. The SSA and loop optimizers are
+// not run first either, as they assume the initializers the inputs replace.
+class LaneInterpreter {
+ public:
+  LaneInterpreter(const AST& ast, const SweepInputs& inputs);
+  // Runs the instances for rows first to first + LANES - 1, or to the last.
+  void run(std::size_t first);
+  // What the instance in lane printed, and its error, if it stopped on one.
+  std::string getOutput(std::size_t lane) const;
+  const std::string& getError(std::size_t lane) const;
+
+ private:
+  const AST& ast;
+  const SweepInputs& inputs;
+  // The input column of each slot, or -1.
+  std::vector<int> columns;
+  std::size_t first;
+  std::vector<Lanes<std::int32_t>> ints;
+  std::vector<Lanes<double>> floats;
+  // The instances the current statement runs for, before those stopped by
+  // an error are taken out.
+  Mask active;
+  Mask failed;
+  std::ostringstream outputs[LANES];
+  std::string errors[LANES];
+
+  Mask live() const;
+  void fail(std::size_t lane, NodeId node);
+  void executeStatement(NodeId node);
+  void executeStatementList(NodeId node);
+  void executeInput(NodeId node);
+  void executeIfStatement(NodeId node);
+  void executeWhileStatement(NodeId node);
+  void store(NodeId identifier, NodeId expression);
+  void visitPrintStatement(NodeId node);
+  Mask evaluateCondition(NodeId node);
+  template <typename T>
+  Mask compare(NodeId node);
+  template <typename T>
+  Lanes<T>& variable(std::uint32_t slot);
+  template <typename T>
+  Lanes<T> visit(NodeId node);
+  template <typename T>
+  Lanes<T> visitExpression(NodeId node);
+  template <typename T>
+  Lanes<T> visitTerm(NodeId node);
+  // Lanes that divide by zero fail, if live, and hold 0.
+  Lanes<std::int32_t> divide(const Lanes<std::int32_t>& left,
+                             const Lanes<std::int32_t>& right,
+                             NodeId node);
+  Lanes<double> divide(const Lanes<double>& left,
+                       const Lanes<double>& right,
+                       NodeId node);
+  template <typename T>
+  Lanes<T> visitLiteral(NodeId node);
+  template <typename T>
+  Lanes<T> visitConvert(NodeId node);
+};
@@ -1,12 +1,13 @@
 #ifndef TOKENS_H
 #define TOKENS_H
 
-#include <map>
+#include <cstdint>
 #include <string>
-#include <unordered_map>
+#include <string_view>
+#include <vector>
 #include "position.h"
 
-enum TokenType {
+enum TokenType : std::uint8_t {
   TOKEN_KEYWORD,
   TOKEN_OPERATOR,
   TOKEN_COMPARATOR,
@@ -22,27 +23,61 @@ enum TokenType {
   TOKEN_EOF
 };
 
+// A single token as handed out to the parser. It is a small value built on
+// demand from a TokenBuffer; its text is read from the source buffer.
+//
+// The id is the interned name for keywords and identifiers, and the
+// character itself for operators, comparators, parentheses and colons.
 struct Token {
  public:
-  Token() : type(TOKEN_INVALID), value("") {}
+  Token() : type(TOKEN_INVALID), id(0) {}
   Token(TokenType type,
-        const std::string& value = "",
-        const Position& posStart = Position(0, 0, 0, ""),
-        const Position& posEnd = Position(0, 0, 0, ""));
+        const Position& posStart = Position(),
+        const Position& posEnd = Position(),
+        std::uint32_t id = 0);
 
   std::string asString() const;
   TokenType getType() const;
-  const std::string& getValue() const;
+  std::uint32_t getId() const;
+  // The token text, read from the source buffer between posStart and posEnd.
+  std::string_view getValue() const;
   const Position& getPosStart() const;
   const Position& getPosEnd() const;
 
+  static const char* getTypeName(TokenType type);
+
  private:
   TokenType type;
-  std::string value;
-  std::string tokenName;
+  std::uint32_t id;
   Position posStart;
   Position posEnd;
+};
+
+// All tokens of one source, stored column-wise: one byte of kind plus source
+// offset, length and id per token.
+class TokenBuffer {
+ public:
+  TokenBuffer(const Source* source = nullptr);
 
-  static std::map<TokenType, std::string> tokenNames;
+  void push(TokenType type,
+            std::uint32_t offset,
+            std::uint32_t length,
+            std::uint32_t id = 0);
+  void clear();
+  void reserve(std::size_t count);
+
+  std::size_t size() const;
+  TokenType getType(std::size_t i) const;
+  std::uint32_t getOffset(std::size_t i) const;
+  std::uint32_t getLength(std::size_t i) const;
+  std::uint32_t getId(std::size_t i) const;
+  Token get(std::size_t i) const;
+
+ private:
+  const Source* source;
+  std::vector<TokenType> types;
+  std::vector<std::uint32_t> offsets;
+  std::vector<std::uint32_t> lengths;
+  std::vector<std::uint32_t> ids;
 };
-#endif
\ No newline at end of file
+#endif
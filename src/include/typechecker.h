@@ -0,0 +1,30 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "AST.h"
+#include "error.h"
+
+// Runs after the Resolver. Every variable takes the type it was declared
+// with, and every expression gets a static type: int when all of its
+// operands are int, float otherwise. Where an int meets a float, or a value
+// is stored into a variable of the other type, a Convert node is inserted,
+// so the engines never look at types while running.
+//
+// Declaring the same variable again with another type, a global of the
+// Resolver included, is a SemanticError.
+class TypeChecker {
+ public:
+  TypeChecker(AST& ast);
+  void check();
+
+ private:
+  AST& ast;
+  std::vector<bool> declared;
+
+  void checkStatement(NodeId node);
+  void checkStatementList(NodeId node);
+  void checkCondition(NodeId node);
+  DataType checkExpression(NodeId node);
+  void convert(NodeId node, DataType type);
+  [[noreturn]] void fail(NodeId node, const std::string& details) const;
+};
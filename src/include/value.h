@@ -0,0 +1,34 @@
+#pragma once
+#include <cstdint>
+
+// A variable slot or operand stack entry. Which member is live is known
+// statically from the program's types, so values carry no tag.
+union Value {
+  std::int32_t i;
+  double f;
+
+  template <typename T>
+  T get() const;
+  template <typename T>
+  void set(T value);
+};
+
+template <>
+inline std::int32_t Value::get<std::int32_t>() const {
+  return i;
+}
+
+template <>
+inline double Value::get<double>() const {
+  return f;
+}
+
+template <>
+inline void Value::set<std::int32_t>(std::int32_t value) {
+  i = value;
+}
+
+template <>
+inline void Value::set<double>(double value) {
+  f = value;
+}
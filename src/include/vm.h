@@ -0,0 +1,45 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "bytecode.h"
+#include "error.h"
+#include "output.h"
+#include "value.h"
+
+// Executes a Chunk on an operand stack, with variables in a flat array
+// indexed by slot. Stack entries and variables are untagged Values; the
+// typed instructions know which member to use.
+//
+// Where the compiler supports computed goto (GCC and Clang) the dispatch loop
+// is direct-threaded; building with VM_SWITCH_DISPATCH defined (make
+// DISPATCH=switch) selects the portable switch loop instead.
+#if defined(__GNUC__) && !defined(VM_SWITCH_DISPATCH)
+#define VM_THREADED_DISPATCH
+#endif
+
+class VM {
+ public:
+  VM(Output& out);
+  int interpret(const Chunk& chunk);
+  // Runs the chunk on the given variables. A chunk must not change once a
+  // VM has run it, as the VM keeps the code it prepared for the last one,
+  // under the chunk's id.
+  void run(const Chunk& chunk, Value* variables);
+  static const char* getDispatchName();
+
+ private:
+  Output& out;
+  std::vector<Value> variables;
+  std::vector<Value> stack;
+
+  struct ThreadedInstruction {
+    const void* handler;
+    std::int32_t operand;
+  };
+  std::vector<ThreadedInstruction> threaded;
+  std::uint64_t threadedId;
+
+  [[noreturn]] void fail(const Chunk& chunk,
+                         std::size_t pc,
+                         const std::string& details) const;
+};
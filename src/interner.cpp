@@ -0,0 +1,27 @@
+#include "interner.h"
+
+Interner::Interner() {
+  for (const char* keyword : {"if", "elif", "else", "while", "var", "int",
+                              "float", "print", "run"}) {
+    intern(keyword);
+  }
+}
+
+std::uint32_t Interner::intern(std::string_view name) {
+  auto it = ids.find(name);
+  if (it != ids.end()) {
+    return it->second;
+  }
+  std::uint32_t id = static_cast<std::uint32_t>(names.size());
+  names.emplace_back(name);
+  ids.emplace(names.back(), id);
+  return id;
+}
+
+const std::string& Interner::getName(std::uint32_t id) const {
+  return names[id];
+}
+
+std::size_t Interner::size() const {
+  return names.size();
+}
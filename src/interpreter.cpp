@@ -1,46 +1,94 @@
 #include "interpreter.h"
+#include "arithmetic.h"
+#include "compiler.h"
+#include "peephole.h"
 
-Interpreter::Interpreter() {}
+Interpreter::Interpreter(const TieringOptions& tiering,
+                         Output& out,
+                         Profile* profile)
+    : ast(nullptr), tiering(tiering), out(out), profile(profile), vm(out) {
+  if (profile != nullptr) {
+    this->tiering.enabled = false;
+  }
+}
+
+template <>
+std::int32_t Interpreter::visitLiteral<std::int32_t>(NodeId node) {
+  return static_cast<std::int32_t>((*ast)[node].value);
+}
+
+template <>
+double Interpreter::visitLiteral<double>(NodeId node) {
+  return ast->getFloat((*ast)[node].value);
+}
+
+template <>
+std::int32_t Interpreter::visitConvert<std::int32_t>(NodeId node) {
+  return arithmetic::toInt(visit<double>(ast->getChild(node, 0)));
+}
 
-int Interpreter::interpret(std::shared_ptr<ASTNode> root) {
-  if (root && root->type == NodeType::Program) {
-    for (const auto& child : root->children) {
-      executeStatement(child);
+template <>
+double Interpreter::visitConvert<double>(NodeId node) {
+  return arithmetic::toFloat(visit<std::int32_t>(ast->getChild(node, 0)));
+}
+
+int Interpreter::interpret(const AST& ast) {
+  if (!ast.isResolved()) {
+    throw std::runtime_error("AST has not been resolved");
+  }
+  this->ast = &ast;
+  variables.assign(ast.getSlotCount(), Value{});
+  loops.clear();
+  NodeId root = ast.getRoot();
+  if (ast.size() > 0 && ast[root].type == NodeType::Program) {
+    if (profile != nullptr) {
+      executeProgram<true>(root);
+    } else {
+      executeProgram<false>(root);
     }
   } else {
     throw std::runtime_error("Invalid AST");
   }
+  if (tiering.enabled && tiering.stats) {
+    printTieringStats();
+  }
   return 0;
 }
 
-int Interpreter::visit(std::shared_ptr<ASTNode> node) {
-  switch (node->type) {
+template <typename T>
+T Interpreter::visit(NodeId node) {
+  switch ((*ast)[node].type) {
     case NodeType::Identifier:
-      return visitIdentifier(node);
+      return visitIdentifier<T>(node);
     case NodeType::Expression:
-      return visitExpression(node);
+      return visitExpression<T>(node);
     case NodeType::Term:
-      return visitTerm(node);
-    case NodeType::Factor:
-      return visitFactor(node);
+      return visitTerm<T>(node);
     case NodeType::Literal:
-      return visitLiteral(node);
-    case NodeType::Operator:
-      return visitOperator(node);
+      return visitLiteral<T>(node);
     case NodeType::UnaryMinus:
-      return visitUnaryMinus(node);
-    case NodeType::StringLiteral:
-      return 0;
-    case NodeType::PrintStatement:
-      return visitPrintStatement(node);
+      return visitUnaryMinus<T>(node);
+    case NodeType::Convert:
+      return visitConvert<T>(node);
+    case NodeType::TripCount:
+      return static_cast<T>(visitTripCount(node));
     default:
       throw std::runtime_error("Unknown node type.");
   }
 }
 
-void Interpreter::executeStatement(std::shared_ptr<ASTNode> node) {
-  std::shared_ptr<ASTNode> childNode = node->children[0];
-  switch (node->type) {
+template <bool PROFILE>
+void Interpreter::executeProgram(NodeId root) {
+  for (const NodeId* child = ast->beginChildren(root);
+       child != ast->endChildren(root); child++) {
+    executeStatement<PROFILE>(*child);
+  }
+}
+
+template <bool PROFILE>
+void Interpreter::executeStatement(NodeId node) {
+  StatementTimer<PROFILE> timer(profile, node);
+  switch ((*ast)[node].type) {
     case NodeType::VarDeclaration:
       executeVarDeclaration(node);
       break;
@@ -48,19 +96,19 @@ void Interpreter::executeStatement(std::shared_ptr<ASTNode> node) {
       executeAssignment(node);
       break;
     case NodeType::PrintStatement:
-      if (childNode->type != NodeType::StringLiteral) {
-        std::cout << "> " << visitPrintStatement(node) << std::endl;
-      } else {
-        visitPrintStatement(node);
-      }
+      visitPrintStatement(node);
       break;
 
     case NodeType::IfStatement:
-      executeIfStatement(node);
+      executeIfStatement<PROFILE>(node);
       break;
 
     case NodeType::WhileStatement:
-      executeWhileStatement(node);
+      executeWhileStatement<PROFILE>(node);
+      break;
+
+    case NodeType::StatementList:
+      executeStatementList<PROFILE>(node);
       break;
 
     default:
@@ -68,153 +116,233 @@ void Interpreter::executeStatement(std::shared_ptr<ASTNode> node) {
   }
 }
 
-void Interpreter::executeIfStatement(std::shared_ptr<ASTNode> node) {
+// With PROFILE, the if counts how often its own branch is taken, and each
+// elif or else how often it is reached and taken.
+template <bool PROFILE>
+void Interpreter::executeIfStatement(NodeId node) {
   // First child is the condition, second child is the body
-  if (evaluateCondition(node->children[0])) {
-    executeStatementList(node->children[1]);
+  if (evaluateCondition(ast->getChild(node, 0))) {
+    if constexpr (PROFILE) {
+      (*profile)[node].taken++;
+    }
+    executeStatementList<PROFILE>(ast->getChild(node, 1));
   } else {
     // Handle elif and else parts if they exist
-    for (size_t i = 2; i < node->children.size(); ++i) {
-      auto child = node->children[i];
-      if (child->type == NodeType::ElifStatement &&
-          evaluateCondition(child->children[0])) {
-        executeStatementList(child->children[1]);
+    for (std::uint32_t i = 2; i < (*ast)[node].childCount; ++i) {
+      NodeId child = ast->getChild(node, i);
+      if constexpr (PROFILE) {
+        (*profile)[child].count++;
+      }
+      if ((*ast)[child].type == NodeType::ElifStatement &&
+          evaluateCondition(ast->getChild(child, 0))) {
+        if constexpr (PROFILE) {
+          (*profile)[child].taken++;
+        }
+        executeStatementList<PROFILE>(ast->getChild(child, 1));
         break;
-      } else if (child->type == NodeType::ElseStatement) {
-        executeStatementList(child->children[0]);
+      } else if ((*ast)[child].type == NodeType::ElseStatement) {
+        if constexpr (PROFILE) {
+          (*profile)[child].taken++;
+        }
+        executeStatementList<PROFILE>(ast->getChild(child, 0));
         break;
       }
     }
   }
 }
 
-void Interpreter::executeWhileStatement(std::shared_ptr<ASTNode> node) {
-  while (evaluateCondition(node->children[0])) {
-    executeStatementList(node->children[1]);
+template <bool PROFILE>
+void Interpreter::executeWhileStatement(NodeId node) {
+  NodeId condition = ast->getChild(node, 0);
+  NodeId body = ast->getChild(node, 1);
+  if (PROFILE || !tiering.enabled) {
+    while (evaluateCondition(condition)) {
+      if constexpr (PROFILE) {
+        (*profile)[node].taken++;
+      }
+      executeStatementList<PROFILE>(body);
+    }
+    return;
   }
-}
-
-bool Interpreter::evaluateCondition(std::shared_ptr<ASTNode> node) {
-  int left = visit(node->children[0]);
-  int right = visit(node->children[2]);
-  std::string comparator = node->children[1]->value;
-
-  if (comparator == "<")
-    return left < right;
-  else if (comparator == ">")
-    return left > right;
-  else if (comparator == "?") { /* Custom comparator logic */
-    return left == right;
-  } else if (comparator == "!") { /* Custom comparator logic */
-    return left != right;
-  } else
-    throw std::runtime_error("Invalid comparator in comparison.");
 
-  return false;  // Default case
+  // The loop header is the point where a hot loop moves over: every variable
+  // is up to date in `variables`, which the compiled loop then uses in place.
+  // Its chunk is kept, so later executions of the loop start there directly.
+  HotLoop& loop = loops[node];
+  while (loop.chunk == nullptr) {
+    if (loop.iterations >= tiering.threshold) {
+      tierUp(node, loop);
+      break;
+    }
+    if (!evaluateCondition(condition)) {
+      return;
+    }
+    executeStatementList<PROFILE>(body);
+    loop.iterations++;
+  }
+  vm.run(*loop.chunk, variables.data());
 }
 
-void Interpreter::executeStatementList(std::shared_ptr<ASTNode> nodeList) {
-  for (const auto& child : nodeList->children) {
-    executeStatement(child);
+void Interpreter::tierUp(NodeId node, HotLoop& loop) {
+  loop.chunk = std::make_unique<Chunk>(Compiler(*ast).compileLoop(node));
+  std::size_t nativeLoops = tiering.useJit ? jit.compile(*loop.chunk) : 0;
+  if (tiering.superinstructions) {
+    Peephole(*loop.chunk).optimize();
+  }
+  if (tiering.stats) {
+    Position position = ast->getPosition(node);
+    std::cerr << "tier-up: loop at " << position.getLine() << ":"
+              << position.getCol() << " after " << loop.iterations
+              << " iterations -> ";
+    if (nativeLoops > 0) {
+      std::cerr << "jit (native loops: " << nativeLoops << ")" << std::endl;
+    } else {
+      std::cerr << "vm" << std::endl;
+    }
   }
 }
 
-int Interpreter::visitIdentifier(std::shared_ptr<ASTNode> node) {
-  std::string varName = node->value;
-  if (symbolTable.find(varName) == symbolTable.end()) {
-    throw std::runtime_error("Variable not declared: " + varName);
+void Interpreter::printTieringStats() const {
+  std::size_t tiered = 0;
+  for (const auto& entry : loops) {
+    if (entry.second.chunk != nullptr) {
+      tiered++;
+    }
   }
-  if (symbolTable[varName] == std::nullopt) {
-    throw std::runtime_error("Variable used before assignment: " + varName);
+  std::cerr << "tiering: " << tiered << " of " << loops.size()
+            << " executed loops tiered up (threshold " << tiering.threshold
+            << ")" << std::endl;
+}
+
+bool Interpreter::evaluateCondition(NodeId node) {
+  if ((*ast)[node].dataType == DataType::Float) {
+    return compare<double>(node);
   }
-  return symbolTable[varName].value();
+  return compare<std::int32_t>(node);
 }
 
-void Interpreter::executeVarDeclaration(std::shared_ptr<ASTNode> node) {
-  std::string varName = node->children[1]->value;  // Identifier
-  symbolTable[varName] = std::nullopt;
+template <typename T>
+bool Interpreter::compare(NodeId node) {
+  T left = visit<T>(ast->getChild(node, 0));
+  T right = visit<T>(ast->getChild(node, 2));
 
-  if (node->children.size() > 2) {  // Check for expression
-    int varValue = visit(node->children[2]);
-    symbolTable[varName] = varValue;  // Expression
+  switch (static_cast<Comparator>((*ast)[ast->getChild(node, 1)].op)) {
+    case Comparator::Less:
+      return left < right;
+    case Comparator::Greater:
+      return left > right;
+    case Comparator::Equal: /* Custom comparator logic */
+      return left == right;
+    case Comparator::NotEqual: /* Custom comparator logic */
+      return left != right;
   }
+  throw std::runtime_error("Invalid comparator in comparison.");
 }
 
-void Interpreter::executeAssignment(std::shared_ptr<ASTNode> node) {
-  std::string varName = node->children[0]->value;  // Identifier
-
-  if (symbolTable.find(varName) == symbolTable.end()) {
-    throw std::runtime_error("Variable not declared: " + varName);
+template <bool PROFILE>
+void Interpreter::executeStatementList(NodeId nodeList) {
+  for (const NodeId* child = ast->beginChildren(nodeList);
+       child != ast->endChildren(nodeList); child++) {
+    executeStatement<PROFILE>(*child);
   }
+}
 
-  int varValue = visit(node->children[1]);  // Expression
-  symbolTable[varName] = varValue;
+template <typename T>
+T Interpreter::visitIdentifier(NodeId node) {
+  return variables[(*ast)[node].value].get<T>();
 }
 
-int Interpreter::visitUnaryMinus(std::shared_ptr<ASTNode> node) {
-  return -visit(node->children[0]);
+void Interpreter::executeVarDeclaration(NodeId node) {
+  if ((*ast)[node].childCount > 2) {  // Check for expression
+    store(ast->getChild(node, 1), ast->getChild(node, 2));
+  }
 }
 
-int Interpreter::visitOperator(std::shared_ptr<ASTNode> node) {
-  return 0;
+void Interpreter::executeAssignment(NodeId node) {
+  store(ast->getChild(node, 0), ast->getChild(node, 1));
 }
 
-int Interpreter::visitLiteral(std::shared_ptr<ASTNode> node) {
-  return std::stoi(node->value);
+void Interpreter::store(NodeId identifier, NodeId expression) {
+  Value& variable = variables[(*ast)[identifier].value];
+  if ((*ast)[identifier].dataType == DataType::Float) {
+    variable.f = visit<double>(expression);
+  } else {
+    variable.i = visit<std::int32_t>(expression);
+  }
 }
 
-int Interpreter::visitExpression(std::shared_ptr<ASTNode> node) {
-  int result = visit(node->children[0]);
-  for (size_t i = 1; i < node->children.size(); i += 2) {
-    auto op = node->children[i]->value;
-    auto right = visit(node->children[i + 1]);
-    if (op == "+") {
-      result += right;
-    } else if (op == "-") {
-      result -= right;
-    }
+template <typename T>
+T Interpreter::visitUnaryMinus(NodeId node) {
+  return arithmetic::negate(visit<T>(ast->getChild(node, 0)));
+}
+
+std::int32_t Interpreter::visitTripCount(NodeId node) {
+  std::int32_t i = visit<std::int32_t>(ast->getChild(node, 0));
+  std::int32_t bound = visit<std::int32_t>(ast->getChild(node, 1));
+  std::int32_t step = static_cast<std::int32_t>((*ast)[node].value);
+  switch (static_cast<Comparator>((*ast)[node].op)) {
+    case Comparator::Less:
+      return arithmetic::tripCountLess(i, bound, step);
+    case Comparator::Greater:
+      return arithmetic::tripCountGreater(i, bound, step);
+    case Comparator::Equal:
+      return arithmetic::tripCountEqual(i, bound, step);
+    case Comparator::NotEqual:
+      return arithmetic::tripCountNotEqual(i, bound, step);
   }
-  return result;
+  throw std::runtime_error("Invalid comparator in trip count.");
 }
 
-int Interpreter::visitTerm(std::shared_ptr<ASTNode> node) {
-  int result = visit(node->children[0]);
-  for (size_t i = 1; i < node->children.size(); i += 2) {
-    auto op = node->children[i]->value;
-    auto right = visit(node->children[i + 1]);
-    if (op == "*") {
-      result *= right;
-    } else if (op == "/") {
-      result /= right;
+template <typename T>
+T Interpreter::visitExpression(NodeId node) {
+  T result = visit<T>(ast->getChild(node, 0));
+  for (std::uint32_t i = 1; i < (*ast)[node].childCount; i += 2) {
+    Operator op = static_cast<Operator>((*ast)[ast->getChild(node, i)].op);
+    T right = visit<T>(ast->getChild(node, i + 1));
+    if (op == Operator::Add) {
+      result = arithmetic::add(result, right);
+    } else if (op == Operator::Subtract) {
+      result = arithmetic::subtract(result, right);
     }
   }
   return result;
 }
 
-int Interpreter::visitFactor(std::shared_ptr<ASTNode> node) {
-  switch (node->type) {
-    case NodeType::Literal:
-      return std::stoi(node->value);
-    case NodeType::Identifier:
-      return visitIdentifier(node);
-    case NodeType::Expression:
-      return visitExpression(node);
-    default:
-      throw std::runtime_error("Invalid factor.");
+template <typename T>
+T Interpreter::visitTerm(NodeId node) {
+  T result = visit<T>(ast->getChild(node, 0));
+  for (std::uint32_t i = 1; i < (*ast)[node].childCount; i += 2) {
+    NodeId opNode = ast->getChild(node, i);
+    Operator op = static_cast<Operator>((*ast)[opNode].op);
+    T right = visit<T>(ast->getChild(node, i + 1));
+    if (op == Operator::Multiply) {
+      result = arithmetic::multiply(result, right);
+    } else if (op == Operator::Divide) {
+      if (right == 0) {
+        Position position = ast->getPosition(opNode);
+        throw RuntimeError(position, position, "Division by zero.");
+      }
+      result = arithmetic::divide(result, right);
+    }
   }
+  return result;
 }
 
-int Interpreter::visitPrintStatement(std::shared_ptr<ASTNode> node) {
-  std::shared_ptr<ASTNode> childNode = node->children[0];
-  switch (childNode->type) {
-    case NodeType::Expression:
-      return visitExpression(childNode);
-    case NodeType::Identifier:
-      return visitIdentifier(childNode);
+void Interpreter::visitPrintStatement(NodeId node) {
+  NodeId childNode = ast->getChild(node, 0);
+  switch ((*ast)[childNode].type) {
     case NodeType::StringLiteral:
-      std::cout << "> " << childNode->value << std::endl;
-      return 0;
+      out.printString(ast->getString((*ast)[childNode].value));
+      break;
     default:
-      throw std::runtime_error("Invalid node type in print statement.");
+      // Evaluate first, so a failing expression prints nothing.
+      if ((*ast)[childNode].dataType == DataType::Float) {
+        double value = visit<double>(childNode);
+        out.printFloat(value);
+      } else {
+        std::int32_t value = visit<std::int32_t>(childNode);
+        out.printInt(value);
+      }
+      break;
   }
-}
\ No newline at end of file
+}
@@ -0,0 +1,110 @@
+#include "ir.h"
+#include <cstring>
+#include <sstream>
+
+ValueId IRProgram::resolve(ValueId value) const {
+  while (values[value].replacement != value) {
+    value = values[value].replacement;
+  }
+  return value;
+}
+
+bool IRProgram::isConstant(ValueId value) const {
+  return values[resolve(value)].op == IROp::Constant;
+}
+
+namespace {
+
+const char* const opNames[] = {"const", "undef",    "phi",   "add",
+                               "sub",   "mul",      "div",   "neg",
+                               "itof",  "ftoi",     "less",  "greater",
+                               "equal", "notequal"};
+const char* const typeNames[] = {"int", "float"};
+
+std::string operandString(const IRProgram& ir, const AST& ast, ValueId id) {
+  const IRValue& value = ir.values[ir.resolve(id)];
+  if (value.op == IROp::Constant) {
+    if (value.type == DataType::Float) {
+      double number;
+      std::memcpy(&number, &value.bits, sizeof(number));
+      std::ostringstream stream;
+      stream << number;
+      return stream.str();
+    }
+    return std::to_string(static_cast<std::int32_t>(value.bits));
+  }
+  if (value.op == IROp::Undefined) {
+    return "undef " + ast.getSlotName(value.slot);
+  }
+  return "v" + std::to_string(ir.resolve(id));
+}
+
+}  // namespace
+
+std::string IRProgram::asString(const AST& ast) const {
+  std::string result;
+  for (std::size_t b = 0; b < blocks.size(); b++) {
+    const IRBlock& block = blocks[b];
+    result += "b" + std::to_string(b) + ":";
+    if (!block.predecessors.empty()) {
+      result += "  ; from";
+      for (std::uint32_t predecessor : block.predecessors) {
+        result += " b" + std::to_string(predecessor);
+      }
+    }
+    result += "\n";
+
+    for (const IRInstruction& instruction : block.code) {
+      result += "  ";
+      switch (instruction.kind) {
+        case IRKind::Value: {
+          const IRValue& value = values[instruction.value];
+          if (value.replacement != instruction.value) {
+            result += "; v" + std::to_string(instruction.value) + " = " +
+                      operandString(*this, ast, instruction.value) + "\n";
+            continue;
+          }
+          result += "v" + std::to_string(instruction.value) + " = " +
+                    opNames[static_cast<int>(value.op)] + " " +
+                    typeNames[static_cast<int>(value.type)];
+          for (std::size_t i = 0; i < value.operands.size(); i++) {
+            result += i == 0 ? " " : ", ";
+            if (value.op == IROp::Phi) {
+              result += "[" + operandString(*this, ast, value.operands[i]) +
+                        ", b" + std::to_string(block.predecessors[i]) + "]";
+            } else {
+              result += operandString(*this, ast, value.operands[i]);
+            }
+          }
+          if (value.op == IROp::Phi) {
+            result += "  ; " + ast.getSlotName(value.slot);
+          }
+          break;
+        }
+        case IRKind::Store:
+          result += "store " + ast.getSlotName(instruction.operand) + ", " +
+                    operandString(*this, ast, instruction.value);
+          if (instruction.removed) {
+            result += "  ; removed";
+          }
+          break;
+        case IRKind::Print:
+          result += "print " + operandString(*this, ast, instruction.value);
+          break;
+        case IRKind::PrintString:
+          result += "print \"" + ast.getString(instruction.operand) + "\"";
+          break;
+        case IRKind::Jump:
+          result += "jump b" + std::to_string(instruction.targets[0]);
+          break;
+        case IRKind::Branch:
+          result += "branch " + operandString(*this, ast, instruction.value) +
+                    ", b" + std::to_string(instruction.targets[0]) + ", b" +
+                    std::to_string(instruction.targets[1]);
+          break;
+      }
+      result += "\n";
+    }
+  }
+  return result;
+}
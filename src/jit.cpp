@@ -0,0 +1,830 @@
+#include "jit.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+
+#if defined(__x86_64__) && defined(__linux__)
+#include <sys/mman.h>
+#include <unistd.h>
+#define JIT_X86_64 1
+#endif
+
+namespace {
+
+enum Register : int {
+  RAX,
+  RCX,
+  RDX,
+  RBX,
+  RSP,
+  RBP,
+  RSI,
+  RDI,
+  R8,
+  R9,
+  R10,
+  R11,
+  R12,
+  R13,
+  R14,
+  R15
+};
+
+enum Condition : std::uint8_t {
+  Equal = 0x4,
+  NotEqual = 0x5,
+  BelowOrEqual = 0x6,
+  Parity = 0xA,
+  Less = 0xC,
+  GreaterOrEqual = 0xD,
+  LessOrEqual = 0xE,
+  Greater = 0xF
+};
+
+// Emits the handful of x86-64 instructions the loop compiler needs. Integer
+// operations are 32 bits wide, which gives the wrapping int semantics for
+// free. Memory operands are always [rdi + disp32], rdi holding the variable
+// array.
+class Assembler {
+ public:
+  int newLabel() {
+    labels.push_back(-1);
+    return static_cast<int>(labels.size() - 1);
+  }
+  void bind(int label) { labels[label] = static_cast<int>(code.size()); }
+
+  void movRR(int dst, int src) { aluRR(0x89, dst, src); }
+  void addRR(int dst, int src) { aluRR(0x01, dst, src); }
+  void subRR(int dst, int src) { aluRR(0x29, dst, src); }
+  void xorRR(int dst, int src) { aluRR(0x31, dst, src); }
+  void cmpRR(int left, int right) { aluRR(0x39, left, right); }
+  void testRR(int left, int right) { aluRR(0x85, left, right); }
+  void imulRR(int dst, int src) {
+    rex(false, dst, src);
+    bytes({0x0F, 0xAF});
+    modrm(3, dst, src);
+  }
+  void negR(int reg) { unary(3, reg); }
+  void idivR(int reg) { unary(7, reg); }
+  void cdq() { byte(0x99); }
+  // 64-bit forms, for arithmetic that must not wrap.
+  void addRR64(int dst, int src) { aluRR(0x01, dst, src, true); }
+  void subRR64(int dst, int src) { aluRR(0x29, dst, src, true); }
+  void cmpRR64(int left, int right) { aluRR(0x39, left, right, true); }
+  void testRR64(int left, int right) { aluRR(0x85, left, right, true); }
+  void imulRR64(int dst, int src) {
+    rex(true, dst, src);
+    bytes({0x0F, 0xAF});
+    modrm(3, dst, src);
+  }
+  void idivR64(int reg) { unary(7, reg, true); }
+  void cqo() { bytes({0x48, 0x99}); }
+  void movsxd(int dst, int src) {
+    rex(true, dst, src);
+    byte(0x63);
+    modrm(3, dst, src);
+  }
+  void cmpRI8(int reg, std::int8_t value) {
+    rex(false, 0, reg);
+    byte(0x83);
+    modrm(3, 7, reg);
+    byte(static_cast<std::uint8_t>(value));
+  }
+  void movRI(int reg, std::uint32_t value) {
+    rex(false, 0, reg);
+    byte(0xB8 + (reg & 7));
+    dword(value);
+  }
+  void movRI64(int reg, std::uint64_t value) {
+    rex(true, 0, reg);
+    byte(0xB8 + (reg & 7));
+    dword(static_cast<std::uint32_t>(value));
+    dword(static_cast<std::uint32_t>(value >> 32));
+  }
+  void btcRI(int reg, std::uint8_t bit) {
+    rex(true, 0, reg);
+    bytes({0x0F, 0xBA});
+    modrm(3, 7, reg);
+    byte(bit);
+  }
+  void load(int reg, std::int32_t offset) { memory(0x8B, reg, offset); }
+  void store(std::int32_t offset, int reg) { memory(0x89, reg, offset); }
+  void push(int reg) {
+    rex(false, 0, reg);
+    byte(0x50 + (reg & 7));
+  }
+  void pop(int reg) {
+    rex(false, 0, reg);
+    byte(0x58 + (reg & 7));
+  }
+  void ret() { byte(0xC3); }
+
+  // Scalar double instructions; registers are xmm numbers.
+  void movsdRR(int dst, int src) { sse(0xF2, 0x10, dst, src); }
+  void movsdLoad(int reg, std::int32_t offset) {
+    byte(0xF2);
+    memory(0x10, reg, offset, true);
+  }
+  void movsdStore(std::int32_t offset, int reg) {
+    byte(0xF2);
+    memory(0x11, reg, offset, true);
+  }
+  void addsd(int dst, int src) { sse(0xF2, 0x58, dst, src); }
+  void mulsd(int dst, int src) { sse(0xF2, 0x59, dst, src); }
+  void subsd(int dst, int src) { sse(0xF2, 0x5C, dst, src); }
+  void minsd(int dst, int src) { sse(0xF2, 0x5D, dst, src); }
+  void divsd(int dst, int src) { sse(0xF2, 0x5E, dst, src); }
+  void maxsd(int dst, int src) { sse(0xF2, 0x5F, dst, src); }
+  void ucomisd(int left, int right) { sse(0x66, 0x2E, left, right); }
+  void xorpd(int dst, int src) { sse(0x66, 0x57, dst, src); }
+  void cvtsi2sd(int dst, int src) { sse(0xF2, 0x2A, dst, src); }
+  void cvttsd2si(int dst, int src) { sse(0xF2, 0x2C, dst, src); }
+  void movqToXmm(int dst, int src) { sse(0x66, 0x6E, dst, src, true); }
+  void movqFromXmm(int dst, int src) { sse(0x66, 0x7E, src, dst, true); }
+
+  void jmp(int label) {
+    byte(0xE9);
+    fixup(label);
+  }
+  void jcc(Condition condition, int label) {
+    bytes({0x0F, static_cast<std::uint8_t>(0x80 | condition)});
+    fixup(label);
+  }
+
+  // Resolves jumps; fails if a label was never bound.
+  bool finish() {
+    for (const Fixup& jump : fixups) {
+      if (labels[jump.label] < 0) {
+        return false;
+      }
+      std::int32_t distance =
+          labels[jump.label] - static_cast<std::int32_t>(jump.at + 4);
+      std::memcpy(&code[jump.at], &distance, sizeof(distance));
+    }
+    return true;
+  }
+
+  const std::vector<std::uint8_t>& getCode() const { return code; }
+
+ private:
+  struct Fixup {
+    std::size_t at;
+    int label;
+  };
+
+  std::vector<std::uint8_t> code;
+  std::vector<int> labels;
+  std::vector<Fixup> fixups;
+
+  void byte(std::uint8_t value) { code.push_back(value); }
+  void bytes(std::initializer_list<std::uint8_t> values) {
+    code.insert(code.end(), values);
+  }
+  void dword(std::uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+      byte(static_cast<std::uint8_t>(value >> (i * 8)));
+    }
+  }
+  void rex(bool wide, int reg, int rm) {
+    std::uint8_t prefix = 0x40 | (wide ? 0x08 : 0) | ((reg & 8) >> 1) |
+                          ((rm & 8) >> 3);
+    if (prefix != 0x40) {
+      byte(prefix);
+    }
+  }
+  void modrm(int mod, int reg, int rm) {
+    byte(static_cast<std::uint8_t>((mod << 6) | ((reg & 7) << 3) | (rm & 7)));
+  }
+  void aluRR(std::uint8_t opcode, int rm, int reg, bool wide = false) {
+    rex(wide, reg, rm);
+    byte(opcode);
+    modrm(3, reg, rm);
+  }
+  void unary(int extension, int reg, bool wide = false) {
+    rex(wide, 0, reg);
+    byte(0xF7);
+    modrm(3, extension, reg);
+  }
+  void memory(std::uint8_t opcode,
+              int reg,
+              std::int32_t offset,
+              bool twoByte = false) {
+    rex(false, reg, RDI);
+    if (twoByte) {
+      byte(0x0F);
+    }
+    byte(opcode);
+    modrm(2, reg, RDI);
+    dword(static_cast<std::uint32_t>(offset));
+  }
+  void sse(std::uint8_t prefix,
+           std::uint8_t opcode,
+           int reg,
+           int rm,
+           bool wide = false) {
+    byte(prefix);
+    rex(wide, reg, rm);
+    bytes({0x0F, opcode});
+    modrm(3, reg, rm);
+  }
+  void fixup(int label) {
+    fixups.push_back({code.size(), label});
+    dword(0);
+  }
+};
+
+// The operand stack lives in registers, one per depth, so a loop is only
+// compiled when its expressions stay shallow enough.
+constexpr int MAX_DEPTH = 5;
+const int INT_STACK[MAX_DEPTH] = {R8, R9, R10, R11, RSI};
+const int FLOAT_STACK[MAX_DEPTH] = {0, 1, 2, 3, 4};
+// Variables kept in registers for the whole loop. The int ones are
+// callee-saved and restored on the way out.
+const int INT_VARIABLES[] = {RBX, R12, R13, R14, R15};
+const int FLOAT_VARIABLES[] = {8, 9, 10, 11, 12, 13};
+constexpr int XMM_SCRATCH = 15;
+
+// Translates the bytecode of one loop, instructions start..end, into a
+// function following the System V calling convention.
+class LoopCompiler {
+ public:
+  LoopCompiler(const Chunk& chunk, std::size_t start, std::size_t end)
+      : chunk(chunk), start(start), end(end), depth(0) {}
+
+  bool compile();
+  const std::vector<std::uint8_t>& getCode() const { return as.getCode(); }
+
+ private:
+  const Chunk& chunk;
+  std::size_t start;
+  std::size_t end;
+  Assembler as;
+  // One label per instruction, plus one for the loop exit.
+  std::vector<int> labels;
+  int epilogue;
+  std::vector<std::pair<int, std::int32_t>> errors;
+  std::vector<int> variableRegisters;
+  std::vector<std::uint32_t> allocated;
+  int depth;
+  DataType types[MAX_DEPTH];
+
+  int labelOf(std::int32_t target) const { return labels[target - start]; }
+  int errorLabel(std::size_t index);
+  void allocateVariables();
+  void loadVariable(std::uint32_t slot, int reg, DataType type);
+  void storeVariable(std::uint32_t slot, int reg, DataType type);
+  bool compileInstruction(std::size_t& index,
+                          const std::vector<bool>& isTarget);
+  bool compileBranch(OpCode comparison, std::int32_t target);
+  void compileTripCount(OpCode op, std::int32_t step);
+  void compileFloatToInt(int dst, int src);
+};
+
+bool LoopCompiler::compile() {
+  std::size_t count = end - start + 1;
+  std::vector<bool> isTarget(count + 1, false);
+  for (std::size_t i = start; i <= end; i++) {
+    const Instruction& instruction = chunk.code[i];
+    if (instruction.op == OpCode::Jump ||
+        instruction.op == OpCode::JumpIfFalse) {
+      std::int64_t target = instruction.operand;
+      if (target < static_cast<std::int64_t>(start) ||
+          target > static_cast<std::int64_t>(end + 1)) {
+        return false;
+      }
+      isTarget[target - start] = true;
+    }
+  }
+  for (std::size_t i = 0; i <= count; i++) {
+    labels.push_back(as.newLabel());
+  }
+  epilogue = as.newLabel();
+
+  allocateVariables();
+  for (int reg : INT_VARIABLES) {
+    as.push(reg);
+  }
+  for (std::uint32_t slot : allocated) {
+    loadVariable(slot, variableRegisters[slot], chunk.slotTypes[slot]);
+  }
+
+  for (std::size_t i = start; i <= end; i++) {
+    as.bind(labels[i - start]);
+    if (isTarget[i - start] && depth != 0) {
+      return false;
+    }
+    if (!compileInstruction(i, isTarget)) {
+      return false;
+    }
+  }
+  if (depth != 0) {
+    return false;
+  }
+
+  as.bind(labels[count]);
+  as.movRI(RAX, static_cast<std::uint32_t>(-1));
+  as.bind(epilogue);
+  for (std::uint32_t slot : allocated) {
+    storeVariable(slot, variableRegisters[slot], chunk.slotTypes[slot]);
+  }
+  for (int i = static_cast<int>(std::size(INT_VARIABLES)) - 1; i >= 0; i--) {
+    as.pop(INT_VARIABLES[i]);
+  }
+  as.ret();
+
+  for (const auto& [label, index] : errors) {
+    as.bind(label);
+    as.movRI(RAX, static_cast<std::uint32_t>(index));
+    as.jmp(epilogue);
+  }
+  return as.finish();
+}
+
+bool LoopCompiler::compileInstruction(std::size_t& index,
+                                      const std::vector<bool>& isTarget) {
+  const Instruction& instruction = chunk.code[index];
+  std::int32_t operand = instruction.operand;
+  switch (instruction.op) {
+    case OpCode::Constant:
+    case OpCode::ConstantFloat:
+    case OpCode::Load: {
+      if (depth == MAX_DEPTH) {
+        return false;
+      }
+      if (instruction.op == OpCode::Constant) {
+        as.movRI(INT_STACK[depth], static_cast<std::uint32_t>(operand));
+        types[depth] = DataType::Int;
+      } else if (instruction.op == OpCode::ConstantFloat) {
+        std::uint64_t bits;
+        std::memcpy(&bits, &chunk.floats[operand], sizeof(bits));
+        as.movRI64(RCX, bits);
+        as.movqToXmm(FLOAT_STACK[depth], RCX);
+        types[depth] = DataType::Float;
+      } else {
+        DataType type = chunk.slotTypes[operand];
+        loadVariable(operand,
+                     type == DataType::Float ? FLOAT_STACK[depth]
+                                             : INT_STACK[depth],
+                     type);
+        types[depth] = type;
+      }
+      depth++;
+      return true;
+    }
+    case OpCode::Store: {
+      depth--;
+      DataType type = chunk.slotTypes[operand];
+      if (types[depth] != type) {
+        return false;
+      }
+      storeVariable(operand,
+                    type == DataType::Float ? FLOAT_STACK[depth]
+                                            : INT_STACK[depth],
+                    type);
+      return true;
+    }
+    case OpCode::Add:
+      depth--;
+      as.addRR(INT_STACK[depth - 1], INT_STACK[depth]);
+      return true;
+    case OpCode::Subtract:
+      depth--;
+      as.subRR(INT_STACK[depth - 1], INT_STACK[depth]);
+      return true;
+    case OpCode::Multiply:
+      depth--;
+      as.imulRR(INT_STACK[depth - 1], INT_STACK[depth]);
+      return true;
+    case OpCode::Divide: {
+      depth--;
+      int left = INT_STACK[depth - 1];
+      int right = INT_STACK[depth];
+      int divide = as.newLabel();
+      int done = as.newLabel();
+      as.testRR(right, right);
+      as.jcc(Equal, errorLabel(index));
+      // idiv faults on INT_MIN / -1, which has to wrap instead.
+      as.cmpRI8(right, -1);
+      as.jcc(NotEqual, divide);
+      as.negR(left);
+      as.jmp(done);
+      as.bind(divide);
+      as.movRR(RAX, left);
+      as.cdq();
+      as.idivR(right);
+      as.movRR(left, RAX);
+      as.bind(done);
+      return true;
+    }
+    case OpCode::Negate:
+      as.negR(INT_STACK[depth - 1]);
+      return true;
+    case OpCode::AddFloat:
+      depth--;
+      as.addsd(FLOAT_STACK[depth - 1], FLOAT_STACK[depth]);
+      return true;
+    case OpCode::SubtractFloat:
+      depth--;
+      as.subsd(FLOAT_STACK[depth - 1], FLOAT_STACK[depth]);
+      return true;
+    case OpCode::MultiplyFloat:
+      depth--;
+      as.mulsd(FLOAT_STACK[depth - 1], FLOAT_STACK[depth]);
+      return true;
+    case OpCode::DivideFloat: {
+      depth--;
+      int nonZero = as.newLabel();
+      as.xorpd(XMM_SCRATCH, XMM_SCRATCH);
+      as.ucomisd(FLOAT_STACK[depth], XMM_SCRATCH);
+      as.jcc(Parity, nonZero);
+      as.jcc(Equal, errorLabel(index));
+      as.bind(nonZero);
+      as.divsd(FLOAT_STACK[depth - 1], FLOAT_STACK[depth]);
+      return true;
+    }
+    case OpCode::NegateFloat:
+      as.movqFromXmm(RCX, FLOAT_STACK[depth - 1]);
+      as.btcRI(RCX, 63);
+      as.movqToXmm(FLOAT_STACK[depth - 1], RCX);
+      return true;
+    case OpCode::IntToFloat:
+      as.cvtsi2sd(FLOAT_STACK[depth - 1], INT_STACK[depth - 1]);
+      types[depth - 1] = DataType::Float;
+      return true;
+    case OpCode::FloatToInt:
+      compileFloatToInt(INT_STACK[depth - 1], FLOAT_STACK[depth - 1]);
+      types[depth - 1] = DataType::Int;
+      return true;
+    case OpCode::TripCountLess:
+    case OpCode::TripCountGreater:
+    case OpCode::TripCountEqual:
+    case OpCode::TripCountNotEqual:
+      compileTripCount(instruction.op, operand);
+      depth--;
+      return true;
+    case OpCode::Less:
+    case OpCode::Greater:
+    case OpCode::Equal:
+    case OpCode::NotEqual:
+    case OpCode::LessFloat:
+    case OpCode::GreaterFloat:
+    case OpCode::EqualFloat:
+    case OpCode::NotEqualFloat: {
+      // Comparisons are only supported fused with the jump that follows.
+      std::size_t next = index + 1;
+      if (next > end || chunk.code[next].op != OpCode::JumpIfFalse ||
+          isTarget[next - start]) {
+        return false;
+      }
+      if (!compileBranch(instruction.op, chunk.code[next].operand)) {
+        return false;
+      }
+      as.bind(labels[next - start]);
+      index = next;
+      return true;
+    }
+    case OpCode::Jump:
+      if (depth != 0) {
+        return false;
+      }
+      as.jmp(labelOf(operand));
+      return true;
+    default:
+      return false;
+  }
+}
+
+// Jumps to target when the comparison of the top two values is false.
+bool LoopCompiler::compileBranch(OpCode comparison, std::int32_t target) {
+  depth -= 2;
+  if (depth != 0) {
+    return false;
+  }
+  int left = INT_STACK[0];
+  int right = INT_STACK[1];
+  int leftFloat = FLOAT_STACK[0];
+  int rightFloat = FLOAT_STACK[1];
+  int label = labelOf(target);
+  switch (comparison) {
+    case OpCode::Less:
+      as.cmpRR(left, right);
+      as.jcc(GreaterOrEqual, label);
+      break;
+    case OpCode::Greater:
+      as.cmpRR(left, right);
+      as.jcc(LessOrEqual, label);
+      break;
+    case OpCode::Equal:
+      as.cmpRR(left, right);
+      as.jcc(NotEqual, label);
+      break;
+    case OpCode::NotEqual:
+      as.cmpRR(left, right);
+      as.jcc(Equal, label);
+      break;
+    // An unordered comparison (NaN) sets ZF, PF and CF; every test but
+    // NotEqual is false then.
+    case OpCode::LessFloat:
+      as.ucomisd(rightFloat, leftFloat);
+      as.jcc(BelowOrEqual, label);
+      break;
+    case OpCode::GreaterFloat:
+      as.ucomisd(leftFloat, rightFloat);
+      as.jcc(BelowOrEqual, label);
+      break;
+    case OpCode::EqualFloat:
+      as.ucomisd(leftFloat, rightFloat);
+      as.jcc(Parity, label);
+      as.jcc(NotEqual, label);
+      break;
+    case OpCode::NotEqualFloat: {
+      int fallThrough = as.newLabel();
+      as.ucomisd(leftFloat, rightFloat);
+      as.jcc(Parity, fallThrough);
+      as.jcc(Equal, label);
+      as.bind(fallThrough);
+      break;
+    }
+    default:
+      return false;
+  }
+  return true;
+}
+
+// Same as arithmetic::tripCountLess and friends, with the step known here.
+// The count is worked out in 64 bits, then checked against the int range.
+void LoopCompiler::compileTripCount(OpCode op, std::int32_t step) {
+  int i = INT_STACK[depth - 2];
+  int bound = INT_STACK[depth - 1];
+  int zero = as.newLabel();
+  int fail = as.newLabel();
+  int done = as.newLabel();
+  static const Condition notEntered[] = {GreaterOrEqual, LessOrEqual, NotEqual,
+                                         Equal};
+  bool advances = op == OpCode::TripCountLess      ? step > 0
+                  : op == OpCode::TripCountGreater ? step < 0
+                                                   : step != 0;
+  as.cmpRR(i, bound);
+  as.jcc(notEntered[static_cast<int>(op) -
+                    static_cast<int>(OpCode::TripCountLess)],
+         zero);
+  if (!advances) {
+    as.jmp(fail);
+  } else if (op == OpCode::TripCountEqual) {
+    as.movRI(i, 1);
+    as.jmp(done);
+  } else {
+    if (op == OpCode::TripCountNotEqual) {
+      as.movsxd(RAX, bound);
+      as.movsxd(RCX, i);
+      as.subRR64(RAX, RCX);
+      as.cqo();
+      as.movRI64(RCX,
+                 static_cast<std::uint64_t>(static_cast<std::int64_t>(step)));
+      as.idivR64(RCX);
+      as.testRR64(RDX, RDX);
+      as.jcc(NotEqual, fail);
+      as.testRR64(RAX, RAX);
+      as.jcc(Less, fail);
+    } else {
+      // count = (distance - 1) / stride + 1 with distance = |bound - i| > 0,
+      // and i must not move past the int range on the way.
+      bool up = op == OpCode::TripCountLess;
+      std::int64_t stride = up ? step : -static_cast<std::int64_t>(step);
+      as.movsxd(RAX, up ? bound : i);
+      as.movsxd(RCX, up ? i : bound);
+      as.subRR64(RAX, RCX);
+      as.movRI(RCX, 1);
+      as.subRR64(RAX, RCX);
+      as.cqo();
+      as.movRI(RCX, static_cast<std::uint32_t>(stride));
+      as.idivR64(RCX);
+      as.movRI(RDX, 1);
+      as.addRR64(RAX, RDX);
+      as.imulRR64(RCX, RAX);
+      if (up) {
+        as.movsxd(RDX, i);
+        as.movRI(bound, 0x7FFFFFFF);
+        as.subRR64(bound, RDX);
+      } else {
+        as.movsxd(bound, i);
+        as.movRI64(RDX, static_cast<std::uint64_t>(-0x80000000LL));
+        as.subRR64(bound, RDX);
+      }
+      as.cmpRR64(RCX, bound);
+      as.jcc(Greater, fail);
+    }
+    // RAX holds the count.
+    as.movRI(RDX, 0x7FFFFFFF);
+    as.cmpRR64(RAX, RDX);
+    as.jcc(Greater, fail);
+    as.movRR(i, RAX);
+    as.jmp(done);
+  }
+  as.bind(zero);
+  as.movRI(i, 0);
+  as.jmp(done);
+  as.bind(fail);
+  as.movRI(i, static_cast<std::uint32_t>(-1));
+  as.bind(done);
+}
+
+// Same as arithmetic::toInt: truncate, saturate, and map NaN to 0.
+void LoopCompiler::compileFloatToInt(int dst, int src) {
+  static const double lowest = -2147483648.0;
+  static const double highest = 2147483647.0;
+  std::uint64_t bits;
+  int isNaN = as.newLabel();
+  int done = as.newLabel();
+  as.ucomisd(src, src);
+  as.jcc(Parity, isNaN);
+  std::memcpy(&bits, &lowest, sizeof(bits));
+  as.movRI64(RCX, bits);
+  as.movqToXmm(XMM_SCRATCH, RCX);
+  as.maxsd(src, XMM_SCRATCH);
+  std::memcpy(&bits, &highest, sizeof(bits));
+  as.movRI64(RCX, bits);
+  as.movqToXmm(XMM_SCRATCH, RCX);
+  as.minsd(src, XMM_SCRATCH);
+  as.cvttsd2si(dst, src);
+  as.jmp(done);
+  as.bind(isNaN);
+  as.xorRR(dst, dst);
+  as.bind(done);
+}
+
+int LoopCompiler::errorLabel(std::size_t index) {
+  int label = as.newLabel();
+  errors.push_back({label, static_cast<std::int32_t>(index)});
+  return label;
+}
+
+// The variables used most often inside the loop get the registers.
+void LoopCompiler::allocateVariables() {
+  std::vector<std::uint32_t> uses(chunk.slotCount, 0);
+  for (std::size_t i = start; i <= end; i++) {
+    const Instruction& instruction = chunk.code[i];
+    if (instruction.op == OpCode::Load || instruction.op == OpCode::Store) {
+      uses[instruction.operand]++;
+    }
+  }
+  std::vector<std::uint32_t> slots;
+  for (std::uint32_t slot = 0; slot < chunk.slotCount; slot++) {
+    if (uses[slot] > 0) {
+      slots.push_back(slot);
+    }
+  }
+  std::stable_sort(slots.begin(), slots.end(),
+                   [&](std::uint32_t a, std::uint32_t b) {
+                     return uses[a] > uses[b];
+                   });
+
+  variableRegisters.assign(chunk.slotCount, -1);
+  std::size_t ints = 0;
+  std::size_t floats = 0;
+  for (std::uint32_t slot : slots) {
+    if (chunk.slotTypes[slot] == DataType::Float) {
+      if (floats < std::size(FLOAT_VARIABLES)) {
+        variableRegisters[slot] = FLOAT_VARIABLES[floats++];
+        allocated.push_back(slot);
+      }
+    } else if (ints < std::size(INT_VARIABLES)) {
+      variableRegisters[slot] = INT_VARIABLES[ints++];
+      allocated.push_back(slot);
+    }
+  }
+}
+
+void LoopCompiler::loadVariable(std::uint32_t slot, int reg, DataType type) {
+  int home = variableRegisters[slot];
+  std::int32_t offset = static_cast<std::int32_t>(slot * sizeof(Value));
+  if (type == DataType::Float) {
+    if (home >= 0 && home != reg) {
+      as.movsdRR(reg, home);
+    } else {
+      as.movsdLoad(reg, offset);
+    }
+  } else if (home >= 0 && home != reg) {
+    as.movRR(reg, home);
+  } else {
+    as.load(reg, offset);
+  }
+}
+
+void LoopCompiler::storeVariable(std::uint32_t slot, int reg, DataType type) {
+  int home = variableRegisters[slot];
+  std::int32_t offset = static_cast<std::int32_t>(slot * sizeof(Value));
+  if (type == DataType::Float) {
+    if (home >= 0 && home != reg) {
+      as.movsdRR(home, reg);
+    } else {
+      as.movsdStore(offset, reg);
+    }
+  } else if (home >= 0 && home != reg) {
+    as.movRR(home, reg);
+  } else {
+    as.store(offset, reg);
+  }
+}
+
+}  // namespace
+
+Jit::Jit() {}
+
+Jit::~Jit() {
+#ifdef JIT_X86_64
+  for (const Mapping& mapping : mappings) {
+    munmap(mapping.address, mapping.size);
+  }
+#endif
+}
+
+bool Jit::isAvailable() {
+#ifdef JIT_X86_64
+  return true;
+#else
+  return false;
+#endif
+}
+
+std::size_t Jit::compile(Chunk& chunk) {
+  if (!isAvailable()) {
+    return 0;
+  }
+  // Every while loop ends in a backward jump to its condition. Outer loops
+  // are tried first; when one cannot be compiled, its inner loops still can.
+  std::vector<std::pair<std::size_t, std::size_t>> loops;
+  for (std::size_t i = 0; i < chunk.code.size(); i++) {
+    const Instruction& instruction = chunk.code[i];
+    if (instruction.op == OpCode::Jump &&
+        static_cast<std::size_t>(instruction.operand) <= i) {
+      loops.push_back({static_cast<std::size_t>(instruction.operand), i});
+    }
+  }
+  std::stable_sort(loops.begin(), loops.end(),
+                   [](const auto& a, const auto& b) {
+                     return a.second - a.first > b.second - b.first;
+                   });
+
+  std::vector<bool> compiled(chunk.code.size(), false);
+  std::size_t count = 0;
+  for (const auto& [start, end] : loops) {
+    if (!compiled[start] && compileLoop(chunk, start, end)) {
+      std::fill(compiled.begin() + start, compiled.begin() + end + 1, true);
+      count++;
+    }
+  }
+  return count;
+}
+
+bool Jit::compileLoop(Chunk& chunk, std::size_t start, std::size_t end) {
+  // Code outside the loop may only enter it through its first instruction.
+  for (std::size_t i = 0; i < chunk.code.size(); i++) {
+    const Instruction& instruction = chunk.code[i];
+    if ((i < start || i > end) &&
+        (instruction.op == OpCode::Jump ||
+         instruction.op == OpCode::JumpIfFalse)) {
+      std::size_t target = static_cast<std::size_t>(instruction.operand);
+      if (target > start && target <= end) {
+        return false;
+      }
+    }
+  }
+
+  LoopCompiler compiler(chunk, start, end);
+  if (!compiler.compile()) {
+    return false;
+  }
+  NativeFunction entry = install(compiler.getCode());
+  if (entry == nullptr) {
+    return false;
+  }
+  chunk.natives.push_back({entry, static_cast<std::int32_t>(end + 1)});
+  chunk.code[start] = {OpCode::Native,
+                       static_cast<std::int32_t>(chunk.natives.size() - 1)};
+  return true;
+}
+
+// Copies the code into freshly mapped memory that is made executable once
+// it is no longer writable.
+NativeFunction Jit::install(const std::vector<std::uint8_t>& code) {
+#ifdef JIT_X86_64
+  std::size_t pageSize = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+  std::size_t size = (code.size() + pageSize - 1) / pageSize * pageSize;
+  void* address = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (address == MAP_FAILED) {
+    return nullptr;
+  }
+  std::memcpy(address, code.data(), code.size());
+  if (mprotect(address, size, PROT_READ | PROT_EXEC) != 0) {
+    munmap(address, size);
+    return nullptr;
+  }
+  mappings.push_back({address, size});
+  return reinterpret_cast<NativeFunction>(address);
+#else
+  return nullptr;
+#endif
+}
@@ -0,0 +1,549 @@
+#include "lanes.h"
+#include "arithmetic.h"
+
+#if defined(LANES_AVX2) || defined(LANES_SSE2)
+#include <immintrin.h>
+#endif
+
+// Intrinsics cannot be passed by address; this passes them as lambdas.
+#define INTRINSIC(name) \
+  [](auto left, auto right) { return name(left, right); }
+
+namespace {
+
+using IntLanes = Lanes<std::int32_t>;
+using FloatLanes = Lanes<double>;
+
+#if defined(LANES_AVX2)
+
+// One register holds all 8 int lanes, and two hold the float lanes.
+__m256i load(const IntLanes& lanes) {
+  return _mm256_load_si256(reinterpret_cast<const __m256i*>(lanes.v));
+}
+
+IntLanes store(__m256i value) {
+  IntLanes result;
+  _mm256_store_si256(reinterpret_cast<__m256i*>(result.v), value);
+  return result;
+}
+
+template <typename Operation>
+IntLanes apply(const IntLanes& left,
+               const IntLanes& right,
+               Operation operation) {
+  return store(operation(load(left), load(right)));
+}
+
+template <typename Operation>
+FloatLanes apply(const FloatLanes& left,
+                 const FloatLanes& right,
+                 Operation operation) {
+  FloatLanes result;
+  for (std::size_t lane = 0; lane < LANES; lane += 4) {
+    _mm256_store_pd(result.v + lane, operation(_mm256_load_pd(left.v + lane),
+                                               _mm256_load_pd(right.v + lane)));
+  }
+  return result;
+}
+
+// Packs the 64-bit masks of a float comparison into 32-bit lanes.
+template <int Predicate>
+Mask compare(const FloatLanes& left, const FloatLanes& right) {
+  __m256 low = _mm256_castpd_ps(_mm256_cmp_pd(
+      _mm256_load_pd(left.v), _mm256_load_pd(right.v), Predicate));
+  __m256 high = _mm256_castpd_ps(_mm256_cmp_pd(
+      _mm256_load_pd(left.v + 4), _mm256_load_pd(right.v + 4), Predicate));
+  __m256i packed = _mm256_castps_si256(
+      _mm256_shuffle_ps(low, high, _MM_SHUFFLE(2, 0, 2, 0)));
+  return store(_mm256_permute4x64_epi64(packed, _MM_SHUFFLE(3, 1, 2, 0)));
+}
+
+#elif defined(LANES_SSE2)
+
+// Two registers hold the int lanes, and four the float lanes.
+template <typename Operation>
+IntLanes apply(const IntLanes& left,
+               const IntLanes& right,
+               Operation operation) {
+  IntLanes result;
+  for (std::size_t lane = 0; lane < LANES; lane += 4) {
+    _mm_store_si128(
+        reinterpret_cast<__m128i*>(result.v + lane),
+        operation(
+            _mm_load_si128(reinterpret_cast<const __m128i*>(left.v + lane)),
+            _mm_load_si128(reinterpret_cast<const __m128i*>(right.v + lane))));
+  }
+  return result;
+}
+
+template <typename Operation>
+FloatLanes apply(const FloatLanes& left,
+                 const FloatLanes& right,
+                 Operation operation) {
+  FloatLanes result;
+  for (std::size_t lane = 0; lane < LANES; lane += 2) {
+    _mm_store_pd(result.v + lane, operation(_mm_load_pd(left.v + lane),
+                                            _mm_load_pd(right.v + lane)));
+  }
+  return result;
+}
+
+// SSE2 has no 32-bit multiply: multiply the even and the odd lanes into
+// 64-bit products and keep their low halves.
+__m128i multiplyInts(__m128i left, __m128i right) {
+  __m128i even = _mm_mul_epu32(left, right);
+  __m128i odd =
+      _mm_mul_epu32(_mm_srli_epi64(left, 32), _mm_srli_epi64(right, 32));
+  return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                            _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+// Packs the 64-bit masks of a float comparison into 32-bit lanes.
+template <typename Operation>
+Mask compare(const FloatLanes& left,
+             const FloatLanes& right,
+             Operation operation) {
+  Mask result;
+  for (std::size_t lane = 0; lane < LANES; lane += 4) {
+    __m128 low = _mm_castpd_ps(
+        operation(_mm_load_pd(left.v + lane), _mm_load_pd(right.v + lane)));
+    __m128 high = _mm_castpd_ps(operation(_mm_load_pd(left.v + lane + 2),
+                                          _mm_load_pd(right.v + lane + 2)));
+    _mm_store_si128(reinterpret_cast<__m128i*>(result.v + lane),
+                    _mm_castps_si128(
+                        _mm_shuffle_ps(low, high, _MM_SHUFFLE(2, 0, 2, 0))));
+  }
+  return result;
+}
+
+#else
+
+template <typename T, typename Operation>
+Lanes<T> apply(const Lanes<T>& left,
+               const Lanes<T>& right,
+               Operation operation) {
+  Lanes<T> result;
+  for (std::size_t lane = 0; lane < LANES; lane++) {
+    result.v[lane] = operation(left.v[lane], right.v[lane]);
+  }
+  return result;
+}
+
+template <typename T, typename Operation>
+Mask compare(const Lanes<T>& left, const Lanes<T>& right, Operation operation) {
+  Mask result;
+  for (std::size_t lane = 0; lane < LANES; lane++) {
+    result.v[lane] = operation(left.v[lane], right.v[lane]) ? -1 : 0;
+  }
+  return result;
+}
+
+#endif
+
+}  // namespace
+
+namespace lanes {
+
+const char* getInstructionSet() {
+#if defined(LANES_AVX2)
+  return "avx2";
+#elif defined(LANES_SSE2)
+  return "sse2";
+#else
+  return "scalar";
+#endif
+}
+
+#if defined(LANES_AVX2)
+
+IntLanes add(const IntLanes& left, const IntLanes& right) {
+  return apply(left, right, INTRINSIC(_mm256_add_epi32));
+}
+
+IntLanes subtract(const IntLanes& left, const IntLanes& right) {
+  return apply(left, right, INTRINSIC(_mm256_sub_epi32));
+}
+
+IntLanes multiply(const IntLanes& left, const IntLanes& right) {
+  return apply(left, right, INTRINSIC(_mm256_mullo_epi32));
+}
+
+FloatLanes add(const FloatLanes& left, const FloatLanes& right) {
+  return apply(left, right, INTRINSIC(_mm256_add_pd));
+}
+
+FloatLanes subtract(const FloatLanes& left, const FloatLanes& right) {
+  return apply(left, right, INTRINSIC(_mm256_sub_pd));
+}
+
+FloatLanes multiply(const FloatLanes& left, const FloatLanes& right) {
+  return apply(left, right, INTRINSIC(_mm256_mul_pd));
+}
+
+FloatLanes divide(const FloatLanes& left, const FloatLanes& right) {
+  return apply(left, right, INTRINSIC(_mm256_div_pd));
+}
+
+Mask less(const IntLanes& left, const IntLanes& right) {
+  return store(_mm256_cmpgt_epi32(load(right), load(left)));
+}
+
+Mask greater(const IntLanes& left, const IntLanes& right) {
+  return store(_mm256_cmpgt_epi32(load(left), load(right)));
+}
+
+Mask equal(const IntLanes& left, const IntLanes& right) {
+  return store(_mm256_cmpeq_epi32(load(left), load(right)));
+}
+
+Mask notEqual(const IntLanes& left, const IntLanes& right) {
+  return store(_mm256_xor_si256(_mm256_cmpeq_epi32(load(left), load(right)),
+                                _mm256_set1_epi32(-1)));
+}
+
+// Ordered predicates are false when either side is NaN, and != is true.
+Mask less(const FloatLanes& left, const FloatLanes& right) {
+  return compare<_CMP_LT_OQ>(left, right);
+}
+
+Mask greater(const FloatLanes& left, const FloatLanes& right) {
+  return compare<_CMP_GT_OQ>(left, right);
+}
+
+Mask equal(const FloatLanes& left, const FloatLanes& right) {
+  return compare<_CMP_EQ_OQ>(left, right);
+}
+
+Mask notEqual(const FloatLanes& left, const FloatLanes& right) {
+  return compare<_CMP_NEQ_UQ>(left, right);
+}
+
+FloatLanes toFloat(const IntLanes& value) {
+  __m256i all = load(value);
+  FloatLanes result;
+  _mm256_store_pd(result.v, _mm256_cvtepi32_pd(_mm256_castsi256_si128(all)));
+  _mm256_store_pd(result.v + 4,
+                  _mm256_cvtepi32_pd(_mm256_extracti128_si256(all, 1)));
+  return result;
+}
+
+IntLanes select(const Mask& mask,
+                const IntLanes& whenTrue,
+                const IntLanes& whenFalse) {
+  return store(
+      _mm256_blendv_epi8(load(whenFalse), load(whenTrue), load(mask)));
+}
+
+// Widens each 32-bit mask lane to the 64 bits of a double.
+FloatLanes select(const Mask& mask,
+                  const FloatLanes& whenTrue,
+                  const FloatLanes& whenFalse) {
+  __m256i all = load(mask);
+  __m256d low = _mm256_castsi256_pd(
+      _mm256_cvtepi32_epi64(_mm256_castsi256_si128(all)));
+  __m256d high = _mm256_castsi256_pd(
+      _mm256_cvtepi32_epi64(_mm256_extracti128_si256(all, 1)));
+  FloatLanes result;
+  _mm256_store_pd(result.v, _mm256_blendv_pd(_mm256_load_pd(whenFalse.v),
+                                             _mm256_load_pd(whenTrue.v), low));
+  _mm256_store_pd(result.v + 4,
+                  _mm256_blendv_pd(_mm256_load_pd(whenFalse.v + 4),
+                                   _mm256_load_pd(whenTrue.v + 4), high));
+  return result;
+}
+
+Mask both(const Mask& left, const Mask& right) {
+  return apply(left, right, INTRINSIC(_mm256_and_si256));
+}
+
+Mask without(const Mask& left, const Mask& right) {
+  return store(_mm256_andnot_si256(load(right), load(left)));
+}
+
+bool any(const Mask& mask) {
+  return _mm256_movemask_epi8(load(mask)) != 0;
+}
+
+#elif defined(LANES_SSE2)
+
+IntLanes add(const IntLanes& left, const IntLanes& right) {
+  return apply(left, right, INTRINSIC(_mm_add_epi32));
+}
+
+IntLanes subtract(const IntLanes& left, const IntLanes& right) {
+  return apply(left, right, INTRINSIC(_mm_sub_epi32));
+}
+
+IntLanes multiply(const IntLanes& left, const IntLanes& right) {
+  return apply(left, right, multiplyInts);
+}
+
+FloatLanes add(const FloatLanes& left, const FloatLanes& right) {
+  return apply(left, right, INTRINSIC(_mm_add_pd));
+}
+
+FloatLanes subtract(const FloatLanes& left, const FloatLanes& right) {
+  return apply(left, right, INTRINSIC(_mm_sub_pd));
+}
+
+FloatLanes multiply(const FloatLanes& left, const FloatLanes& right) {
+  return apply(left, right, INTRINSIC(_mm_mul_pd));
+}
+
+FloatLanes divide(const FloatLanes& left, const FloatLanes& right) {
+  return apply(left, right, INTRINSIC(_mm_div_pd));
+}
+
+Mask less(const IntLanes& left, const IntLanes& right) {
+  return apply(left, right, INTRINSIC(_mm_cmplt_epi32));
+}
+
+Mask greater(const IntLanes& left, const IntLanes& right) {
+  return apply(left, right, INTRINSIC(_mm_cmpgt_epi32));
+}
+
+Mask equal(const IntLanes& left, const IntLanes& right) {
+  return apply(left, right, INTRINSIC(_mm_cmpeq_epi32));
+}
+
+Mask notEqual(const IntLanes& left, const IntLanes& right) {
+  return apply(left, right, [](__m128i left, __m128i right) {
+    return _mm_xor_si128(_mm_cmpeq_epi32(left, right), _mm_set1_epi32(-1));
+  });
+}
+
+// cmpneq is true when either side is NaN, and the others are false.
+Mask less(const FloatLanes& left, const FloatLanes& right) {
+  return compare(left, right, INTRINSIC(_mm_cmplt_pd));
+}
+
+Mask greater(const FloatLanes& left, const FloatLanes& right) {
+  return compare(left, right, INTRINSIC(_mm_cmpgt_pd));
+}
+
+Mask equal(const FloatLanes& left, const FloatLanes& right) {
+  return compare(left, right, INTRINSIC(_mm_cmpeq_pd));
+}
+
+Mask notEqual(const FloatLanes& left, const FloatLanes& right) {
+  return compare(left, right, INTRINSIC(_mm_cmpneq_pd));
+}
+
+FloatLanes toFloat(const IntLanes& value) {
+  FloatLanes result;
+  for (std::size_t lane = 0; lane < LANES; lane += 4) {
+    __m128i ints =
+        _mm_load_si128(reinterpret_cast<const __m128i*>(value.v + lane));
+    _mm_store_pd(result.v + lane, _mm_cvtepi32_pd(ints));
+    _mm_store_pd(result.v + lane + 2,
+                 _mm_cvtepi32_pd(_mm_unpackhi_epi64(ints, ints)));
+  }
+  return result;
+}
+
+IntLanes select(const Mask& mask,
+                const IntLanes& whenTrue,
+                const IntLanes& whenFalse) {
+  IntLanes result;
+  for (std::size_t lane = 0; lane < LANES; lane += 4) {
+    __m128i bits =
+        _mm_load_si128(reinterpret_cast<const __m128i*>(mask.v + lane));
+    _mm_store_si128(
+        reinterpret_cast<__m128i*>(result.v + lane),
+        _mm_or_si128(
+            _mm_and_si128(bits, _mm_load_si128(reinterpret_cast<const __m128i*>(
+                                    whenTrue.v + lane))),
+            _mm_andnot_si128(bits,
+                             _mm_load_si128(reinterpret_cast<const __m128i*>(
+                                 whenFalse.v + lane)))));
+  }
+  return result;
+}
+
+// Widens each 32-bit mask lane to the 64 bits of a double.
+FloatLanes select(const Mask& mask,
+                  const FloatLanes& whenTrue,
+                  const FloatLanes& whenFalse) {
+  FloatLanes result;
+  for (std::size_t lane = 0; lane < LANES; lane += 4) {
+    __m128i bits =
+        _mm_load_si128(reinterpret_cast<const __m128i*>(mask.v + lane));
+    __m128d halves[] = {_mm_castsi128_pd(_mm_unpacklo_epi32(bits, bits)),
+                        _mm_castsi128_pd(_mm_unpackhi_epi32(bits, bits))};
+    for (std::size_t half = 0; half < 2; half++) {
+      std::size_t at = lane + half * 2;
+      __m128d whenTrueHalf = _mm_load_pd(whenTrue.v + at);
+      __m128d whenFalseHalf = _mm_load_pd(whenFalse.v + at);
+      _mm_store_pd(result.v + at,
+                   _mm_or_pd(_mm_and_pd(halves[half], whenTrueHalf),
+                             _mm_andnot_pd(halves[half], whenFalseHalf)));
+    }
+  }
+  return result;
+}
+
+Mask both(const Mask& left, const Mask& right) {
+  return apply(left, right, INTRINSIC(_mm_and_si128));
+}
+
+Mask without(const Mask& left, const Mask& right) {
+  return apply(left, right,
+               [](__m128i left, __m128i right) {
+                 return _mm_andnot_si128(right, left);
+               });
+}
+
+bool any(const Mask& mask) {
+  __m128i low = _mm_load_si128(reinterpret_cast<const __m128i*>(mask.v));
+  __m128i high = _mm_load_si128(reinterpret_cast<const __m128i*>(mask.v + 4));
+  return _mm_movemask_epi8(_mm_or_si128(low, high)) != 0;
+}
+
+#else
+
+IntLanes add(const IntLanes& left, const IntLanes& right) {
+  return apply(left, right, [](int left, int right) {
+    return arithmetic::add(left, right);
+  });
+}
+
+IntLanes subtract(const IntLanes& left, const IntLanes& right) {
+  return apply(left, right, [](int left, int right) {
+    return arithmetic::subtract(left, right);
+  });
+}
+
+IntLanes multiply(const IntLanes& left, const IntLanes& right) {
+  return apply(left, right, [](int left, int right) {
+    return arithmetic::multiply(left, right);
+  });
+}
+
+FloatLanes add(const FloatLanes& left, const FloatLanes& right) {
+  return apply(left, right,
+               [](double left, double right) { return left + right; });
+}
+
+FloatLanes subtract(const FloatLanes& left, const FloatLanes& right) {
+  return apply(left, right,
+               [](double left, double right) { return left - right; });
+}
+
+FloatLanes multiply(const FloatLanes& left, const FloatLanes& right) {
+  return apply(left, right,
+               [](double left, double right) { return left * right; });
+}
+
+FloatLanes divide(const FloatLanes& left, const FloatLanes& right) {
+  return apply(left, right,
+               [](double left, double right) { return left / right; });
+}
+
+Mask less(const IntLanes& left, const IntLanes& right) {
+  return compare(left, right, [](int left, int right) { return left < right; });
+}
+
+Mask greater(const IntLanes& left, const IntLanes& right) {
+  return compare(left, right, [](int left, int right) { return left > right; });
+}
+
+Mask equal(const IntLanes& left, const IntLanes& right) {
+  return compare(left, right,
+                 [](int left, int right) { return left == right; });
+}
+
+Mask notEqual(const IntLanes& left, const IntLanes& right) {
+  return compare(left, right,
+                 [](int left, int right) { return left != right; });
+}
+
+Mask less(const FloatLanes& left, const FloatLanes& right) {
+  return compare(left, right,
+                 [](double left, double right) { return left < right; });
+}
+
+Mask greater(const FloatLanes& left, const FloatLanes& right) {
+  return compare(left, right,
+                 [](double left, double right) { return left > right; });
+}
+
+Mask equal(const FloatLanes& left, const FloatLanes& right) {
+  return compare(left, right,
+                 [](double left, double right) { return left == right; });
+}
+
+Mask notEqual(const FloatLanes& left, const FloatLanes& right) {
+  return compare(left, right,
+                 [](double left, double right) { return left != right; });
+}
+
+FloatLanes toFloat(const IntLanes& value) {
+  FloatLanes result;
+  for (std::size_t lane = 0; lane < LANES; lane++) {
+    result.v[lane] = arithmetic::toFloat(value.v[lane]);
+  }
+  return result;
+}
+
+IntLanes select(const Mask& mask,
+                const IntLanes& whenTrue,
+                const IntLanes& whenFalse) {
+  IntLanes result;
+  for (std::size_t lane = 0; lane < LANES; lane++) {
+    result.v[lane] = mask.v[lane] ? whenTrue.v[lane] : whenFalse.v[lane];
+  }
+  return result;
+}
+
+FloatLanes select(const Mask& mask,
+                  const FloatLanes& whenTrue,
+                  const FloatLanes& whenFalse) {
+  FloatLanes result;
+  for (std::size_t lane = 0; lane < LANES; lane++) {
+    result.v[lane] = mask.v[lane] ? whenTrue.v[lane] : whenFalse.v[lane];
+  }
+  return result;
+}
+
+Mask both(const Mask& left, const Mask& right) {
+  return apply(left, right, [](int left, int right) { return left & right; });
+}
+
+Mask without(const Mask& left, const Mask& right) {
+  return apply(left, right, [](int left, int right) { return left & ~right; });
+}
+
+bool any(const Mask& mask) {
+  for (std::size_t lane = 0; lane < LANES; lane++) {
+    if (mask.v[lane] != 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+#endif
+
+IntLanes negate(const IntLanes& value) {
+  return subtract(broadcast<std::int32_t>(0), value);
+}
+
+// Flips the sign bit, of NaN too, which a subtraction would not.
+FloatLanes negate(const FloatLanes& value) {
+  FloatLanes result;
+  for (std::size_t lane = 0; lane < LANES; lane++) {
+    result.v[lane] = -value.v[lane];
+  }
+  return result;
+}
+
+// Saturates and maps NaN to 0, which no instruction set here does.
+IntLanes toInt(const FloatLanes& value) {
+  IntLanes result;
+  for (std::size_t lane = 0; lane < LANES; lane++) {
+    result.v[lane] = arithmetic::toInt(value.v[lane]);
+  }
+  return result;
+}
+
+}  // namespace lanes
@@ -1,14 +1,14 @@
 #include "lexer.h"
 #include <iostream>
 
-Lexer::Lexer(std::string& inputText)
-    : inputText(inputText),
-      position(Position(-1, 0, -1, inputText)),
-      currentChar(),
-      currentTokenIndex(0),
-      nextTokenIndex(0) {
-  advance();
-}
+Lexer::Lexer(std::shared_ptr<const Source> source)
+    : source(std::move(source)),
+      position(Position(0, this->source.get())),
+      currentChar(this->source->at(0)),
+      nextChar(this->source->at(1)),
+      atLineStart(true),
+      lastTokenWasNewline(true),
+      tokens(this->source.get()) {}
 
 const std::unordered_map<char, TokenType> operators = {
     {'+', TOKEN_OPERATOR},   {'-', TOKEN_OPERATOR},    {'*', TOKEN_OPERATOR},
@@ -16,97 +16,127 @@ const std::unordered_map<char, TokenType> operators = {
     {'=', TOKEN_OPERATOR},   {'<', TOKEN_COMPARATOR},  {'>', TOKEN_COMPARATOR},
     {'?', TOKEN_COMPARATOR}, {'!', TOKEN_COMPARATOR},  {':', TOKEN_COLON}};
 
-const std::unordered_map<std::string, TokenType> keywords = {
-    {"if", TOKEN_KEYWORD},    {"elif", TOKEN_KEYWORD},  {"else", TOKEN_KEYWORD},
-    {"while", TOKEN_KEYWORD}, {"var", TOKEN_KEYWORD},   {"int", TOKEN_KEYWORD},
-    {"float", TOKEN_KEYWORD}, {"print", TOKEN_KEYWORD}, {"run", TOKEN_KEYWORD}};
-
 void Lexer::advance() {
-  position.advance(currentChar);
-  currentChar = (position.getIndex() < static_cast<int>(inputText.size()))
-                    ? inputText[position.getIndex()]
-                    : '\0';
-  nextChar = (position.getIndex() + 1 < static_cast<int>(inputText.size()))
-                 ? inputText[position.getIndex() + 1]
-                 : '\0';
+  position.advance();
+  currentChar = nextChar;
+  nextChar = source->at(position.getIndex() + 1);
 }
 
-void Lexer::skipWhitespace() {
-  while (std::isspace(currentChar)) {
-    advance();
+void Lexer::reset() {
+  position = Position(0, source.get());
+  currentChar = source->at(0);
+  nextChar = source->at(1);
+  atLineStart = true;
+  lastTokenWasNewline = true;
+}
+
+Token Lexer::makeToken(TokenType type,
+                       const Position& posStart,
+                       std::uint32_t id) {
+  lastTokenWasNewline = (type == TOKEN_NEWLINE);
+  return {type, posStart, position, id};
+}
+
+Token Lexer::scanIndent() {
+  // Leading spaces become a single INDENT token whose id is the indentation
+  // width. Lines holding nothing but whitespace are skipped entirely.
+  while (true) {
+    Position posStart = position;
+    std::uint32_t width = 0;
+    while (currentChar == ' ' || currentChar == '\t' || currentChar == '\r') {
+      if (currentChar == ' ') {
+        width++;
+      }
+      advance();
+    }
+    if (currentChar == '\n') {
+      advance();
+      continue;
+    }
+    atLineStart = false;
+    if (width > 0 && currentChar != '\0') {
+      return makeToken(TOKEN_INDENT, posStart, width);
+    }
+    return {TOKEN_INVALID, posStart, position};
   }
 }
 
-void Lexer::tokenize() {
-  tokens.clear();
-  Position posStart = position;
-  bool lastTokenWasNewline = false;
+Token Lexer::getNextToken() {
+  if (atLineStart) {
+    Token indent = scanIndent();
+    if (indent.getType() == TOKEN_INDENT) {
+      return indent;
+    }
+  }
 
   while (currentChar != '\0') {
-    if (std::isspace(currentChar)) {
-      if (currentChar == ' ' && nextChar == ' ') {
-        tokens.push_back({TOKEN_INDENT, "  ", posStart, position});
-        advance();
-      } else if (currentChar == '\n' && !lastTokenWasNewline) {
-        tokens.push_back({TOKEN_NEWLINE, "\\n", posStart, position});
-        lastTokenWasNewline = true;
-      } else if (currentChar != '\n') {
-        lastTokenWasNewline = false;
+    Position posStart = position;
+    if (currentChar == '\n') {
+      advance();
+      atLineStart = true;
+      if (!lastTokenWasNewline) {
+        return makeToken(TOKEN_NEWLINE, posStart);
       }
+      return getNextToken();
+    } else if (std::isspace(currentChar)) {
       advance();
     } else if (currentChar == '\"') {
-      tokens.push_back(scanString(posStart));
-      lastTokenWasNewline = false;
+      return scanString(posStart);
     } else if (std::isdigit(currentChar)) {
-      tokens.push_back(scanNumber(posStart));
-      lastTokenWasNewline = false;
+      return scanNumber(posStart);
     } else if (std::isalpha(currentChar) || currentChar == '_') {
-      tokens.push_back(scanIdentifier(posStart));
-      lastTokenWasNewline = false;
+      return scanIdentifier(posStart);
     } else if (operators.find(currentChar) != operators.end()) {
-      tokens.push_back(scanOperator(posStart));
-      lastTokenWasNewline = false;
+      return scanOperator(posStart);
     } else {
-      throw IllegalCharError(posStart, position, std::string(1, currentChar));
+      Position posEnd = position;
+      posEnd.advance();
+      throw IllegalCharError(posStart, posEnd, std::string(1, currentChar));
     }
-    posStart = position;
   }
-}
 
-Token Lexer::getNextToken() {
-  if (currentTokenIndex < tokens.size()) {
-    return tokens[currentTokenIndex++];
+  // The last line may lack its '\n'; end it anyway so the parser always sees
+  // a NEWLINE before EOF.
+  if (!lastTokenWasNewline) {
+    return makeToken(TOKEN_NEWLINE, position);
   }
-  return {TOKEN_EOF, "", position, position};
+  return {TOKEN_EOF, position, position};
 }
 
-Token Lexer::peekNextToken(size_t offset) {
-  if (nextTokenIndex + offset < tokens.size()) {
-    return tokens[nextTokenIndex++ + offset];
+void Lexer::tokenize() {
+  reset();
+  tokens.clear();
+  // Roughly one token per four bytes of typical input.
+  tokens.reserve(source->size() / 4 + 1);
+
+  for (Token token = getNextToken(); token.getType() != TOKEN_EOF;
+       token = getNextToken()) {
+    tokens.push(token.getType(),
+                static_cast<std::uint32_t>(token.getPosStart().getIndex()),
+                static_cast<std::uint32_t>(token.getPosEnd().getIndex() -
+                                           token.getPosStart().getIndex()),
+                token.getId());
   }
-  return {TOKEN_EOF, "", position, position};
+  reset();
 }
 
-std::vector<Token> Lexer::getAllTokens() const {
+const TokenBuffer& Lexer::getAllTokens() const {
   return tokens;
 }
 
 Token Lexer::scanString(Position posStart) {
   advance();  // Skip the opening quote
-  std::string value;
   while (currentChar != '\"' && currentChar != '\0') {
-    value += currentChar;
     advance();
   }
   if (currentChar != '\"') {
     throw IllegalCharError(posStart, position, "Unterminated string literal.");
   }
   advance();  // Skip the closing quote
-  return {TOKEN_STRING, value, posStart, position};
+  return makeToken(TOKEN_STRING, posStart);
 }
 
 Token Lexer::scanNumber(Position posStart) {
-  std::string number;
   bool dotFound = false;
   while (std::isdigit(currentChar) || currentChar == '.' ||
          std::isalpha(currentChar)) {
@@ -121,33 +151,26 @@ Token Lexer::scanNumber(Position posStart) {
                                "Invalid number with multiple dots.");
       }
       dotFound = true;
-      number += currentChar;
       advance();
       if (!std::isdigit(currentChar)) {
         throw IllegalCharError(posStart, position,
                                "Invalid number, a digit must follow a dot.");
       }
     }
-    number += currentChar;
     advance();
   }
 
-  return {(number.find('.') != std::string::npos) ? TOKEN_FLOAT : TOKEN_INTEGER,
-          number, posStart, position};
+  return makeToken(dotFound ? TOKEN_FLOAT : TOKEN_INTEGER, posStart);
 }
 
 Token Lexer::scanIdentifier(Position posStart) {
-  std::string identifier;
   while (std::isalnum(currentChar) || currentChar == '_') {
-    identifier += currentChar;
     advance();
   }
-  auto keyword_it = keywords.find(identifier);
-  if (keyword_it != keywords.end()) {
-    return {keyword_it->second, identifier, posStart, position};
-  } else {
-    return {TOKEN_IDENTIFIER, identifier, posStart, position};
-  }
+  std::uint32_t id = interner.intern(
+      source->getText(posStart.getIndex(), position.getIndex()));
+  return makeToken((id < KEYWORD_COUNT) ? TOKEN_KEYWORD : TOKEN_IDENTIFIER,
+                   posStart, id);
 }
 
 Token Lexer::scanOperator(Position posStart) {
@@ -155,13 +178,18 @@ Token Lexer::scanOperator(Position posStart) {
   if (operator_it != operators.end()) {
     char foundChar = currentChar;
     advance();
-    return {operator_it->second, std::string(1, foundChar), posStart, position};
+    return makeToken(operator_it->second, posStart,
+                     static_cast<unsigned char>(foundChar));
   }
-  return {TOKEN_INVALID, "", posStart, position};
+  return makeToken(TOKEN_INVALID, posStart);
 }
 
-const std::string& Lexer::getInputText() const {
-  return inputText;
+const Source& Lexer::getSource() const {
+  return *source;
+}
+
+const Interner& Lexer::getInterner() const {
+  return interner;
 }
 
 const Position& Lexer::getPosition() const {
@@ -170,4 +198,4 @@ const Position& Lexer::getPosition() const {
 
 char Lexer::getCurrentChar() const {
   return currentChar;
-}
\ No newline at end of file
+}
@@ -1,77 +1,553 @@
+#include <unistd.h>
+#include <charconv>
+#include <cstring>
 #include <fstream>
 #include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "batch.h"
+#include "cache.h"
+#include "cgen.h"
+#include "compiler.h"
+#include "folder.h"
+#include "ir.h"
 #include "interpreter.h"
+#include "jit.h"
+#include "output.h"
 #include "lexer.h"
+#include "optimizer.h"
 #include "parser.h"
+#include "peephole.h"
+#include "profile.h"
+#include "repl.h"
+#include "resolver.h"
+#include "ssa.h"
+#include "sweep.h"
+#include "typechecker.h"
+#include "vm.h"
 
-void printDebugInfo(Lexer& lexer, Parser& parser);
+void printDebugInfo(Lexer& lexer, const AST& ast);
+void printIR(const AST& ast, const IRProgram& ir);
 bool DEBUG_MODE = false;
 
-int main(int argc, char* argv[]) {
-  while (true) {
-    // not working on windows
-    system("clear");
-    std::string input;
-    bool isFromFile = false;
-
-    if (argc > 1) {
-      std::ifstream file(argv[1]);
-      if (file) {
-        std::string line;
-        while (std::getline(file, line)) {
-          input += line + "\n";
-        }
-        isFromFile = true;
-        // not working on windows
-        system("clear");
-        std::cout << input << std::endl << std::endl;
-      } else {
-        std::cerr << "Failed to open file: " << argv[1] << std::endl;
-        return 1;
+void echoSource(const Source& source) {
+  std::cout << source.getText();
+  if (!source.getText().empty() && source.getText().back() != '\n') {
+    std::cout << '\n';
+  }
+  std::cout << std::endl << std::endl;
+}
+
+enum class Engine { Tiered, Tree, VM, Jit };
+
+struct Options {
+  Engine engine = Engine::Tiered;
+  TieringOptions tiering;
+  bool optimizeLoops = true;
+  bool optimizeSSA = true;
+  bool dumpIR = false;
+  bool superinstructions = true;
+  // By default, line by line on a terminal and in blocks otherwise.
+  FlushPolicy flush = FlushPolicy::Size;
+  bool writerThread = false;
+  // Translate the program to C instead of running it.
+  const char* emitC = nullptr;
+  const char* compileTo = nullptr;
+  // Where the compiled program is cached: the path given with --cache=, or
+  // with --cache alone the script's own path followed by a "c".
+  std::string cache;
+  bool cacheBesideScript = false;
+  // Run every script given on a thread pool, with --batch.
+  bool batch = false;
+  unsigned jobs = 0;
+  std::vector<std::string> scripts;
+  // Run the script once per row of this CSV file, with --sweep.
+  const char* sweep = nullptr;
+  // Keep variables from one input to the next, with --repl or by default
+  // when a terminal is typed into.
+  bool repl = false;
+  // Profile the run on the tree interpreter, with --profile, and write the
+  // profile as JSON to this file when one is given.
+  bool profile = false;
+  const char* profileJson = nullptr;
+  const char* file = nullptr;
+
+  bool translates() const { return emitC != nullptr || compileTo != nullptr; }
+};
+
+// Returns the value of an option of the form prefix=value, or null.
+const char* optionValue(const char* argument, const char* prefix) {
+  std::size_t length = std::strlen(prefix);
+  if (std::strncmp(argument, prefix, length) != 0 || argument[length] != '=') {
+    return nullptr;
+  }
+  return argument + length + 1;
+}
+
+// Usage: dsl.out [--engine=tiered|tree|vm|jit] [--tier-threshold=N]
+//                [--tier-engine=vm|jit] [--stats] [--no-loop-opt]
+//                [--no-ssa-opt] [--dump-ir] [--no-superinstructions]
+//                [--emit-c=out.c] [--compile=out] [--cache[=file.dslc]]
+//                [--flush=exit|size|line] [--writer-thread]
+//                [--profile[=profile.json]] [file]
+//        dsl.out --batch [--jobs=N] [options] file|directory|@list...
+//        dsl.out --sweep=inputs.csv file
+//        dsl.out --repl [--engine=vm|jit] [options]
+bool parseOptions(int argc, char* argv[], Options& options) {
+  if (isatty(STDOUT_FILENO)) {
+    options.flush = FlushPolicy::Line;
+  }
+  for (int i = 1; i < argc; i++) {
+    const char* threshold = optionValue(argv[i], "--tier-threshold");
+    const char* emitC = optionValue(argv[i], "--emit-c");
+    const char* compileTo = optionValue(argv[i], "--compile");
+    const char* cache = optionValue(argv[i], "--cache");
+    const char* jobs = optionValue(argv[i], "--jobs");
+    const char* sweep = optionValue(argv[i], "--sweep");
+    const char* profileJson = optionValue(argv[i], "--profile");
+    if (emitC != nullptr) {
+      options.emitC = emitC;
+    } else if (compileTo != nullptr) {
+      options.compileTo = compileTo;
+    } else if (cache != nullptr) {
+      options.cache = cache;
+    } else if (std::strcmp(argv[i], "--cache") == 0) {
+      options.cacheBesideScript = true;
+    } else if (sweep != nullptr) {
+      options.sweep = sweep;
+    } else if (std::strcmp(argv[i], "--flush=exit") == 0) {
+      options.flush = FlushPolicy::Exit;
+    } else if (std::strcmp(argv[i], "--flush=size") == 0) {
+      options.flush = FlushPolicy::Size;
+    } else if (std::strcmp(argv[i], "--flush=line") == 0) {
+      options.flush = FlushPolicy::Line;
+    } else if (std::strcmp(argv[i], "--writer-thread") == 0) {
+      options.writerThread = true;
+    } else if (std::strcmp(argv[i], "--repl") == 0) {
+      options.repl = true;
+    } else if (profileJson != nullptr) {
+      options.profile = true;
+      options.profileJson = profileJson;
+    } else if (std::strcmp(argv[i], "--profile") == 0) {
+      options.profile = true;
+    } else if (std::strcmp(argv[i], "--batch") == 0) {
+      options.batch = true;
+    } else if (jobs != nullptr) {
+      const char* end = jobs + std::strlen(jobs);
+      auto result = std::from_chars(jobs, end, options.jobs);
+      if (result.ec != std::errc() || result.ptr != end || jobs == end) {
+        std::cerr << "Invalid number of jobs: " << jobs << std::endl;
+        return false;
       }
-    } else {
-      std::string line;
-      while (std::getline(std::cin, line)) {
-        input += line + "\n";
-        if (line == "run") {
-          break;
-        }
+    } else if (threshold != nullptr) {
+      const char* end = threshold + std::strlen(threshold);
+      auto result =
+          std::from_chars(threshold, end, options.tiering.threshold);
+      if (result.ec != std::errc() || result.ptr != end || threshold == end) {
+        std::cerr << "Invalid tier threshold: " << threshold << std::endl;
+        return false;
       }
+    } else if (std::strcmp(argv[i], "--tier-engine=vm") == 0) {
+      options.tiering.useJit = false;
+    } else if (std::strcmp(argv[i], "--tier-engine=jit") == 0) {
+      options.tiering.useJit = true;
+    } else if (std::strcmp(argv[i], "--no-loop-opt") == 0) {
+      options.optimizeLoops = false;
+    } else if (std::strcmp(argv[i], "--no-ssa-opt") == 0) {
+      options.optimizeSSA = false;
+    } else if (std::strcmp(argv[i], "--dump-ir") == 0) {
+      options.dumpIR = true;
+    } else if (std::strcmp(argv[i], "--no-superinstructions") == 0) {
+      options.superinstructions = false;
+    } else if (std::strcmp(argv[i], "--stats") == 0) {
+      options.tiering.stats = true;
+    } else if (std::strcmp(argv[i], "--engine=tiered") == 0) {
+      options.engine = Engine::Tiered;
+    } else if (std::strcmp(argv[i], "--engine=tree") == 0) {
+      options.engine = Engine::Tree;
+    } else if (std::strcmp(argv[i], "--engine=vm") == 0) {
+      options.engine = Engine::VM;
+    } else if (std::strcmp(argv[i], "--engine=jit") == 0) {
+      options.engine = Engine::Jit;
+    } else if (argv[i][0] == '-' && argv[i][1] == '-') {
+      std::cerr << "Unknown option: " << argv[i] << std::endl;
+      return false;
+    } else {
+      options.scripts.push_back(argv[i]);
     }
+  }
 
-    try {
-      Lexer lexer(input);
-      lexer.tokenize();
+  if (options.profile &&
+      (options.batch || options.sweep != nullptr || options.repl ||
+       options.translates() || options.cacheBesideScript ||
+       !options.cache.empty())) {
+    std::cerr << "--profile cannot be combined with --batch, --sweep, "
+                 "--repl, --emit-c, --compile or --cache"
+              << std::endl;
+    return false;
+  }
+  if (options.batch) {
+    if (options.translates() || !options.cache.empty()) {
+      std::cerr << "--batch cannot be combined with --emit-c, --compile or "
+                   "--cache=FILE"
+                << std::endl;
+      return false;
+    }
+    if (options.scripts.empty()) {
+      std::cerr << "--batch needs scripts to run" << std::endl;
+      return false;
+    }
+    return true;
+  }
+  if (options.scripts.size() > 1) {
+    std::cerr << "Only one script can be run without --batch" << std::endl;
+    return false;
+  }
+  if (!options.scripts.empty()) {
+    options.file = options.scripts[0].c_str();
+  }
+  if (options.sweep != nullptr) {
+    if (options.file == nullptr || options.translates() ||
+        options.cacheBesideScript || !options.cache.empty()) {
+      std::cerr << "--sweep needs a file, and cannot be combined with "
+                   "--emit-c, --compile or --cache"
+                << std::endl;
+      return false;
+    }
+    return true;
+  }
+  if (options.repl) {
+    if (options.file != nullptr || options.translates() ||
+        options.cacheBesideScript || !options.cache.empty()) {
+      std::cerr << "--repl cannot be combined with a file, --emit-c, "
+                   "--compile or --cache"
+                << std::endl;
+      return false;
+    }
+    return true;
+  }
+  if (options.file == nullptr && !options.translates() && !options.profile) {
+    options.repl = true;
+  }
+  if (options.cacheBesideScript) {
+    if (options.file == nullptr) {
+      std::cerr << "--cache without a path needs a file" << std::endl;
+      return false;
+    }
+    options.cache = std::string(options.file) + "c";
+  }
+  return true;
+}
+
+// Programs are cached once compiled, so a cached program only depends on the
+// options of the passes before the Compiler.
+std::uint32_t cacheKey(const Options& options) {
+  return (options.optimizeSSA ? 1 : 0) | (options.optimizeLoops ? 2 : 0);
+}
+
+bool loadCache(const Source& source, const Options& options, Chunk& chunk) {
+  if (options.cache.empty() || options.translates()) {
+    return false;
+  }
+  if (!ChunkCache::load(options.cache, source.getText(), cacheKey(options),
+                        chunk)) {
+    return false;
+  }
+  chunk.source = source.shared_from_this();
+  return true;
+}
 
-      Parser parser(lexer);
-      auto ast = parser.parse();
+void runChunk(Chunk& chunk, const Options& options, Output& out) {
+  Jit jit;
+  if (options.engine == Engine::Jit) {
+    jit.compile(chunk);
+  }
+  if (options.superinstructions) {
+    Peephole(chunk).optimize();
+  }
+  if (DEBUG_MODE) {
+    std::cout << "\nBytecode (" << VM::getDispatchName() << " dispatch):\n"
+              << chunk.asString() << std::endl;
+  }
+  VM vm(out);
+  vm.interpret(chunk);
+}
 
-      if (DEBUG_MODE) {
-        printDebugInfo(lexer, parser);
+// Runs the program on the tree interpreter, which knows which statement of
+// the source it is executing, and reports the profile on stderr even when
+// the program stops on a runtime error.
+void executeProfiled(const AST& ast, const Options& options, Output& out) {
+  Profile profile(ast);
+  auto report = [&]() {
+    profile.finish();
+    out.flush();
+    profile.report(std::cerr);
+    if (options.profileJson != nullptr) {
+      std::ofstream file(options.profileJson);
+      profile.writeJson(file);
+      if (!file) {
+        std::cerr << "Failed to write file: " << options.profileJson
+                  << std::endl;
       }
+    }
+  };
+  try {
+    Interpreter(options.tiering, out, &profile).interpret(ast);
+  } catch (const Error&) {
+    report();
+    throw;
+  }
+  report();
+}
 
-      Interpreter interpreter;
-      interpreter.interpret(ast);
+// A cached program runs on the VM, or with --engine=jit on the JIT.
+void execute(const AST& ast,
+             const Source& source,
+             const Options& options,
+             Output& out) {
+  if (options.profile) {
+    executeProfiled(ast, options, out);
+  } else if (!options.cache.empty()) {
+    Chunk chunk = Compiler(ast).compile();
+    if (!ChunkCache::save(options.cache, source.getText(), cacheKey(options),
+                          chunk)) {
+      std::cerr << "Failed to write cache: " << options.cache << std::endl;
+    }
+    runChunk(chunk, options, out);
+  } else if (options.engine == Engine::VM || options.engine == Engine::Jit) {
+    Chunk chunk = Compiler(ast).compile();
+    runChunk(chunk, options, out);
+  } else {
+    TieringOptions tiering = options.tiering;
+    tiering.enabled = options.engine == Engine::Tiered;
+    tiering.superinstructions = options.superinstructions;
+    Interpreter interpreter(tiering, out);
+    interpreter.interpret(ast);
+  }
+}
 
-    } catch (const IllegalCharError& e) {
-      std::cerr << e.asString() << std::endl;
-    } /*  catch (...) {
-       std::cerr << "Caught an unexpected exception!" << std::endl;
-     } */
-    if (isFromFile) {
-      break;  // If the input was from a file, break the loop
-    } else {
-      std::cout << "\n> Press 'Enter' to clear your code.\n";
-      char c;
-      std::cin.get(c);
-      if (c == '\n') {
-        continue;
-      } else {
-        std::cin.ignore(std::numeric_limits<std::streamsize>::max(),
-                        '\n');  // Ignore the rest of the line
+bool translate(const AST& ast, const Options& options) {
+  std::string program = CGenerator(ast).generate();
+  if (options.emitC != nullptr) {
+    std::ofstream file(options.emitC);
+    file << program;
+    if (!file) {
+      std::cerr << "Failed to write file: " << options.emitC << std::endl;
+      return false;
+    }
+  }
+  if (options.compileTo != nullptr &&
+      !CGenerator::buildExecutable(program, options.compileTo)) {
+    std::cerr << "Failed to compile: " << options.compileTo << std::endl;
+    return false;
+  }
+  return true;
+}
+
+// Compiles and runs one script, echoing it first when echo is set, and
+// clears echo once the script has been echoed. Errors in the script are
+// thrown; returns false when translating it fails.
+bool runScript(const std::shared_ptr<const Source>& source,
+               const Options& options,
+               bool& echo,
+               Output& out) {
+  Chunk chunk;
+  if (loadCache(*source, options, chunk)) {
+    if (echo) {
+      echoSource(*source);
+      echo = false;
+    }
+    runChunk(chunk, options, out);
+    return true;
+  }
+
+  Lexer lexer(source);
+
+  Parser parser(lexer);
+  auto ast = parser.parse();
+  if (echo && !options.translates()) {
+    echoSource(*source);
+    echo = false;
+  }
+  Resolver(*ast).resolve();
+  TypeChecker(*ast).check();
+  // A profile reports on the program as written, so nothing may prune or
+  // rewrite its statements first.
+  if (!options.profile) {
+    ConstantFolder(*ast).fold();
+  }
+  SSAOptimizer ssa(*ast);
+  const IRProgram* ir = nullptr;
+  if (options.optimizeSSA && !options.profile) {
+    ir = &ssa.optimize();
+  } else if (options.dumpIR || DEBUG_MODE) {
+    ir = &ssa.build();
+  }
+  // The C compiler does its own loop optimizations.
+  if (options.optimizeLoops && !options.translates() && !options.profile) {
+    LoopOptimizer(*ast).optimize();
+  }
+
+  if (DEBUG_MODE) {
+    lexer.tokenize();
+    printDebugInfo(lexer, *ast);
+  }
+  if (options.dumpIR || DEBUG_MODE) {
+    printIR(*ast, *ir);
+  }
+
+  if (options.translates()) {
+    return translate(*ast, options);
+  }
+  execute(*ast, *source, options, out);
+  return true;
+}
+
+int runBatch(const Options& options) {
+  std::vector<std::string> paths;
+  if (!BatchRunner::expand(options.scripts, paths)) {
+    return 1;
+  }
+  BatchRunner runner(std::move(paths), options.jobs);
+  std::size_t failures = runner.run(
+      [&options](const std::string& path, std::string& output,
+                 std::string& error) {
+        std::shared_ptr<const Source> source = Source::fromFile(path);
+        if (!source) {
+          error = "Failed to open file: " + path;
+          return false;
+        }
+        Options scriptOptions = options;
+        if (options.cacheBesideScript) {
+          scriptOptions.cache = path + "c";
+        }
+        try {
+          Output out(output);
+          bool echo = false;
+          return runScript(source, scriptOptions, echo, out);
+        } catch (const Error& e) {
+          error = e.asString();
+        } catch (const std::exception& e) {
+          error = e.what();
+        }
+        return false;
+      });
+  return failures == 0 ? 0 : 1;
+}
+
+// Runs the script once for every row of the inputs, LANES rows at a time,
+// and prints what each run printed like --batch does. The SSA and loop
+// optimizers would fold the initializers the inputs replace, so they are
+// not run.
+int runSweep(const Options& options) {
+  std::shared_ptr<const Source> source = Source::fromFile(options.file);
+  if (!source) {
+    std::cerr << "Failed to open file: " << options.file << std::endl;
+    return 1;
+  }
+  std::ifstream csv(options.sweep);
+  if (!csv) {
+    std::cerr << "Failed to open file: " << options.sweep << std::endl;
+    return 1;
+  }
+
+  int status = 0;
+  try {
+    Lexer lexer(source);
+    Parser parser(lexer);
+    auto ast = parser.parse();
+    Resolver(*ast).resolve();
+    TypeChecker(*ast).check();
+    ConstantFolder(*ast).fold();
+
+    SweepInputs inputs;
+    std::string error;
+    if (!SweepInputs::read(csv, *ast, inputs, error)) {
+      std::cerr << options.sweep << ": " << error << std::endl;
+      return 1;
+    }
+    LaneInterpreter interpreter(*ast, inputs);
+    for (std::size_t first = 0; first < inputs.rows.size(); first += LANES) {
+      interpreter.run(first);
+      for (std::size_t lane = 0;
+           lane < LANES && first + lane < inputs.rows.size(); lane++) {
+        std::cout << "==> row " << first + lane + 1 << " <==\n"
+                  << interpreter.getOutput(lane);
+        std::cout.flush();
+        if (!interpreter.getError(lane).empty()) {
+          std::cerr << interpreter.getError(lane) << std::endl;
+          status = 1;
+        }
       }
     }
+  } catch (const Error& e) {
+    std::cerr << e.asString() << std::endl;
+    return 1;
+  }
+  return status;
+}
+
+// Inputs run on the VM, or with --engine=jit on the JIT. Errors only set the
+// exit status when the inputs are piped in.
+int runRepl(const Options& options) {
+  ReplOptions replOptions;
+  replOptions.optimizeLoops = options.optimizeLoops;
+  replOptions.superinstructions = options.superinstructions;
+  replOptions.jit = options.engine == Engine::Jit;
+  Output out(STDOUT_FILENO, options.flush, options.writerThread);
+  bool interactive = isatty(STDIN_FILENO);
+  bool succeeded = Repl(replOptions, out).run(std::cin, interactive);
+  return succeeded || interactive ? 0 : 1;
+}
+
+int main(int argc, char* argv[]) {
+  Options options;
+  if (!parseOptions(argc, argv, options)) {
+    return 1;
+  }
+  if (options.batch) {
+    return runBatch(options);
+  }
+  if (options.sweep != nullptr) {
+    return runSweep(options);
+  }
+  if (options.repl) {
+    return runRepl(options);
+  }
+
+  std::shared_ptr<const Source> source;
+  bool isFromFile = options.file != nullptr;
+  if (isFromFile) {
+    source = Source::fromFile(options.file);
+    if (!source) {
+      std::cerr << "Failed to open file: " << options.file << std::endl;
+      return 1;
+    }
+  } else {
+    source = Source::fromStream(std::cin, "<stdin>");
   }
 
-  return 0;
+  // A script that fails before it is echoed is echoed above its error.
+  int status = 0;
+  bool echo = isFromFile;
+  try {
+    Output out(STDOUT_FILENO, options.flush, options.writerThread);
+    if (!runScript(source, options, echo, out)) {
+      status = 1;
+    }
+  } catch (const Error& e) {
+    if (echo) {
+      echoSource(*source);
+    }
+    std::cerr << e.asString() << std::endl;
+    status = 1;
+  } catch (const std::runtime_error& e) {
+    if (echo) {
+      echoSource(*source);
+    }
+    std::cerr << e.what() << std::endl;
+    status = 1;
+  }
+  return status;
 }
\ No newline at end of file
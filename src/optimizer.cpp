@@ -0,0 +1,522 @@
+#include "optimizer.h"
+#include <stdexcept>
+#include <string>
+#include "arithmetic.h"
+
+LoopOptimizer::LoopOptimizer(AST& ast) : ast(ast) {}
+
+void LoopOptimizer::optimize() {
+  if (!ast.isResolved()) {
+    throw std::runtime_error("AST has not been resolved");
+  }
+  optimizeStatementList(ast.getRoot());
+}
+
+void LoopOptimizer::optimizeStatement(NodeId node) {
+  switch (ast[node].type) {
+    case NodeType::IfStatement:
+      optimizeStatementList(ast.getChild(node, 1));
+      for (std::uint32_t i = 2; i < ast[node].childCount; i++) {
+        NodeId child = ast.getChild(node, i);
+        optimizeStatementList(ast.getChild(
+            child, ast[child].type == NodeType::ElifStatement ? 1 : 0));
+      }
+      break;
+    case NodeType::WhileStatement:
+      optimizeLoop(node);
+      break;
+    case NodeType::StatementList:
+      optimizeStatementList(node);
+      break;
+    default:
+      break;
+  }
+}
+
+void LoopOptimizer::optimizeStatementList(NodeId node) {
+  // Rewriting appends to the AST's arrays, so children are visited by index.
+  for (std::uint32_t i = 0; i < ast[node].childCount; i++) {
+    optimizeStatement(ast.getChild(node, i));
+  }
+}
+
+void LoopOptimizer::optimizeLoop(NodeId node) {
+  NodeId condition = ast.getChild(node, 0);
+  NodeId body = ast.getChild(node, 1);
+  optimizeStatementList(body);
+
+  assignments.assign(ast.getSlotCount(), 0);
+  countAssignments(body);
+  findInductions(body);
+  products.clear();
+  preheader.clear();
+  productUpdates.clear();
+
+  rewriteCondition(condition);
+  rewriteStatementList(body);
+
+  if (!productUpdates.empty()) {
+    std::vector<NodeId> statements;
+    for (const NodeId* child = ast.beginChildren(body);
+         child != ast.endChildren(body); child++) {
+      statements.push_back(*child);
+      for (const auto& update : productUpdates) {
+        if (update.first == *child) {
+          statements.push_back(update.second);
+        }
+      }
+    }
+    ast.setChildren(body, statements.data(),
+                    static_cast<std::uint32_t>(statements.size()));
+  }
+  NodeId loop = node;
+  if (!preheader.empty()) {
+    loop = ast.copyNode(node);
+    preheader.push_back(loop);
+    ast[node].type = NodeType::StatementList;
+    ast.setChildren(node, preheader.data(),
+                    static_cast<std::uint32_t>(preheader.size()));
+  }
+  solveLoop(loop);
+}
+
+void LoopOptimizer::solveLoop(NodeId node) {
+  NodeId condition = ast.getChild(node, 0);
+  NodeId body = ast.getChild(node, 1);
+  if (ast[condition].dataType != DataType::Int) {
+    return;
+  }
+  for (const NodeId* child = ast.beginChildren(body);
+       child != ast.endChildren(body); child++) {
+    if (ast[*child].type != NodeType::Assignment) {
+      return;
+    }
+    std::uint32_t slot = ast[ast.getChild(*child, 0)].value;
+    NodeId value = ast.getChild(*child, 1);
+    if (ast.getSlotType(slot) != DataType::Int || assignments[slot] != 1 ||
+        ast[value].type != NodeType::Expression ||
+        ast[value].childCount != 3) {
+      return;
+    }
+    NodeId variable = ast.getChild(value, 0);
+    if (ast[variable].type != NodeType::Identifier ||
+        ast[variable].value != slot ||
+        !isInvariant(ast.getChild(value, 2), true)) {
+      return;
+    }
+  }
+
+  NodeId variable = ast.getChild(condition, 0);
+  NodeId bound = ast.getChild(condition, 2);
+  Comparator comparator =
+      static_cast<Comparator>(ast[ast.getChild(condition, 1)].op);
+  if (ast[variable].type != NodeType::Identifier ||
+      inductions.count(ast[variable].value) == 0) {
+    std::swap(variable, bound);
+    if (comparator == Comparator::Less) {
+      comparator = Comparator::Greater;
+    } else if (comparator == Comparator::Greater) {
+      comparator = Comparator::Less;
+    }
+  }
+  if (ast[variable].type != NodeType::Identifier ||
+      inductions.count(ast[variable].value) == 0 ||
+      !isInvariant(bound, false)) {
+    return;
+  }
+
+  // The body is only updates, so every induction variable found in it counts.
+  std::uint32_t position = ast[node].position;
+  std::uint32_t count = addVariable(DataType::Int);
+  NodeId operands[] = {variable, bound};
+  NodeId tripCount =
+      ast.addNode(NodeType::TripCount, position, operands, 2,
+                  static_cast<std::uint8_t>(comparator),
+                  static_cast<std::uint32_t>(
+                      inductions[ast[variable].value].step));
+
+  std::vector<NodeId> updates;
+  for (std::uint32_t i = 0; i < ast[body].childCount; i++) {
+    NodeId update = ast.getChild(body, i);
+    NodeId value = ast.getChild(update, 1);
+    std::uint32_t slot = ast[ast.getChild(update, 0)].value;
+    std::uint32_t at = ast[update].position;
+    NodeId steps = makeBinary(NodeType::Term, makeIdentifier(count, at),
+                              Operator::Multiply, ast.getChild(value, 2), at);
+    updates.push_back(makeAssignment(
+        slot, makeBinary(NodeType::Expression, makeIdentifier(slot, at),
+                         static_cast<Operator>(ast[ast.getChild(value, 1)].op),
+                         steps, at)));
+  }
+  NodeId solved = ast.addNode(NodeType::StatementList, position,
+                              updates.data(),
+                              static_cast<std::uint32_t>(updates.size()));
+  NodeId fallback[] = {ast.copyNode(node)};
+  NodeId fallbackBody =
+      ast.addNode(NodeType::StatementList, position, fallback, 1);
+  NodeId clauses[] = {
+      makeComparison(makeIdentifier(count, position), Comparator::NotEqual,
+                     makeConstant(-1, position), position),
+      solved,
+      ast.addNode(NodeType::ElseStatement, position, &fallbackBody, 1)};
+  NodeId statements[] = {
+      makeAssignment(count, tripCount),
+      ast.addNode(NodeType::IfStatement, position, clauses, 3)};
+  ast[node].type = NodeType::StatementList;
+  ast.setChildren(node, statements, 2);
+}
+
+void LoopOptimizer::countAssignments(NodeId node) {
+  switch (ast[node].type) {
+    case NodeType::VarDeclaration:
+      if (ast[node].childCount > 2) {  // Check for expression
+        assignments[ast[ast.getChild(node, 1)].value]++;
+      }
+      break;
+    case NodeType::Assignment:
+      assignments[ast[ast.getChild(node, 0)].value]++;
+      break;
+    case NodeType::IfStatement:
+    case NodeType::ElifStatement:
+    case NodeType::ElseStatement:
+    case NodeType::WhileStatement:
+    case NodeType::StatementList:
+      for (const NodeId* child = ast.beginChildren(node);
+           child != ast.endChildren(node); child++) {
+        countAssignments(*child);
+      }
+      break;
+    default:
+      break;
+  }
+}
+
+void LoopOptimizer::findInductions(NodeId body) {
+  inductions.clear();
+  for (const NodeId* child = ast.beginChildren(body);
+       child != ast.endChildren(body); child++) {
+    if (ast[*child].type != NodeType::Assignment) {
+      continue;
+    }
+    std::uint32_t slot = ast[ast.getChild(*child, 0)].value;
+    NodeId value = ast.getChild(*child, 1);
+    if (ast.getSlotType(slot) != DataType::Int || assignments[slot] != 1 ||
+        ast[value].type != NodeType::Expression ||
+        ast[value].childCount != 3) {
+      continue;
+    }
+    NodeId variable = ast.getChild(value, 0);
+    NodeId step = ast.getChild(value, 2);
+    if (ast[variable].type != NodeType::Identifier ||
+        ast[variable].value != slot ||
+        ast[step].type != NodeType::Literal ||
+        ast[step].dataType != DataType::Int) {
+      continue;
+    }
+    std::int32_t amount = static_cast<std::int32_t>(ast[step].value);
+    if (static_cast<Operator>(ast[ast.getChild(value, 1)].op) ==
+        Operator::Subtract) {
+      amount = arithmetic::negate(amount);
+    }
+    inductions[slot] = {amount, *child};
+  }
+}
+
+void LoopOptimizer::rewriteStatement(NodeId node) {
+  switch (ast[node].type) {
+    case NodeType::VarDeclaration:
+      if (ast[node].childCount > 2) {  // Check for expression
+        rewriteRoot(ast.getChild(node, 2));
+      }
+      break;
+    case NodeType::Assignment:
+      rewriteRoot(ast.getChild(node, 1));
+      break;
+    case NodeType::PrintStatement:
+      if (ast[ast.getChild(node, 0)].type != NodeType::StringLiteral) {
+        rewriteRoot(ast.getChild(node, 0));
+      }
+      break;
+    case NodeType::IfStatement:
+      rewriteCondition(ast.getChild(node, 0));
+      rewriteStatementList(ast.getChild(node, 1));
+      for (std::uint32_t i = 2; i < ast[node].childCount; i++) {
+        NodeId child = ast.getChild(node, i);
+        if (ast[child].type == NodeType::ElifStatement) {
+          rewriteCondition(ast.getChild(child, 0));
+          rewriteStatementList(ast.getChild(child, 1));
+        } else {
+          rewriteStatementList(ast.getChild(child, 0));
+        }
+      }
+      break;
+    case NodeType::WhileStatement:
+      rewriteCondition(ast.getChild(node, 0));
+      rewriteStatementList(ast.getChild(node, 1));
+      break;
+    case NodeType::StatementList:
+      rewriteStatementList(node);
+      break;
+    default:
+      throw std::runtime_error("Unknown statement type.");
+  }
+}
+
+void LoopOptimizer::rewriteStatementList(NodeId node) {
+  for (std::uint32_t i = 0; i < ast[node].childCount; i++) {
+    rewriteStatement(ast.getChild(node, i));
+  }
+}
+
+void LoopOptimizer::rewriteCondition(NodeId node) {
+  rewriteRoot(ast.getChild(node, 0));
+  rewriteRoot(ast.getChild(node, 2));
+}
+
+void LoopOptimizer::rewriteRoot(NodeId node) {
+  if (rewriteExpression(node)) {
+    hoist(node);
+  }
+}
+
+// Returns whether the expression is invariant and cannot fail, leaving the
+// decision to move it to the caller; invariant parts of anything else are
+// moved here.
+bool LoopOptimizer::rewriteExpression(NodeId node) {
+  switch (ast[node].type) {
+    case NodeType::Literal:
+      return true;
+    case NodeType::Identifier:
+      return assignments[ast[node].value] == 0;
+    case NodeType::UnaryMinus:
+    case NodeType::Convert:
+      // Neither can fail, so they move along with their operand.
+      return rewriteExpression(ast.getChild(node, 0));
+    case NodeType::TripCount:
+      for (std::uint32_t i = 0; i < 2; i++) {
+        if (rewriteExpression(ast.getChild(node, i))) {
+          hoist(ast.getChild(node, i));
+        }
+      }
+      return false;
+    case NodeType::Expression:
+    case NodeType::Term:
+      break;
+    default:
+      throw std::runtime_error("Invalid node type in expression.");
+  }
+
+  if (reduceProduct(node)) {
+    return rewriteExpression(node);
+  }
+  std::uint32_t count = ast[node].childCount;
+  std::vector<bool> movable;
+  bool allMovable = true;
+  for (std::uint32_t i = 0; i < count; i += 2) {
+    movable.push_back(rewriteExpression(ast.getChild(node, i)));
+    allMovable =
+        allMovable && movable.back() && (i == 0 || !canFail(node, i - 1));
+  }
+  if (allMovable) {
+    return true;
+  }
+
+  // Operators are left-associative, so a movable prefix of the operands can
+  // be computed on its own.
+  std::uint32_t prefix = 0;
+  while (prefix < movable.size() && movable[prefix] &&
+         (prefix == 0 || !canFail(node, prefix * 2 - 1))) {
+    prefix++;
+  }
+  std::uint32_t shift = 0;
+  if (prefix >= 2) {
+    std::vector<NodeId> operands(ast.beginChildren(node),
+                                 ast.beginChildren(node) + prefix * 2 - 1);
+    NodeId part = ast.copyNode(node);
+    ast.setChildren(part, operands.data(),
+                    static_cast<std::uint32_t>(operands.size()));
+    hoist(part);
+    operands.assign(ast.beginChildren(node) + prefix * 2 - 1,
+                    ast.endChildren(node));
+    operands.insert(operands.begin(), part);
+    ast.setChildren(node, operands.data(),
+                    static_cast<std::uint32_t>(operands.size()));
+    shift = prefix - 1;
+  } else {
+    prefix = 0;
+  }
+  for (std::uint32_t i = prefix; i < movable.size(); i++) {
+    if (movable[i]) {
+      hoist(ast.getChild(node, (i - shift) * 2));
+    }
+  }
+  return false;
+}
+
+// Replaces a leading `i * k` or `k * i` of a Term, with i an induction
+// variable and k an int literal, by the variable holding that product.
+bool LoopOptimizer::reduceProduct(NodeId node) {
+  if (ast[node].type != NodeType::Term ||
+      ast[node].dataType != DataType::Int || ast[node].childCount < 3 ||
+      static_cast<Operator>(ast[ast.getChild(node, 1)].op) !=
+          Operator::Multiply) {
+    return false;
+  }
+  NodeId variable = ast.getChild(node, 0);
+  NodeId factor = ast.getChild(node, 2);
+  if (ast[variable].type == NodeType::Literal) {
+    std::swap(variable, factor);
+  }
+  if (ast[variable].type != NodeType::Identifier ||
+      ast[factor].type != NodeType::Literal ||
+      inductions.count(ast[variable].value) == 0) {
+    return false;
+  }
+
+  std::uint32_t slot = ast[variable].value;
+  std::int32_t k = static_cast<std::int32_t>(ast[factor].value);
+  std::uint32_t position = ast[node].position;
+  auto found = products.find({slot, k});
+  std::uint32_t product;
+  if (found != products.end()) {
+    product = found->second;
+  } else {
+    product = addVariable(DataType::Int);
+    products[{slot, k}] = product;
+    preheader.push_back(makeAssignment(
+        product, makeBinary(NodeType::Term, makeIdentifier(slot, position),
+                            Operator::Multiply, makeConstant(k, position),
+                            position)));
+    const Induction& induction = inductions[slot];
+    productUpdates.push_back(
+        {induction.update,
+         makeAssignment(
+             product,
+             makeBinary(NodeType::Expression,
+                        makeIdentifier(product, position), Operator::Add,
+                        makeConstant(arithmetic::multiply(induction.step, k),
+                                     position),
+                        position))});
+    assignments[product] = 1;
+  }
+
+  NodeId replacement = makeIdentifier(product, position);
+  if (ast[node].childCount == 3) {
+    ast[node] = ast[replacement];
+  } else {
+    std::vector<NodeId> operands(ast.beginChildren(node) + 3,
+                                 ast.endChildren(node));
+    operands.insert(operands.begin(), replacement);
+    ast.setChildren(node, operands.data(),
+                    static_cast<std::uint32_t>(operands.size()));
+  }
+  return true;
+}
+
+bool LoopOptimizer::canFail(NodeId node, std::uint32_t operatorIndex) const {
+  if (static_cast<Operator>(ast[ast.getChild(node, operatorIndex)].op) !=
+      Operator::Divide) {
+    return false;
+  }
+  NodeId divisor = ast.getChild(node, operatorIndex + 1);
+  if (ast[divisor].type != NodeType::Literal) {
+    return true;
+  }
+  if (ast[divisor].dataType == DataType::Float) {
+    return ast.getFloat(ast[divisor].value) == 0;
+  }
+  return ast[divisor].value == 0;
+}
+
+// Whether an expression only reads variables the loop does not assign, and
+// with safe also whether it cannot fail.
+bool LoopOptimizer::isInvariant(NodeId node, bool safe) const {
+  switch (ast[node].type) {
+    case NodeType::Literal:
+      return true;
+    case NodeType::Identifier:
+      return assignments[ast[node].value] == 0;
+    case NodeType::UnaryMinus:
+    case NodeType::Convert:
+      return isInvariant(ast.getChild(node, 0), safe);
+    case NodeType::Expression:
+    case NodeType::Term:
+      for (std::uint32_t i = 0; i < ast[node].childCount; i += 2) {
+        if (!isInvariant(ast.getChild(node, i), safe) ||
+            (safe && i > 0 && canFail(node, i - 1))) {
+          return false;
+        }
+      }
+      return true;
+    default:
+      return false;
+  }
+}
+
+// Moves an expression in front of the loop; literals and variables are left
+// where they are.
+void LoopOptimizer::hoist(NodeId node) {
+  NodeType type = ast[node].type;
+  if (type == NodeType::Literal || type == NodeType::Identifier) {
+    return;
+  }
+  DataType dataType = ast[node].dataType;
+  std::uint32_t slot = addVariable(dataType);
+  preheader.push_back(makeAssignment(slot, ast.copyNode(node)));
+  NodeId identifier = makeIdentifier(slot, ast[node].position);
+  ast[node] = ast[identifier];
+}
+
+std::uint32_t LoopOptimizer::addVariable(DataType type) {
+  std::uint32_t slot = ast.getSlotCount();
+  ast.addSlot(ast.addName("$" + std::to_string(slot)));
+  ast.setSlotType(slot, type);
+  assignments.push_back(0);
+  return slot;
+}
+
+NodeId LoopOptimizer::makeIdentifier(std::uint32_t slot,
+                                     std::uint32_t position) {
+  NodeId node =
+      ast.addNode(NodeType::Identifier, position, nullptr, 0, 0, slot);
+  ast[node].dataType = ast.getSlotType(slot);
+  return node;
+}
+
+NodeId LoopOptimizer::makeConstant(std::int32_t value,
+                                   std::uint32_t position) {
+  return ast.addNode(NodeType::Literal, position, nullptr, 0,
+                     static_cast<std::uint8_t>(DataType::Int),
+                     static_cast<std::uint32_t>(value));
+}
+
+NodeId LoopOptimizer::makeBinary(NodeType type,
+                                 NodeId left,
+                                 Operator op,
+                                 NodeId right,
+                                 std::uint32_t position) {
+  NodeId children[] = {
+      left,
+      ast.addNode(NodeType::Operator, position, nullptr, 0,
+                  static_cast<std::uint8_t>(op)),
+      right};
+  return ast.addNode(type, position, children, 3);
+}
+
+NodeId LoopOptimizer::makeAssignment(std::uint32_t slot, NodeId expression) {
+  std::uint32_t position = ast[expression].position;
+  NodeId children[] = {makeIdentifier(slot, position), expression};
+  return ast.addNode(NodeType::Assignment, position, children, 2);
+}
+
+NodeId LoopOptimizer::makeComparison(NodeId left,
+                                     Comparator comparator,
+                                     NodeId right,
+                                     std::uint32_t position) {
+  NodeId children[] = {
+      left,
+      ast.addNode(NodeType::Comparator, position, nullptr, 0,
+                  static_cast<std::uint8_t>(comparator)),
+      right};
+  return ast.addNode(NodeType::Comparison, position, children, 3);
+}
@@ -0,0 +1,158 @@
+#include "output.h"
+#include <unistd.h>
+#include <cerrno>
+#include <charconv>
+#include <iostream>
+#include <utility>
+
+Output::Output(int fd, FlushPolicy policy, bool background)
+    : fd(fd),
+      policy(policy),
+      target(&buffer),
+      background(background),
+      writing(false),
+      stopping(false) {
+  std::cout.flush();
+  buffer.reserve(CAPACITY);
+  if (background) {
+    pending.reserve(CAPACITY);
+    writer = std::thread(&Output::runWriter, this);
+  }
+}
+
+Output::Output(std::function<void(std::string_view text)> sink,
+               FlushPolicy policy)
+    : fd(-1),
+      sink(std::move(sink)),
+      policy(policy),
+      target(&buffer),
+      background(false),
+      writing(false),
+      stopping(false) {
+  buffer.reserve(CAPACITY);
+}
+
+Output::Output(std::string& text)
+    : fd(-1),
+      policy(FlushPolicy::Exit),
+      target(&text),
+      background(false),
+      writing(false),
+      stopping(false) {}
+
+Output::~Output() {
+  flush();
+  if (background) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+    }
+    changed.notify_all();
+    writer.join();
+  }
+}
+
+// Formatting a double with precision 6 in the general format gives what
+// std::ostream prints for it by default.
+void Output::printFloat(double value) {
+  char digits[32];
+  auto result = std::to_chars(digits, digits + sizeof(digits), value,
+                              std::chars_format::general, 6);
+  *target += "> ";
+  target->append(digits, result.ptr);
+  endLine();
+}
+
+void Output::printInt(std::int32_t value) {
+  char digits[16];
+  auto result = std::to_chars(digits, digits + sizeof(digits), value);
+  *target += "> ";
+  target->append(digits, result.ptr);
+  endLine();
+}
+
+void Output::printString(std::string_view text) {
+  *target += "> ";
+  *target += text;
+  endLine();
+}
+
+void Output::flush() {
+  if (target != &buffer) {
+    return;
+  }
+  if (!buffer.empty()) {
+    send();
+  }
+  if (background) {
+    waitForWriter();
+  }
+}
+
+void Output::endLine() {
+  *target += '\n';
+  if (target != &buffer) {
+    return;
+  }
+  bool full = policy == FlushPolicy::Size && buffer.size() >= CAPACITY;
+  if (policy == FlushPolicy::Line || full) {
+    send();
+  }
+}
+
+// Hands the buffer over to the writer thread, once it is done with the last
+// one, and carries on with the one it wrote.
+void Output::send() {
+  if (!background) {
+    writeAll(buffer);
+    buffer.clear();
+    return;
+  }
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    changed.wait(lock, [this] { return !writing; });
+    pending.swap(buffer);
+    writing = true;
+  }
+  changed.notify_all();
+  buffer.clear();
+}
+
+void Output::waitForWriter() {
+  std::unique_lock<std::mutex> lock(mutex);
+  changed.wait(lock, [this] { return !writing; });
+}
+
+void Output::runWriter() {
+  std::unique_lock<std::mutex> lock(mutex);
+  while (true) {
+    changed.wait(lock, [this] { return writing || stopping; });
+    if (!writing) {
+      return;
+    }
+    lock.unlock();
+    writeAll(pending);
+    lock.lock();
+    writing = false;
+    changed.notify_all();
+  }
+}
+
+// Errors are ignored, as std::cout would.
+void Output::writeAll(const std::string& bytes) const {
+  if (sink) {
+    sink(bytes);
+    return;
+  }
+  std::size_t done = 0;
+  while (done < bytes.size()) {
+    ssize_t count = write(fd, bytes.data() + done, bytes.size() - done);
+    if (count < 0 && errno == EINTR) {
+      continue;
+    }
+    if (count <= 0) {
+      return;
+    }
+    done += static_cast<std::size_t>(count);
+  }
+}
@@ -1,36 +1,63 @@
 #include "parser.h"
+#include <charconv>
 
-Parser::Parser(Lexer& lexer) : lexer(lexer) {
+Parser::Parser(Lexer& lexer)
+    : lexer(lexer), lookaheadStart(0), lookaheadCount(0) {
   advance();
 }
 
-std::map<NodeType, std::string> ASTNode::nodeNames = {
-    {NodeType::Program, "Program"},
-    {NodeType::Expression, "Expression"},
-    {NodeType::Term, "Term"},
-    {NodeType::Factor, "Factor"},
-    {NodeType::Literal, "Literal"},
-    {NodeType::Operator, "Operator"},
-    {NodeType::UnaryMinus, "UnaryMinus"},
-    {NodeType::PrintStatement, "PrintStatement"},
-    {NodeType::VarDeclaration, "VarDeclaration"},
-    {NodeType::Assignment, "Assignment"},
-    {NodeType::DataType, "DataType"},
-    {NodeType::Identifier, "Identifier"},
-    {NodeType::StringLiteral, "StringLiteral"},
-    {NodeType::IfStatement, "IfStatement"},
-    {NodeType::ElifStatement, "ElifStatement"},
-    {NodeType::ElseStatement, "ElseStatement"},
-    {NodeType::WhileStatement, "WhileStatement"},
-    {NodeType::Comparison, "Comparison"},
-    {NodeType::Comparator, "Comparator"},
-    {NodeType::StatementList, "IndentedStatementList"}};
-
-ASTNode::ASTNode(NodeType type) : type(type), nodeName(nodeNames[type]) {}
-
 void Parser::advance() {
-  currentToken = lexer.getNextToken();
-  nextToken = lexer.peekNextToken();
+  if (lookaheadCount > 0) {
+    currentToken = lookahead[lookaheadStart];
+    lookaheadStart = (lookaheadStart + 1) % LOOKAHEAD;
+    lookaheadCount--;
+  } else {
+    currentToken = lexer.getNextToken();
+  }
+}
+
+// Returns the token `offset` positions after the current one without
+// consuming anything.
+Token Parser::peekToken(std::size_t offset) {
+  if (offset == 0) {
+    return currentToken;
+  }
+  if (offset > LOOKAHEAD) {
+    throw std::runtime_error("Parser lookahead exceeded.");
+  }
+  while (lookaheadCount < offset) {
+    lookahead[(lookaheadStart + lookaheadCount) % LOOKAHEAD] =
+        lexer.getNextToken();
+    lookaheadCount++;
+  }
+  return lookahead[(lookaheadStart + offset - 1) % LOOKAHEAD];
+}
+
+// Checks whether the line after the current NEWLINE sits at the given
+// indentation and starts with the given keyword.
+bool Parser::nextLineStartsWith(int indentLevel, Keyword keyword) {
+  if (currentToken.getType() != TokenType::TOKEN_NEWLINE) {
+    return false;
+  }
+  std::size_t offset = 1;
+  if (indentLevel > 0) {
+    Token indent = peekToken(1);
+    if (indent.getType() != TokenType::TOKEN_INDENT ||
+        static_cast<int>(indent.getId()) != indentLevel) {
+      return false;
+    }
+    offset = 2;
+  }
+  Token token = peekToken(offset);
+  return token.getType() == TokenType::TOKEN_KEYWORD &&
+         token.getId() == keyword;
+}
+
+void Parser::skipToNextLine(int indentLevel) {
+  eat(TokenType::TOKEN_NEWLINE);
+  if (indentLevel > 0) {
+    eat(TokenType::TOKEN_INDENT);
+  }
 }
 
 void Parser::eat(TokenType type) {
@@ -40,33 +67,77 @@ void Parser::eat(TokenType type) {
     std::string errorMsg = "Expected token of type " +
                            std::to_string(static_cast<int>(type)) +
                            ", got token of type " + currentToken.asString() +
-                           " with value '" + currentToken.getValue() + "'";
+                           " with value '" +
+                           std::string(currentToken.getValue()) + "'";
     throw std::runtime_error(errorMsg);
   }
 }
 
-std::shared_ptr<ASTNode> Parser::parse() {
-  auto programNode = std::make_shared<ASTNode>(NodeType::Program);
+// Children are collected on a shared stack while a node is being parsed and
+// copied into the AST as one contiguous range once the node is complete.
+std::size_t Parser::openNode() const {
+  return pendingChildren.size();
+}
+
+NodeId Parser::closeNode(NodeType type,
+                         std::size_t mark,
+                         std::uint8_t op,
+                         std::uint32_t value) {
+  // A node starts where its first child does
+  std::uint32_t position = (pendingChildren.size() > mark)
+                               ? (*ast)[pendingChildren[mark]].position
+                               : tokenPosition();
+  NodeId id = ast->addNode(
+      type, position, pendingChildren.data() + mark,
+      static_cast<std::uint32_t>(pendingChildren.size() - mark), op, value);
+  pendingChildren.resize(mark);
+  return id;
+}
+
+NodeId Parser::addLeaf(NodeType type,
+                       std::uint32_t position,
+                       std::uint8_t op,
+                       std::uint32_t value) {
+  return ast->addNode(type, position, nullptr, 0, op, value);
+}
+
+std::uint32_t Parser::tokenPosition() const {
+  return static_cast<std::uint32_t>(currentToken.getPosStart().getIndex());
+}
+
+std::unique_ptr<AST> Parser::parse() {
+  ast = std::make_unique<AST>();
+  ast->setSource(lexer.getSource().shared_from_this());
+  std::size_t mark = openNode();
   while (currentToken.getType() != TokenType::TOKEN_EOF &&
-         currentToken.getValue() != "run") {
-    programNode->addChild(parseStatement());
+         !(currentToken.getType() == TokenType::TOKEN_KEYWORD &&
+           currentToken.getId() == KEYWORD_RUN)) {
+    pendingChildren.push_back(parseStatement());
     eat(TokenType::TOKEN_NEWLINE);  // Assuming TOKEN_NEWLINE represents '\n'
   }
   eat(TokenType::TOKEN_KEYWORD);  // Consume 'run'
   eat(TokenType::TOKEN_NEWLINE);  // Consume the newline after 'run'
-  root = programNode;
-  return programNode;
+  ast->setRoot(closeNode(NodeType::Program, mark));
+
+  const Interner& interner = lexer.getInterner();
+  std::vector<std::string> names;
+  names.reserve(interner.size());
+  for (std::uint32_t id = 0; id < interner.size(); id++) {
+    names.push_back(interner.getName(id));
+  }
+  ast->setNames(std::move(names));
+  return std::move(ast);
 }
 
-std::shared_ptr<ASTNode> Parser::parseStatement(int indentLevel) {
+NodeId Parser::parseStatement(int indentLevel) {
   if (currentToken.getType() == TokenType::TOKEN_KEYWORD) {
-    if (currentToken.getValue() == "var") {
+    if (currentToken.getId() == KEYWORD_VAR) {
       return parseVarDeclaration();
-    } else if (currentToken.getValue() == "print") {
+    } else if (currentToken.getId() == KEYWORD_PRINT) {
       return parsePrintStatement();
-    } else if (currentToken.getValue() == "if") {
+    } else if (currentToken.getId() == KEYWORD_IF) {
       return parseIfStatement(indentLevel);
-    } else if (currentToken.getValue() == "while") {
+    } else if (currentToken.getId() == KEYWORD_WHILE) {
       return parseWhileStatement(indentLevel);
     }
   } else if (currentToken.getType() == TokenType::TOKEN_IDENTIFIER) {
@@ -76,272 +147,299 @@ std::shared_ptr<ASTNode> Parser::parseStatement(int indentLevel) {
                            currentToken.asString());
 }
 
-std::shared_ptr<ASTNode> Parser::parseVarDeclaration() {
+NodeId Parser::parseVarDeclaration() {
   eat(TokenType::TOKEN_KEYWORD);  // Consume 'var'
-  auto dataTypeNode = parseDataType();
-  auto identifierNode = parseIdentifier();
-
-  auto varDeclNode = std::make_shared<ASTNode>(NodeType::VarDeclaration);
-  varDeclNode->addChild(dataTypeNode);
-  varDeclNode->addChild(identifierNode);
+  std::size_t mark = openNode();
+  pendingChildren.push_back(parseDataType());
+  pendingChildren.push_back(parseIdentifier());
 
   if (currentToken.getType() == TokenType::TOKEN_OPERATOR) {  // Check for '='
     eat(TokenType::TOKEN_OPERATOR);                           // Consume '='
-    auto expressionNode = parseExpression();
-    varDeclNode->addChild(expressionNode);
+    pendingChildren.push_back(parseExpression());
   }
 
-  return varDeclNode;
+  return closeNode(NodeType::VarDeclaration, mark);
 }
 
-std::shared_ptr<ASTNode> Parser::parseAssignment() {
-  auto identifierNode = parseIdentifier();
+NodeId Parser::parseAssignment() {
+  std::size_t mark = openNode();
+  pendingChildren.push_back(parseIdentifier());
   eat(TokenType::TOKEN_OPERATOR);  // Consume '='
-  auto expressionNode = parseExpression();
-
-  auto assignmentNode = std::make_shared<ASTNode>(NodeType::Assignment);
-  assignmentNode->addChild(identifierNode);
-  assignmentNode->addChild(expressionNode);
-  return assignmentNode;
+  pendingChildren.push_back(parseExpression());
+  return closeNode(NodeType::Assignment, mark);
 }
 
-std::shared_ptr<ASTNode> Parser::parseDataType() {
+NodeId Parser::parseDataType() {
   if (currentToken.getType() != TokenType::TOKEN_KEYWORD ||
-      (currentToken.getValue() != "int" &&
-       currentToken.getValue() != "float")) {
+      (currentToken.getId() != KEYWORD_INT &&
+       currentToken.getId() != KEYWORD_FLOAT)) {
     throw std::runtime_error("Expected data type (int or float)");
   }
-  auto dataTypeNode = std::make_shared<ASTNode>(NodeType::DataType);
-  dataTypeNode->value = currentToken.getValue();
+  DataType dataType =
+      (currentToken.getId() == KEYWORD_INT) ? DataType::Int : DataType::Float;
+  std::uint32_t position = tokenPosition();
   advance();
-  return dataTypeNode;
+  return addLeaf(NodeType::DataType, position,
+                 static_cast<std::uint8_t>(dataType));
 }
 
-std::shared_ptr<ASTNode> Parser::parseIdentifier() {
+NodeId Parser::parseIdentifier() {
   if (currentToken.getType() != TokenType::TOKEN_IDENTIFIER) {
     throw std::runtime_error("Expected identifier");
   }
-  auto identifierNode = std::make_shared<ASTNode>(NodeType::Identifier);
-  identifierNode->value = currentToken.getValue();
+  NodeId identifierNode =
+      addLeaf(NodeType::Identifier, tokenPosition(), 0, currentToken.getId());
   advance();
   return identifierNode;
 }
 
-std::shared_ptr<ASTNode> Parser::parseExpression() {
-  auto node = std::make_shared<ASTNode>(NodeType::Expression);
-  node->addChild(parseTerm());
+NodeId Parser::parseOperator() {
+  std::uint32_t position = tokenPosition();
+  Operator op;
+  switch (currentToken.getId()) {
+    case '+':
+      op = Operator::Add;
+      break;
+    case '-':
+      op = Operator::Subtract;
+      break;
+    case '*':
+      op = Operator::Multiply;
+      break;
+    default:
+      op = Operator::Divide;
+      break;
+  }
+  advance();
+  return addLeaf(NodeType::Operator, position, static_cast<std::uint8_t>(op));
+}
+
+NodeId Parser::parseExpression() {
+  std::size_t mark = openNode();
+  pendingChildren.push_back(parseTerm());
 
   while (currentToken.getType() == TokenType::TOKEN_OPERATOR &&
-         (currentToken.getValue() == "+" || currentToken.getValue() == "-")) {
-    auto opNode = std::make_shared<ASTNode>(NodeType::Operator);
-    opNode->value = currentToken.getValue();
-    node->addChild(opNode);
-    advance();
-    node->addChild(parseTerm());
+         (currentToken.getId() == '+' || currentToken.getId() == '-')) {
+    pendingChildren.push_back(parseOperator());
+    pendingChildren.push_back(parseTerm());
   }
 
-  return node;
+  return closeNode(NodeType::Expression, mark);
 }
 
-std::shared_ptr<ASTNode> Parser::parseTerm() {
-  auto node = std::make_shared<ASTNode>(NodeType::Term);
-  node->addChild(parseFactor());
+NodeId Parser::parseTerm() {
+  std::size_t mark = openNode();
+  pendingChildren.push_back(parseFactor());
 
   while (currentToken.getType() == TokenType::TOKEN_OPERATOR &&
-         (currentToken.getValue() == "*" || currentToken.getValue() == "/")) {
-    auto opNode = std::make_shared<ASTNode>(NodeType::Operator);
-    opNode->value = currentToken.getValue();
-    node->addChild(opNode);
-    advance();
-    node->addChild(parseFactor());
+         (currentToken.getId() == '*' || currentToken.getId() == '/')) {
+    pendingChildren.push_back(parseOperator());
+    pendingChildren.push_back(parseFactor());
   }
 
-  return node;
+  return closeNode(NodeType::Term, mark);
 }
 
-std::shared_ptr<ASTNode> Parser::parseFactor() {
-  std::shared_ptr<ASTNode> node;
-
+NodeId Parser::parseFactor() {
   if (currentToken.getType() == TokenType::TOKEN_OPERATOR &&
-      currentToken.getValue() == "-") {
+      currentToken.getId() == '-') {
     advance();
-    node = std::make_shared<ASTNode>(NodeType::UnaryMinus);
-    node->addChild(parseFactor());
+    std::size_t mark = openNode();
+    pendingChildren.push_back(parseFactor());
+    return closeNode(NodeType::UnaryMinus, mark);
   } else if (currentToken.getType() == TokenType::TOKEN_INTEGER ||
              currentToken.getType() == TokenType::TOKEN_FLOAT) {
-    node = std::make_shared<ASTNode>(NodeType::Literal);
-    node->value = currentToken.getValue();
-    advance();
+    return parseLiteral();
   } else if (currentToken.getType() == TokenType::TOKEN_IDENTIFIER) {
     return parseIdentifier();
   } else if (currentToken.getType() == TokenType::TOKEN_PARENTHESIS) {
     eat(TokenType::TOKEN_PARENTHESIS);  // Consume '('
-    auto node = parseExpression();
+    NodeId node = parseExpression();
     eat(TokenType::TOKEN_PARENTHESIS);  // Consume ')'
     return node;
-  } else {
-    throw std::runtime_error("Invalid factor.");
   }
+  throw std::runtime_error("Invalid factor.");
+}
 
+// Number tokens are decoded here, once, so nothing downstream has to parse
+// text again.
+NodeId Parser::parseLiteral() {
+  std::string_view text = currentToken.getValue();
+  const char* first = text.data();
+  const char* last = text.data() + text.size();
+  NodeId node;
+  if (currentToken.getType() == TokenType::TOKEN_FLOAT) {
+    double value = 0;
+    std::from_chars(first, last, value);
+    node = addLeaf(NodeType::Literal, tokenPosition(),
+                   static_cast<std::uint8_t>(DataType::Float),
+                   ast->addFloat(value));
+  } else {
+    std::int32_t value = 0;
+    auto result = std::from_chars(first, last, value);
+    if (result.ec == std::errc::result_out_of_range) {
+      throw InvalidSyntaxError(currentToken.getPosStart(),
+                               currentToken.getPosEnd(),
+                               "Integer literal out of range.");
+    }
+    node = addLeaf(NodeType::Literal, tokenPosition(),
+                   static_cast<std::uint8_t>(DataType::Int),
+                   static_cast<std::uint32_t>(value));
+  }
+  advance();
   return node;
 }
 
-std::shared_ptr<ASTNode> Parser::parsePrintStatement() {
+NodeId Parser::parsePrintStatement() {
   if (currentToken.getType() == TokenType::TOKEN_KEYWORD &&
-      currentToken.getValue() == "print") {
+      currentToken.getId() == KEYWORD_PRINT) {
     eat(TokenType::TOKEN_KEYWORD);
   }
 
-  std::shared_ptr<ASTNode> node =
-      std::make_shared<ASTNode>(NodeType::PrintStatement);
-
+  std::size_t mark = openNode();
   if (currentToken.getType() == TokenType::TOKEN_STRING) {
-    auto stringLiteralNode = std::make_shared<ASTNode>(NodeType::StringLiteral);
-    stringLiteralNode->value = currentToken.getValue();
-    node->addChild(stringLiteralNode);
+    pendingChildren.push_back(
+        addLeaf(NodeType::StringLiteral, tokenPosition(), 0,
+                ast->addString(currentToken.getValue())));
     eat(TokenType::TOKEN_STRING);
   } else {
-    node->addChild(parseExpression());
+    pendingChildren.push_back(parseExpression());
   }
 
-  return node;
+  return closeNode(NodeType::PrintStatement, mark);
 }
 
-std::shared_ptr<ASTNode> Parser::parseIfStatement(int indentLevel) {
+NodeId Parser::parseIfStatement(int indentLevel) {
   eat(TokenType::TOKEN_KEYWORD);      // Consume 'if'
   eat(TokenType::TOKEN_PARENTHESIS);  // Consume '('
-  auto condition = parseComparison();
+  std::size_t mark = openNode();
+  pendingChildren.push_back(parseComparison());
   eat(TokenType::TOKEN_PARENTHESIS);  // Consume ')'
   eat(TokenType::TOKEN_COLON);        // Consume ':'
   eat(TokenType::TOKEN_NEWLINE);      // Consume '\n'
-  auto body = parseIndentedStatementList(0);
+  pendingChildren.push_back(parseIndentedStatementList(indentLevel));
 
-  auto ifNode = std::make_shared<ASTNode>(NodeType::IfStatement);
-  ifNode->addChild(condition);
-  ifNode->addChild(body);
-
-  // Handle 'elif' and 'else' parts
+  // Handle 'elif' and 'else' parts, which start on the line after the body
+  // at the same indentation as the 'if'
   while (true) {
-    if (currentToken.getType() == TokenType::TOKEN_KEYWORD &&
-        currentToken.getValue() == "elif") {
-      ifNode->addChild(parseElifStatement(indentLevel));
-    } else if (currentToken.getType() == TokenType::TOKEN_KEYWORD &&
-               currentToken.getValue() == "else") {
-      ifNode->addChild(parseElseStatement(indentLevel));
+    if (nextLineStartsWith(indentLevel, KEYWORD_ELIF)) {
+      skipToNextLine(indentLevel);
+      pendingChildren.push_back(parseElifStatement(indentLevel));
+    } else if (nextLineStartsWith(indentLevel, KEYWORD_ELSE)) {
+      skipToNextLine(indentLevel);
+      pendingChildren.push_back(parseElseStatement(indentLevel));
       break;  // Only one 'else' is allowed, so break after parsing it
     } else {
       break;  // If it's not 'elif' or 'else', exit the loop
     }
   }
 
-  return ifNode;
+  return closeNode(NodeType::IfStatement, mark);
 }
 
-std::shared_ptr<ASTNode> Parser::parseElifStatement(int indentLevel) {
+NodeId Parser::parseElifStatement(int indentLevel) {
   eat(TokenType::TOKEN_KEYWORD);      // Consume 'elif'
   eat(TokenType::TOKEN_PARENTHESIS);  // Consume '('
-  auto condition = parseComparison();
+  std::size_t mark = openNode();
+  pendingChildren.push_back(parseComparison());
   eat(TokenType::TOKEN_PARENTHESIS);  // Consume ')'
   eat(TokenType::TOKEN_COLON);        // Consume ':'
   eat(TokenType::TOKEN_NEWLINE);      // Consume '\n'
-  auto body = parseIndentedStatementList(indentLevel);
-
-  auto elifNode = std::make_shared<ASTNode>(NodeType::ElifStatement);
-  elifNode->addChild(condition);
-  elifNode->addChild(body);
+  pendingChildren.push_back(parseIndentedStatementList(indentLevel));
 
-  return elifNode;
+  return closeNode(NodeType::ElifStatement, mark);
 }
 
-std::shared_ptr<ASTNode> Parser::parseElseStatement(int indentLevel) {
+NodeId Parser::parseElseStatement(int indentLevel) {
+  std::uint32_t position = tokenPosition();
   eat(TokenType::TOKEN_KEYWORD);  // Consume 'else'
   eat(TokenType::TOKEN_COLON);    // Consume ':'
   eat(TokenType::TOKEN_NEWLINE);  // Consume '\n'
-  auto body = parseIndentedStatementList(indentLevel);
+  std::size_t mark = openNode();
+  pendingChildren.push_back(parseIndentedStatementList(indentLevel));
 
-  auto elseNode = std::make_shared<ASTNode>(NodeType::ElseStatement);
-  elseNode->addChild(body);
-
-  return elseNode;
+  // It starts at the keyword, not at the body, its only child.
+  NodeId node = closeNode(NodeType::ElseStatement, mark);
+  (*ast)[node].position = position;
+  return node;
 }
 
-std::shared_ptr<ASTNode> Parser::parseWhileStatement(int indentLevel) {
+NodeId Parser::parseWhileStatement(int indentLevel) {
   eat(TokenType::TOKEN_KEYWORD);      // Consume 'while'
   eat(TokenType::TOKEN_PARENTHESIS);  // Consume '('
-  auto condition = parseComparison();
+  std::size_t mark = openNode();
+  pendingChildren.push_back(parseComparison());
   eat(TokenType::TOKEN_PARENTHESIS);  // Consume ')'
   eat(TokenType::TOKEN_COLON);        // Consume ':'
   eat(TokenType::TOKEN_NEWLINE);      // Consume '\n'
-  auto body = parseIndentedStatementList(indentLevel);
+  pendingChildren.push_back(parseIndentedStatementList(indentLevel));
 
-  auto whileNode = std::make_shared<ASTNode>(NodeType::WhileStatement);
-  whileNode->addChild(condition);
-  whileNode->addChild(body);
-
-  return whileNode;
+  return closeNode(NodeType::WhileStatement, mark);
 }
 
-std::shared_ptr<ASTNode> Parser::parseComparison() {
-  auto left = parseExpression();
-  auto comparator = parseComparator();
-  auto right = parseExpression();
-
-  auto comparisonNode = std::make_shared<ASTNode>(NodeType::Comparison);
-  comparisonNode->addChild(left);
-  comparisonNode->addChild(comparator);
-  comparisonNode->addChild(right);
+NodeId Parser::parseComparison() {
+  std::size_t mark = openNode();
+  pendingChildren.push_back(parseExpression());
+  pendingChildren.push_back(parseComparator());
+  pendingChildren.push_back(parseExpression());
 
-  return comparisonNode;
+  return closeNode(NodeType::Comparison, mark);
 }
 
-std::shared_ptr<ASTNode> Parser::parseComparator() {
-  if (currentToken.getType() != TokenType::TOKEN_COMPARATOR &&
-      (currentToken.getValue() != "<" && currentToken.getValue() != ">" &&
-       currentToken.getValue() != "?" && currentToken.getValue() != "!")) {
+NodeId Parser::parseComparator() {
+  if (currentToken.getType() != TokenType::TOKEN_COMPARATOR) {
     throw std::runtime_error("Expected comparator (<, >, ?, or !)");
   }
 
-  auto comparatorNode = std::make_shared<ASTNode>(NodeType::Comparator);
-  comparatorNode->value = currentToken.getValue();
+  std::uint32_t position = tokenPosition();
+  Comparator comparator;
+  switch (currentToken.getId()) {
+    case '<':
+      comparator = Comparator::Less;
+      break;
+    case '>':
+      comparator = Comparator::Greater;
+      break;
+    case '?':
+      comparator = Comparator::Equal;
+      break;
+    default:
+      comparator = Comparator::NotEqual;
+      break;
+  }
   advance();  // Consume the comparator token
 
-  return comparatorNode;
+  return addLeaf(NodeType::Comparator, position,
+                 static_cast<std::uint8_t>(comparator));
 }
 
-std::shared_ptr<ASTNode> Parser::parseIndentedStatementList(int indentLevel) {
-  auto indentedBlockNode = std::make_shared<ASTNode>(NodeType::StatementList);
-
-  int currentIndentLevel = indentLevel;
-  indentLevel++;
-
-  while (currentToken.getType() == TokenType::TOKEN_INDENT) {
-    for (int i = 0; i < indentLevel; i++) {
-      eat(TokenType::TOKEN_INDENT);
-    }
-
-    indentedBlockNode->addChild(parseStatement(indentLevel));
+NodeId Parser::parseIndentedStatementList(int indentLevel) {
+  // The first line of the block sets its indentation, which has to be deeper
+  // than that of the statement owning the block
+  if (currentToken.getType() != TokenType::TOKEN_INDENT ||
+      static_cast<int>(currentToken.getId()) <= indentLevel) {
+    throw std::runtime_error("Expected an indented block." +
+                             currentToken.asString());
+  }
+  int blockIndentLevel = static_cast<int>(currentToken.getId());
+  std::size_t mark = openNode();
 
-    if (nextToken.getType() != TokenType::TOKEN_INDENT) {
+  while (true) {
+    eat(TokenType::TOKEN_INDENT);
+    pendingChildren.push_back(parseStatement(blockIndentLevel));
+
+    // Every statement stops at its NEWLINE. The block goes on while the next
+    // line is indented like the block and ends on the first shallower line.
+    Token next = peekToken(1);
+    if (currentToken.getType() != TokenType::TOKEN_NEWLINE ||
+        next.getType() != TokenType::TOKEN_INDENT ||
+        static_cast<int>(next.getId()) < blockIndentLevel) {
       break;
     }
+    if (static_cast<int>(next.getId()) > blockIndentLevel) {
+      throw std::runtime_error("Unexpected indent." + next.asString());
+    }
     eat(TokenType::TOKEN_NEWLINE);
   }
-  std::cout << "indentLevel: " << indentLevel << std::endl;
-  return indentedBlockNode;
-}
-
-std::string ASTNode::asString(int depth) const {
-  std::string indent(depth * 2, ' ');
-  std::string result = indent + "Node type: " + nodeName + "\n";
-  if (!value.empty()) {
-    result += indent + "Value: " + value + "\n";
-  }
-  for (const auto& child : children) {
-    result += child->asString(depth + 1);
-  }
-  return result;
-}
-
-std::shared_ptr<ASTNode> Parser::getAST() {
-  return root;
+  return closeNode(NodeType::StatementList, mark);
 }
@@ -0,0 +1,71 @@
+#include "peephole.h"
+#include <vector>
+
+Peephole::Peephole(Chunk& chunk) : chunk(chunk) {}
+
+std::size_t Peephole::optimize() {
+  std::vector<bool> isTarget(chunk.code.size() + 1, false);
+  for (const Instruction& instruction : chunk.code) {
+    if (instruction.op == OpCode::Jump ||
+        instruction.op == OpCode::JumpIfFalse) {
+      isTarget[instruction.operand] = true;
+    }
+  }
+  for (const NativeLoop& loop : chunk.natives) {
+    isTarget[loop.exit] = true;
+  }
+
+  std::size_t count = 0;
+  for (std::size_t i = 0; i + 3 < chunk.code.size(); i++) {
+    if (isTarget[i + 1] || isTarget[i + 2] || isTarget[i + 3]) {
+      continue;
+    }
+    OpCode op = select(i);
+    if (op != OpCode::Load) {
+      chunk.code[i].op = op;
+      count++;
+      i += 3;
+    }
+  }
+  return count;
+}
+
+// Returns the superinstruction for the sequence starting at the given
+// index, or Load when there is none.
+OpCode Peephole::select(std::size_t at) const {
+  static const OpCode branches[][4] = {
+      {OpCode::BranchLess, OpCode::BranchGreater, OpCode::BranchEqual,
+       OpCode::BranchNotEqual},
+      {OpCode::BranchLessConstant, OpCode::BranchGreaterConstant,
+       OpCode::BranchEqualConstant, OpCode::BranchNotEqualConstant}};
+  const Instruction* code = chunk.code.data() + at;
+  if (code[0].op != OpCode::Load ||
+      (code[1].op != OpCode::Load && code[1].op != OpCode::Constant)) {
+    return OpCode::Load;
+  }
+  bool isConstant = code[1].op == OpCode::Constant;
+
+  if (code[3].op == OpCode::JumpIfFalse) {
+    switch (code[2].op) {
+      case OpCode::Less:
+        return branches[isConstant][0];
+      case OpCode::Greater:
+        return branches[isConstant][1];
+      case OpCode::Equal:
+        return branches[isConstant][2];
+      case OpCode::NotEqual:
+        return branches[isConstant][3];
+      default:
+        return OpCode::Load;
+    }
+  }
+  if (isConstant && code[3].op == OpCode::Store) {
+    if (code[2].op == OpCode::Add) {
+      return OpCode::AddConstant;
+    }
+    if (code[2].op == OpCode::Subtract) {
+      return OpCode::SubtractConstant;
+    }
+  }
+  return OpCode::Load;
+}
@@ -0,0 +1,69 @@
+#include "pool.h"
+#include <algorithm>
+#include <thread>
+
+WorkStealingPool::WorkStealingPool(unsigned threads) : threads(threads) {
+  if (this->threads == 0) {
+    this->threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+}
+
+unsigned WorkStealingPool::size() const {
+  return threads;
+}
+
+void WorkStealingPool::run(std::size_t count,
+                           const std::function<void(std::size_t)>& task) {
+  queues.clear();
+  for (unsigned worker = 0; worker < threads; worker++) {
+    queues.push_back(std::make_unique<Queue>());
+  }
+  for (std::size_t index = 0; index < count; index++) {
+    queues[index % threads]->tasks.push_back(index);
+  }
+
+  // The calling thread is the first worker.
+  std::vector<std::thread> workers;
+  for (unsigned worker = 1; worker < threads; worker++) {
+    workers.emplace_back(&WorkStealingPool::work, this, worker,
+                         std::cref(task));
+  }
+  work(0, task);
+  for (std::thread& worker : workers) {
+    worker.join();
+  }
+}
+
+// No tasks are added once the workers have started, so a worker that finds
+// every queue empty is done.
+void WorkStealingPool::work(unsigned worker,
+                            const std::function<void(std::size_t)>& task) {
+  std::size_t index;
+  while (take(worker, index) || steal(worker, index)) {
+    task(index);
+  }
+}
+
+bool WorkStealingPool::take(unsigned worker, std::size_t& index) {
+  Queue& queue = *queues[worker];
+  std::lock_guard<std::mutex> lock(queue.mutex);
+  if (queue.tasks.empty()) {
+    return false;
+  }
+  index = queue.tasks.front();
+  queue.tasks.pop_front();
+  return true;
+}
+
+bool WorkStealingPool::steal(unsigned worker, std::size_t& index) {
+  for (unsigned offset = 1; offset < threads; offset++) {
+    Queue& queue = *queues[(worker + offset) % threads];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (!queue.tasks.empty()) {
+      index = queue.tasks.back();
+      queue.tasks.pop_back();
+      return true;
+    }
+  }
+  return false;
+}
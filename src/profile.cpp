@@ -0,0 +1,198 @@
+#include "profile.h"
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <string_view>
+
+namespace {
+
+std::string trimmed(std::string_view text) {
+  std::size_t start = text.find_first_not_of(" \t\r\n");
+  if (start == std::string_view::npos) {
+    return "";
+  }
+  std::size_t end = text.find_last_not_of(" \t\r\n");
+  return std::string(text.substr(start, end - start + 1));
+}
+
+std::string jsonString(std::string_view text) {
+  std::string result = "\"";
+  for (unsigned char c : text) {
+    if (c == '"' || c == '\\') {
+      result += '\\';
+      result += static_cast<char>(c);
+    } else if (c < 0x20) {
+      char escaped[8];
+      std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+      result += escaped;
+    } else {
+      result += static_cast<char>(c);
+    }
+  }
+  return result + "\"";
+}
+
+bool isBranch(NodeType type) {
+  return type == NodeType::IfStatement || type == NodeType::ElifStatement ||
+         type == NodeType::ElseStatement;
+}
+
+}  // namespace
+
+Profile::Profile(const AST& ast)
+    : ast(ast),
+      counters(ast.size()),
+      random(0x9e3779b97f4a7c15),
+      startTicks(now()),
+      endTicks(startTicks),
+      start(std::chrono::steady_clock::now()),
+      end(start) {}
+
+void Profile::finish() {
+  endTicks = now();
+  end = std::chrono::steady_clock::now();
+}
+
+double Profile::toNanoseconds(double ticks) const {
+  if (endTicks == startTicks) {
+    return 0;
+  }
+  double elapsed =
+      std::chrono::duration<double, std::nano>(end - start).count();
+  return ticks * elapsed /
+         static_cast<double>(endTicks - startTicks);
+}
+
+double Profile::estimatedTicks(NodeId node) const {
+  const Counter& counter = counters[node];
+  if (counter.timed == 0) {
+    return 0;
+  }
+  return static_cast<double>(counter.ticks) *
+         static_cast<double>(counter.count) /
+         static_cast<double>(counter.timed);
+}
+
+// The time of the statements in the bodies of a statement, including those
+// of its elif and else clauses.
+double Profile::nestedTicks(NodeId node) const {
+  double ticks = 0;
+  for (const NodeId* child = ast.beginChildren(node);
+       child != ast.endChildren(node); child++) {
+    NodeType type = ast[*child].type;
+    if (ast[node].type == NodeType::StatementList) {
+      ticks += estimatedTicks(*child);
+    } else if (type == NodeType::StatementList ||
+               type == NodeType::ElifStatement ||
+               type == NodeType::ElseStatement) {
+      ticks += nestedTicks(*child);
+    }
+  }
+  return ticks;
+}
+
+// The optimizers may leave several statements on one line, such as the
+// ones the LoopOptimizer moves in front of a loop; their counts add up.
+std::vector<Profile::Line> Profile::collectLines() const {
+  std::vector<Line> lines;
+  std::vector<int> indexOfLine;
+  for (NodeId node = 0; node < counters.size(); node++) {
+    const Counter& counter = counters[node];
+    if (counter.count == 0 && counter.taken == 0) {
+      continue;
+    }
+    int line = ast.getPosition(node).getLine();
+    if (static_cast<std::size_t>(line) >= indexOfLine.size()) {
+      indexOfLine.resize(line + 1, -1);
+    }
+    if (indexOfLine[line] < 0) {
+      indexOfLine[line] = static_cast<int>(lines.size());
+      lines.push_back(Line());
+      lines.back().line = line;
+    }
+    Line& entry = lines[indexOfLine[line]];
+    NodeType type = ast[node].type;
+    if (type == NodeType::WhileStatement || isBranch(type)) {
+      entry.type = type;
+    }
+    entry.count += counter.count;
+    entry.taken += counter.taken;
+    // Elif and else clauses are not timed themselves; their conditions
+    // count towards their if.
+    if (type != NodeType::ElifStatement && type != NodeType::ElseStatement) {
+      double ticks = estimatedTicks(node);
+      entry.ticks += ticks;
+      entry.selfTicks += std::max(ticks - nestedTicks(node), 0.0);
+    }
+  }
+  return lines;
+}
+
+void Profile::report(std::ostream& out) const {
+  std::vector<Line> lines = collectLines();
+  std::sort(lines.begin(), lines.end(), [](const Line& a, const Line& b) {
+    return a.selfTicks != b.selfTicks ? a.selfTicks > b.selfTicks
+                                      : a.line < b.line;
+  });
+  double total = std::chrono::duration<double, std::nano>(end - start).count();
+
+  char row[128];
+  std::snprintf(row, sizeof(row), "Profile: %.3f ms, hottest lines first\n",
+                total / 1e6);
+  out << row;
+  out << " line        count     self ms    total ms   self  source\n";
+  for (const Line& line : lines) {
+    double self = toNanoseconds(line.selfTicks);
+    std::snprintf(row, sizeof(row), "%5d %12llu %11.3f %11.3f %5.1f%%  ",
+                  line.line + 1, static_cast<unsigned long long>(line.count),
+                  self / 1e6, toNanoseconds(line.ticks) / 1e6,
+                  total > 0 ? self * 100 / total : 0.0);
+    out << row << trimmed(ast.getSource()->lineText(line.line));
+    if (line.type == NodeType::WhileStatement) {
+      std::snprintf(row, sizeof(row), "  [%llu iterations, %.1f per entry]",
+                    static_cast<unsigned long long>(line.taken),
+                    line.count > 0
+                        ? static_cast<double>(line.taken) /
+                              static_cast<double>(line.count)
+                        : 0.0);
+      out << row;
+    } else if (isBranch(line.type)) {
+      std::snprintf(row, sizeof(row), "  [taken %llu of %llu, %.1f%%]",
+                    static_cast<unsigned long long>(line.taken),
+                    static_cast<unsigned long long>(line.count),
+                    line.count > 0
+                        ? static_cast<double>(line.taken) * 100 /
+                              static_cast<double>(line.count)
+                        : 0.0);
+      out << row;
+    }
+    out << '\n';
+  }
+}
+
+void Profile::writeJson(std::ostream& out) const {
+  std::vector<Line> lines = collectLines();
+  std::sort(lines.begin(), lines.end(),
+            [](const Line& a, const Line& b) { return a.line < b.line; });
+  out << "{\"total_ns\": "
+      << static_cast<std::uint64_t>(
+             std::chrono::duration<double, std::nano>(end - start).count())
+      << ", \"lines\": [";
+  for (std::size_t i = 0; i < lines.size(); i++) {
+    const Line& line = lines[i];
+    out << (i > 0 ? ",\n  " : "\n  ") << "{\"line\": " << line.line + 1
+        << ", \"source\": "
+        << jsonString(trimmed(ast.getSource()->lineText(line.line)))
+        << ", \"count\": " << line.count << ", \"self_ns\": "
+        << static_cast<std::uint64_t>(toNanoseconds(line.selfTicks))
+        << ", \"total_ns\": "
+        << static_cast<std::uint64_t>(toNanoseconds(line.ticks));
+    if (line.type == NodeType::WhileStatement) {
+      out << ", \"iterations\": " << line.taken;
+    } else if (isBranch(line.type)) {
+      out << ", \"taken\": " << line.taken;
+    }
+    out << "}";
+  }
+  out << "\n]}\n";
+}
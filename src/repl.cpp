@@ -0,0 +1,134 @@
+#include "repl.h"
+#include <cctype>
+#include <iostream>
+#include "compiler.h"
+#include "error.h"
+#include "folder.h"
+#include "jit.h"
+#include "lexer.h"
+#include "optimizer.h"
+#include "parser.h"
+#include "peephole.h"
+#include "typechecker.h"
+#include "vm.h"
+
+Repl::Repl(const ReplOptions& options, Output& out)
+    : options(options), out(out) {}
+
+void Repl::execute(const std::string& text) {
+  // The parser expects a program to end with `run`.
+  Lexer lexer(Source::fromString(text + "run\n", "<stdin>"));
+  Parser parser(lexer);
+  auto ast = parser.parse();
+  Resolver resolver(*ast, globals);
+  resolver.resolve();
+  TypeChecker(*ast).check();
+  std::uint32_t declared = ast->getSlotCount();
+  ConstantFolder(*ast).fold();
+  if (options.optimizeLoops) {
+    LoopOptimizer(*ast).optimize();
+  }
+  Chunk chunk = Compiler(*ast).compile();
+
+  // Slots past the earlier globals may still hold variables the loop
+  // optimizer added for the last input; they start out cleared.
+  std::uint32_t count = static_cast<std::uint32_t>(globals.types.size());
+  variables.resize(count);
+  variables.resize(chunk.slotCount, Value{});
+  globals.assigned = resolver.getAssigned();
+  globals.assigned.resize(declared);
+  for (std::uint32_t slot = count; slot < declared; slot++) {
+    globals.slots.emplace(ast->getSlotName(slot), slot);
+    globals.types.push_back(ast->getSlotType(slot));
+  }
+
+  Jit jit;
+  if (options.jit) {
+    jit.compile(chunk);
+  }
+  if (options.superinstructions) {
+    Peephole(chunk).optimize();
+  }
+  VM vm(out);
+  vm.run(chunk, variables.data());
+}
+
+bool Repl::run(std::istream& in, bool prompt) {
+  bool succeeded = true;
+  std::string text;
+  while (read(in, text, prompt)) {
+    try {
+      execute(text);
+      out.flush();
+    } catch (const Error& e) {
+      out.flush();
+      std::cerr << e.asString() << std::endl;
+      succeeded = false;
+    } catch (const std::runtime_error& e) {
+      out.flush();
+      std::cerr << e.what() << std::endl;
+      succeeded = false;
+    }
+  }
+  if (prompt) {
+    std::cout << std::endl;
+  }
+  return succeeded;
+}
+
+namespace {
+
+// Whether a line read after a block still belongs to it: it is indented, or
+// is the `elif` or `else` of an `if`.
+bool continuesBlock(const std::string& line) {
+  auto startsWith = [&](const char* keyword, std::size_t length) {
+    return line.compare(0, length, keyword) == 0 &&
+           (line.size() == length ||
+            !(std::isalnum(static_cast<unsigned char>(line[length])) ||
+              line[length] == '_'));
+  };
+  return line[0] == ' ' || line[0] == '\t' || startsWith("elif", 4) ||
+         startsWith("else", 4);
+}
+
+}  // namespace
+
+// An input is one line, or a line ending in a colon followed by the lines
+// of its block. At a prompt the block ends at an empty line; otherwise it
+// goes on up to the first line that does not continue it, which is kept for
+// the next input. Empty lines and `run`, which ends a program elsewhere, are
+// skipped.
+bool Repl::read(std::istream& in, std::string& text, bool prompt) {
+  text.clear();
+  std::string line;
+  while (true) {
+    if (prompt) {
+      std::cout << (text.empty() ? ">>> " : "... ") << std::flush;
+    }
+    if (!pending.empty()) {
+      line = std::move(pending);
+      pending.clear();
+    } else if (!std::getline(in, line)) {
+      return !text.empty();
+    }
+    std::size_t end = line.find_last_not_of(" \t\r");
+    if (text.empty()) {
+      if (end == std::string::npos || line.substr(0, end + 1) == "run") {
+        continue;
+      }
+      text = line + '\n';
+      if (line[end] != ':') {
+        return true;
+      }
+    } else if (end == std::string::npos) {
+      if (prompt) {
+        return true;
+      }
+    } else if (prompt || continuesBlock(line)) {
+      text += line + '\n';
+    } else {
+      pending = std::move(line);
+      return true;
+    }
+  }
+}
@@ -0,0 +1,189 @@
+#include "resolver.h"
+
+Resolver::Resolver(AST& ast) : ast(ast), globals(nullptr) {}
+
+Resolver::Resolver(AST& ast, const Globals& globals)
+    : ast(ast), globals(&globals) {}
+
+void Resolver::resolve() {
+  if (ast.isResolved()) {
+    return;
+  }
+  if (globals != nullptr) {
+    declareGlobals();
+  }
+  NodeId root = ast.getRoot();
+  for (const NodeId* child = ast.beginChildren(root);
+       child != ast.endChildren(root); child++) {
+    resolveStatement(*child);
+  }
+  ast.setResolved();
+}
+
+const std::vector<bool>& Resolver::getAssigned() const {
+  return assigned;
+}
+
+// Only the globals the program mentions are named in its AST; the others
+// share an empty name. Their number still fixes the slots of the program's
+// own variables.
+void Resolver::declareGlobals() {
+  std::uint32_t nameCount = ast.getNameCount();
+  std::uint32_t count = static_cast<std::uint32_t>(globals->types.size());
+  std::vector<std::uint32_t> nameOfSlot(count, ast.addName(""));
+  slotOfName.assign(nameCount, NO_SLOT);
+  for (std::uint32_t nameId = 0; nameId < nameCount; nameId++) {
+    auto it = globals->slots.find(ast.getName(nameId));
+    if (it != globals->slots.end()) {
+      nameOfSlot[it->second] = nameId;
+      slotOfName[nameId] = it->second;
+    }
+  }
+  ast.setGlobals(std::move(nameOfSlot), globals->types);
+  assigned = globals->assigned;
+}
+
+void Resolver::resolveStatement(NodeId node) {
+  switch (ast[node].type) {
+    case NodeType::VarDeclaration: {
+      bool hasValue = ast[node].childCount > 2;
+      if (hasValue) {
+        resolveExpression(ast.getChild(node, 2));
+      }
+      std::uint32_t slot = bindDeclaration(ast.getChild(node, 1));
+      assigned[slot] = hasValue;
+      break;
+    }
+    case NodeType::Assignment: {
+      resolveExpression(ast.getChild(node, 1));
+      std::uint32_t slot = bindUse(ast.getChild(node, 0), false);
+      assigned[slot] = true;
+      break;
+    }
+    case NodeType::PrintStatement:
+      resolveExpression(ast.getChild(node, 0));
+      break;
+    case NodeType::IfStatement:
+      resolveIfStatement(node);
+      break;
+    case NodeType::WhileStatement:
+      resolveWhileStatement(node);
+      break;
+    default:
+      throw std::runtime_error("Unknown statement type.");
+  }
+}
+
+void Resolver::resolveStatementList(NodeId node) {
+  for (const NodeId* child = ast.beginChildren(node);
+       child != ast.endChildren(node); child++) {
+    resolveStatement(*child);
+  }
+}
+
+void Resolver::resolveIfStatement(NodeId node) {
+  // A variable counts as assigned after the if only when every branch
+  // assigns it. Without an else, skipping all branches is one more path.
+  std::vector<bool> before;
+  std::vector<bool> merged;
+  bool hasElse = false;
+
+  resolveExpression(ast.getChild(node, 0));
+  before = assigned;
+  resolveStatementList(ast.getChild(node, 1));
+  merged = assigned;
+
+  for (std::uint32_t i = 2; i < ast[node].childCount; i++) {
+    NodeId child = ast.getChild(node, i);
+    restoreAssigned(before);
+    if (ast[child].type == NodeType::ElifStatement) {
+      resolveExpression(ast.getChild(child, 0));
+      before = assigned;
+      resolveStatementList(ast.getChild(child, 1));
+    } else {
+      hasElse = true;
+      resolveStatementList(ast.getChild(child, 0));
+    }
+    mergeAssigned(merged);
+  }
+
+  if (!hasElse) {
+    restoreAssigned(before);
+    mergeAssigned(merged);
+  }
+  restoreAssigned(merged);
+}
+
+void Resolver::resolveWhileStatement(NodeId node) {
+  // The body may run zero times, so nothing it assigns is known afterwards.
+  resolveExpression(ast.getChild(node, 0));
+  std::vector<bool> before = assigned;
+  resolveStatementList(ast.getChild(node, 1));
+  restoreAssigned(before);
+}
+
+void Resolver::resolveExpression(NodeId node) {
+  switch (ast[node].type) {
+    case NodeType::Identifier:
+      bindUse(node, true);
+      break;
+    case NodeType::Literal:
+    case NodeType::StringLiteral:
+    case NodeType::Operator:
+    case NodeType::Comparator:
+      break;
+    default:
+      for (const NodeId* child = ast.beginChildren(node);
+           child != ast.endChildren(node); child++) {
+        resolveExpression(*child);
+      }
+      break;
+  }
+}
+
+std::uint32_t Resolver::bindDeclaration(NodeId identifier) {
+  std::uint32_t nameId = ast[identifier].value;
+  if (nameId >= slotOfName.size()) {
+    slotOfName.resize(nameId + 1, NO_SLOT);
+  }
+  // There is no block scope: declaring a name again reuses its slot.
+  if (slotOfName[nameId] == NO_SLOT) {
+    slotOfName[nameId] = ast.addSlot(nameId);
+    assigned.resize(ast.getSlotCount(), false);
+  }
+  ast[identifier].value = slotOfName[nameId];
+  return slotOfName[nameId];
+}
+
+std::uint32_t Resolver::bindUse(NodeId identifier, bool isRead) {
+  std::uint32_t nameId = ast[identifier].value;
+  if (nameId >= slotOfName.size() || slotOfName[nameId] == NO_SLOT) {
+    fail(identifier, "Variable not declared: " + ast.getName(nameId));
+  }
+  std::uint32_t slot = slotOfName[nameId];
+  if (isRead && !assigned[slot]) {
+    fail(identifier, "Variable used before assignment: " + ast.getName(nameId));
+  }
+  ast[identifier].value = slot;
+  return slot;
+}
+
+// Slots declared since the state was saved start out unassigned.
+void Resolver::restoreAssigned(const std::vector<bool>& state) {
+  assigned = state;
+  assigned.resize(ast.getSlotCount(), false);
+}
+
+void Resolver::mergeAssigned(std::vector<bool>& merged) const {
+  merged.resize(assigned.size(), false);
+  for (std::size_t slot = 0; slot < merged.size(); slot++) {
+    merged[slot] = merged[slot] && assigned[slot];
+  }
+}
+
+void Resolver::fail(NodeId node, const std::string& details) const {
+  Position posStart = ast.getPosition(node);
+  int length = static_cast<int>(ast.getName(ast[node].value).size());
+  Position posEnd(posStart.getIndex() + length, posStart.getSource());
+  throw SemanticError(posStart, posEnd, details);
+}
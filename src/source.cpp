@@ -0,0 +1,150 @@
+#include "source.h"
+#include <algorithm>
+#include <fstream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define SOURCE_HAS_MMAP 1
+#endif
+
+Source::Source(Private, std::string text, std::string name)
+    : text(std::move(text)),
+      data(this->text.data()),
+      length(this->text.size()),
+      mapping(nullptr),
+      name(std::move(name)) {}
+
+Source::Source(Private,
+               const char* mapping,
+               std::size_t mappingSize,
+               std::string name)
+    : data(mapping),
+      length(mappingSize),
+      mapping(mapping),
+      name(std::move(name)) {}
+
+Source::~Source() {
+#ifdef SOURCE_HAS_MMAP
+  if (mapping != nullptr) {
+    munmap(const_cast<char*>(mapping), length);
+  }
+#endif
+}
+
+std::shared_ptr<const Source> Source::fromString(std::string text,
+                                                 const std::string& name) {
+  return std::make_shared<const Source>(Private(), std::move(text), name);
+}
+
+std::shared_ptr<const Source> Source::fromStream(std::istream& stream,
+                                                 const std::string& name) {
+  std::string text;
+  char buffer[64 * 1024];
+  while (stream.read(buffer, sizeof(buffer)) || stream.gcount() > 0) {
+    text.append(buffer, static_cast<std::size_t>(stream.gcount()));
+  }
+  return fromString(std::move(text), name);
+}
+
+std::shared_ptr<const Source> Source::fromFile(const std::string& path) {
+#ifdef SOURCE_HAS_MMAP
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return nullptr;
+  }
+  struct stat info;
+  if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode)) {
+    std::size_t fileSize = static_cast<std::size_t>(info.st_size);
+    if (fileSize == 0) {
+      close(fd);
+      return fromString("", path);
+    }
+
+    void* mapped = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapped != MAP_FAILED) {
+      close(fd);
+      madvise(mapped, fileSize, MADV_SEQUENTIAL);
+      return std::make_shared<const Source>(
+          Private(), static_cast<const char*>(mapped), fileSize, path);
+    }
+
+    // Mapping is not available everywhere; read the file in one go instead.
+    std::string text(fileSize, '\0');
+    std::size_t done = 0;
+    while (done < fileSize) {
+      ssize_t count = read(fd, &text[done], fileSize - done);
+      if (count <= 0) {
+        break;
+      }
+      done += static_cast<std::size_t>(count);
+    }
+    close(fd);
+    text.resize(done);
+    return fromString(std::move(text), path);
+  }
+  close(fd);
+#endif
+
+  // Pipes, devices and the like are read as a stream.
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    return nullptr;
+  }
+  return fromStream(file, path);
+}
+
+const std::string& Source::getName() const {
+  return name;
+}
+
+std::string_view Source::getText() const {
+  return std::string_view(data, length);
+}
+
+std::string_view Source::getText(int start, int end) const {
+  int size = static_cast<int>(length);
+  start = std::clamp(start, 0, size);
+  end = std::clamp(end, start, size);
+  return std::string_view(data + start, end - start);
+}
+
+std::size_t Source::size() const {
+  return length;
+}
+
+const std::vector<int>& Source::getLineStarts() const {
+  std::call_once(lineIndexFlag, [this]() {
+    lineStarts.push_back(0);
+    for (std::size_t i = 0; i < length; i++) {
+      if (data[i] == '\n') {
+        lineStarts.push_back(static_cast<int>(i + 1));
+      }
+    }
+  });
+  return lineStarts;
+}
+
+int Source::lineOf(int index) const {
+  const std::vector<int>& starts = getLineStarts();
+  auto it = std::upper_bound(starts.begin(), starts.end(), index);
+  return (it == starts.begin()) ? 0 : static_cast<int>(it - starts.begin()) - 1;
+}
+
+int Source::columnOf(int index) const {
+  return index - getLineStarts()[lineOf(index)];
+}
+
+std::string_view Source::lineText(int line) const {
+  const std::vector<int>& starts = getLineStarts();
+  if (line < 0 || line >= static_cast<int>(starts.size())) {
+    return {};
+  }
+  int start = starts[line];
+  int end = (line + 1 < static_cast<int>(starts.size()))
+                ? starts[line + 1] - 1
+                : static_cast<int>(length);
+  return getText(start, end);
+}
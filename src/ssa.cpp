@@ -0,0 +1,641 @@
+#include "ssa.h"
+#include <cstring>
+#include <stdexcept>
+#include "arithmetic.h"
+#include "folder.h"
+
+namespace {
+
+std::int32_t intOf(const IRValue& value) {
+  return static_cast<std::int32_t>(value.bits);
+}
+
+double floatOf(const IRValue& value) {
+  double number;
+  std::memcpy(&number, &value.bits, sizeof(number));
+  return number;
+}
+
+std::uint64_t bitsOf(std::int32_t value) {
+  return static_cast<std::uint32_t>(value);
+}
+
+std::uint64_t bitsOf(double value) {
+  std::uint64_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+const IROp binaryOps[] = {IROp::Add, IROp::Subtract, IROp::Multiply,
+                          IROp::Divide};
+const IROp comparisonOps[] = {IROp::Less, IROp::Greater, IROp::Equal,
+                              IROp::NotEqual};
+
+}  // namespace
+
+SSAOptimizer::SSAOptimizer(AST& ast)
+    : ast(ast),
+      rewriting(false),
+      block(0),
+      reads(nullptr),
+      mayFail(false) {}
+
+const IRProgram& SSAOptimizer::build() {
+  run(false);
+  return ir;
+}
+
+const IRProgram& SSAOptimizer::optimize() {
+  run(true);
+  // Propagated constants may decide conditions now, and fewer paths merge
+  // once the folder has removed the branches they decide.
+  ConstantFolder(ast).fold();
+  run(true);
+  removeDeadStores();
+  return ir;
+}
+
+void SSAOptimizer::run(bool rewrite) {
+  if (!ast.isResolved()) {
+    throw std::runtime_error("AST has not been resolved");
+  }
+  rewriting = rewrite;
+  ir = IRProgram();
+  definitions.clear();
+  roots.clear();
+  constants.clear();
+  numbering.clear();
+  scope.clear();
+  holders.clear();
+
+  std::uint32_t slotCount = ast.getSlotCount();
+  current.assign(slotCount, IR_NONE);
+  values.assign(slotCount, IR_NONE);
+  undefined.assign(slotCount, IR_NONE);
+  for (std::uint32_t slot = 0; slot < slotCount; slot++) {
+    undefined[slot] =
+        addValue(IROp::Undefined, ast.getSlotType(slot), slot, {});
+    values[slot] = undefined[slot];
+  }
+
+  block = addBlock();
+  visitStatementList(ast.getRoot());
+}
+
+void SSAOptimizer::removeDeadStores() {
+  std::vector<bool> live(definitions.size(), false);
+  std::vector<DefId> worklist = roots;
+  for (DefId def = 0; def < definitions.size(); def++) {
+    if (definitions[def].mayFail) {
+      worklist.push_back(def);
+    }
+  }
+  while (!worklist.empty()) {
+    DefId def = worklist.back();
+    worklist.pop_back();
+    if (def == IR_NONE || live[def]) {
+      continue;
+    }
+    live[def] = true;
+    worklist.insert(worklist.end(), definitions[def].uses.begin(),
+                    definitions[def].uses.end());
+  }
+
+  for (DefId def = 0; def < definitions.size(); def++) {
+    const Definition& definition = definitions[def];
+    if (live[def] || definition.statement == IR_NONE) {
+      continue;
+    }
+    ASTNode& statement = ast[definition.statement];
+    if (statement.type == NodeType::VarDeclaration) {
+      statement.childCount = 2;
+    } else {
+      statement.type = NodeType::StatementList;
+      statement.childCount = 0;
+    }
+    ir.blocks[definition.block].code[definition.index].removed = true;
+  }
+}
+
+void SSAOptimizer::visitStatement(NodeId node) {
+  switch (ast[node].type) {
+    case NodeType::VarDeclaration:
+      if (ast[node].childCount > 2) {
+        visitStore(node, ast.getChild(node, 1), ast.getChild(node, 2));
+      }
+      break;
+    case NodeType::Assignment:
+      visitStore(node, ast.getChild(node, 0), ast.getChild(node, 1));
+      break;
+    case NodeType::PrintStatement: {
+      NodeId child = ast.getChild(node, 0);
+      if (ast[child].type == NodeType::StringLiteral) {
+        emit(IRKind::PrintString, IR_NONE, ast[child].value);
+      } else {
+        reads = &roots;
+        emit(IRKind::Print, visitExpression(child));
+      }
+      break;
+    }
+    case NodeType::IfStatement:
+      visitIfStatement(node);
+      break;
+    case NodeType::WhileStatement:
+      visitWhileStatement(node);
+      break;
+    case NodeType::StatementList:
+      visitStatementList(node);
+      break;
+    default:
+      throw std::runtime_error("Unexpected statement type");
+  }
+}
+
+void SSAOptimizer::visitStatementList(NodeId node) {
+  for (std::uint32_t i = 0; i < ast[node].childCount; i++) {
+    visitStatement(ast.getChild(node, i));
+  }
+}
+
+void SSAOptimizer::visitIfStatement(NodeId node) {
+  struct Path {
+    std::vector<ValueId> values;
+    std::vector<DefId> definitions;
+    std::uint32_t block;
+  };
+
+  const std::vector<ValueId> entryValues = values;
+  const std::vector<DefId> entryDefinitions = current;
+  std::vector<Path> paths;
+  // Only the first condition is computed in a block dominating the merge.
+  std::size_t mark = 0;
+
+  bool hasElse = false;
+  for (std::uint32_t i = 1; i < ast[node].childCount; i++) {
+    NodeId clause = (i == 1) ? node : ast.getChild(node, i);
+    if (ast[clause].type == NodeType::ElseStatement) {
+      visitStatementList(ast.getChild(clause, 0));
+      paths.push_back({values, current, block});
+      hasElse = true;
+      break;
+    }
+
+    reads = &roots;
+    NodeId condition = ast.getChild(clause, 0);
+    NodeId body = ast.getChild(clause, 1);
+    ValueId truth = visitCondition(condition);
+    if (i == 1) {
+      mark = scope.size();
+    }
+    std::uint32_t test = block;
+    std::size_t branch = emit(IRKind::Branch, truth);
+
+    block = addBlock();
+    ir.blocks[block].predecessors.push_back(test);
+    ir.blocks[test].code[branch].targets[0] = block;
+    std::size_t bodyMark = scope.size();
+    visitStatementList(body);
+    paths.push_back({values, current, block});
+    popScope(bodyMark);
+    values = entryValues;
+    current = entryDefinitions;
+
+    block = addBlock();
+    ir.blocks[block].predecessors.push_back(test);
+    ir.blocks[test].code[branch].targets[1] = block;
+  }
+  if (!hasElse) {
+    paths.push_back({values, current, block});
+  }
+  popScope(mark);
+
+  std::uint32_t merge = addBlock();
+  for (const Path& path : paths) {
+    block = path.block;
+    jump(merge);
+  }
+  block = merge;
+
+  for (std::uint32_t slot = 0; slot < values.size(); slot++) {
+    std::vector<ValueId> operands;
+    bool same = true;
+    for (const Path& path : paths) {
+      operands.push_back(ir.resolve(path.values[slot]));
+      same = same && operands.back() == operands.front();
+    }
+    if (same) {
+      values[slot] = operands.front();
+    } else {
+      values[slot] = addValue(IROp::Phi, ast.getSlotType(slot), slot,
+                              std::move(operands));
+      emit(IRKind::Value, values[slot]);
+    }
+
+    std::vector<DefId> uses;
+    same = true;
+    for (const Path& path : paths) {
+      uses.push_back(path.definitions[slot]);
+      same = same && uses.back() == uses.front();
+    }
+    current[slot] = same ? uses.front() : addMerge(std::move(uses));
+  }
+}
+
+void SSAOptimizer::visitWhileStatement(NodeId node) {
+  NodeId condition = ast.getChild(node, 0);
+  NodeId body = ast.getChild(node, 1);
+  std::vector<bool> assigned(values.size(), false);
+  collectAssigned(body, assigned);
+
+  std::uint32_t header = addBlock();
+  jump(header);
+  block = header;
+  std::vector<ValueId> phis(values.size(), IR_NONE);
+  std::vector<DefId> merges(values.size(), IR_NONE);
+  for (std::uint32_t slot = 0; slot < values.size(); slot++) {
+    if (assigned[slot]) {
+      phis[slot] = addValue(IROp::Phi, ast.getSlotType(slot), slot,
+                            {ir.resolve(values[slot])});
+      emit(IRKind::Value, phis[slot]);
+      values[slot] = phis[slot];
+      merges[slot] = addMerge({current[slot]});
+      current[slot] = merges[slot];
+    }
+  }
+
+  reads = &roots;
+  ValueId truth = visitCondition(condition);
+  std::size_t branch = emit(IRKind::Branch, truth);
+  block = addBlock();
+  ir.blocks[block].predecessors.push_back(header);
+  ir.blocks[header].code[branch].targets[0] = block;
+
+  std::size_t mark = scope.size();
+  visitStatementList(body);
+  popScope(mark);
+  jump(header);
+  for (std::uint32_t slot = 0; slot < values.size(); slot++) {
+    if (assigned[slot]) {
+      ir.values[phis[slot]].operands.push_back(ir.resolve(values[slot]));
+      definitions[merges[slot]].uses.push_back(current[slot]);
+      values[slot] = phis[slot];
+      current[slot] = merges[slot];
+    }
+  }
+
+  // A phi is redundant when all of its operands, apart from itself, are one
+  // value; forwarding one may make another redundant.
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (ValueId phi : phis) {
+      if (phi == IR_NONE || ir.values[phi].replacement != phi) {
+        continue;
+      }
+      ValueId same = IR_NONE;
+      bool trivial = true;
+      for (ValueId operand : ir.values[phi].operands) {
+        operand = ir.resolve(operand);
+        if (operand == phi || operand == same) {
+          continue;
+        }
+        if (same != IR_NONE) {
+          trivial = false;
+          break;
+        }
+        same = operand;
+      }
+      if (trivial && same != IR_NONE) {
+        ir.values[phi].replacement = same;
+        changed = true;
+      }
+    }
+  }
+
+  block = addBlock();
+  ir.blocks[block].predecessors.push_back(header);
+  ir.blocks[header].code[branch].targets[1] = block;
+}
+
+void SSAOptimizer::visitStore(NodeId statement,
+                              NodeId identifier,
+                              NodeId expression) {
+  std::vector<DefId> uses;
+  reads = &uses;
+  mayFail = false;
+  ValueId value = visitExpression(expression);
+
+  std::uint32_t slot = ast[identifier].value;
+  DefId def = static_cast<DefId>(definitions.size());
+  std::size_t index = emit(IRKind::Store, value, slot);
+  definitions.push_back({statement, block, static_cast<std::uint32_t>(index),
+                         std::move(uses), mayFail});
+  values[slot] = value;
+  current[slot] = def;
+  if (!ir.isConstant(value)) {
+    holders[value].push_back(slot);
+  }
+}
+
+ValueId SSAOptimizer::visitCondition(NodeId node) {
+  ValueId left = visitExpression(ast.getChild(node, 0));
+  ValueId right = visitExpression(ast.getChild(node, 2));
+  Comparator comparator =
+      static_cast<Comparator>(ast[ast.getChild(node, 1)].op);
+  return operation(comparisonOps[static_cast<int>(comparator)],
+                   ast[node].dataType, {left, right});
+}
+
+ValueId SSAOptimizer::visitExpression(NodeId node) {
+  DataType type = ast[node].dataType;
+  std::size_t readCount = reads->size();
+  bool couldFail = mayFail;
+  ValueId value;
+  switch (ast[node].type) {
+    case NodeType::Literal:
+      if (type == DataType::Float) {
+        return constant(type, bitsOf(ast.getFloat(ast[node].value)));
+      }
+      return constant(type, ast[node].value);
+    case NodeType::Identifier: {
+      std::uint32_t slot = ast[node].value;
+      if (current[slot] != IR_NONE) {
+        reads->push_back(current[slot]);
+      }
+      value = ir.resolve(values[slot]);
+      break;
+    }
+    case NodeType::UnaryMinus:
+      value = operation(IROp::Negate, type,
+                        {visitExpression(ast.getChild(node, 0))});
+      break;
+    case NodeType::Convert:
+      value = operation(
+          type == DataType::Float ? IROp::IntToFloat : IROp::FloatToInt, type,
+          {visitExpression(ast.getChild(node, 0))});
+      break;
+    case NodeType::Expression:
+    case NodeType::Term:
+      value = visitExpression(ast.getChild(node, 0));
+      for (std::uint32_t i = 1; i < ast[node].childCount; i += 2) {
+        Operator op = static_cast<Operator>(ast[ast.getChild(node, i)].op);
+        ValueId right = visitExpression(ast.getChild(node, i + 1));
+        value = operation(binaryOps[static_cast<int>(op)], type,
+                          {value, right});
+      }
+      break;
+    default:
+      throw std::runtime_error("Unexpected expression type");
+  }
+  // A rewritten node no longer reads or computes what it did.
+  if (rewriting && rewrite(node, value)) {
+    reads->resize(readCount);
+    mayFail = couldFail;
+    if (ast[node].type == NodeType::Identifier &&
+        current[ast[node].value] != IR_NONE) {
+      reads->push_back(current[ast[node].value]);
+    }
+  }
+  return value;
+}
+
+bool SSAOptimizer::rewrite(NodeId node, ValueId value) {
+  const IRValue& known = ir.values[value];
+  if (known.op == IROp::Constant) {
+    ASTNode& literal = ast[node];
+    literal.type = NodeType::Literal;
+    literal.op = static_cast<std::uint8_t>(known.type);
+    literal.childCount = 0;
+    literal.value = known.type == DataType::Float
+                        ? ast.addFloat(floatOf(known))
+                        : static_cast<std::uint32_t>(known.bits);
+    return true;
+  }
+
+  auto found = holders.find(value);
+  if (found == holders.end()) {
+    return false;
+  }
+  for (std::uint32_t slot : found->second) {
+    if (ir.resolve(values[slot]) == value) {
+      ASTNode& identifier = ast[node];
+      if (identifier.type == NodeType::Identifier && identifier.value == slot) {
+        return false;
+      }
+      identifier.type = NodeType::Identifier;
+      identifier.childCount = 0;
+      identifier.value = slot;
+      return true;
+    }
+  }
+  return false;
+}
+
+void SSAOptimizer::collectAssigned(NodeId node,
+                                   std::vector<bool>& assigned) const {
+  switch (ast[node].type) {
+    case NodeType::VarDeclaration:
+      if (ast[node].childCount > 2) {
+        assigned[ast[ast.getChild(node, 1)].value] = true;
+      }
+      break;
+    case NodeType::Assignment:
+      assigned[ast[ast.getChild(node, 0)].value] = true;
+      break;
+    case NodeType::IfStatement:
+    case NodeType::ElifStatement:
+    case NodeType::ElseStatement:
+    case NodeType::WhileStatement:
+    case NodeType::StatementList:
+      for (const NodeId* child = ast.beginChildren(node);
+           child != ast.endChildren(node); child++) {
+        collectAssigned(*child, assigned);
+      }
+      break;
+    default:
+      break;
+  }
+}
+
+ValueId SSAOptimizer::constant(DataType type, std::uint64_t bits) {
+  auto found = constants.find({type, bits});
+  if (found != constants.end()) {
+    return found->second;
+  }
+  ValueId value = addValue(IROp::Constant, type, IR_NONE, {});
+  ir.values[value].bits = bits;
+  constants.emplace(std::make_pair(type, bits), value);
+  return value;
+}
+
+ValueId SSAOptimizer::operation(IROp op,
+                                DataType type,
+                                std::vector<ValueId> operands) {
+  for (ValueId& operand : operands) {
+    operand = ir.resolve(operand);
+  }
+  ValueId result;
+  if (fold(op, type, operands, result)) {
+    return result;
+  }
+  if (op == IROp::Divide) {
+    const IRValue& divisor = ir.values[operands[1]];
+    mayFail = mayFail || divisor.op != IROp::Constant || divisor.bits == 0 ||
+              (type == DataType::Float && floatOf(divisor) == 0);
+  }
+
+  std::vector<std::uint32_t> key = {static_cast<std::uint32_t>(op),
+                                    static_cast<std::uint32_t>(type)};
+  key.insert(key.end(), operands.begin(), operands.end());
+  auto found = numbering.find(key);
+  if (found != numbering.end()) {
+    return found->second;
+  }
+  result = addValue(op, type, IR_NONE, std::move(operands));
+  emit(IRKind::Value, result);
+  numbering.emplace(key, result);
+  scope.push_back(std::move(key));
+  return result;
+}
+
+bool SSAOptimizer::fold(IROp op,
+                        DataType type,
+                        const std::vector<ValueId>& operands,
+                        ValueId& result) {
+  for (ValueId operand : operands) {
+    if (ir.values[operand].op != IROp::Constant) {
+      return false;
+    }
+  }
+  const IRValue& left = ir.values[operands[0]];
+
+  if (operands.size() == 1) {
+    switch (op) {
+      case IROp::Negate:
+        result = type == DataType::Float
+                     ? constant(type, bitsOf(arithmetic::negate(floatOf(left))))
+                     : constant(type, bitsOf(arithmetic::negate(intOf(left))));
+        return true;
+      case IROp::IntToFloat:
+        result = constant(type, bitsOf(arithmetic::toFloat(intOf(left))));
+        return true;
+      case IROp::FloatToInt:
+        result = constant(type, bitsOf(arithmetic::toInt(floatOf(left))));
+        return true;
+      default:
+        return false;
+    }
+  }
+
+  const IRValue& right = ir.values[operands[1]];
+  if (type == DataType::Float) {
+    double a = floatOf(left);
+    double b = floatOf(right);
+    switch (op) {
+      case IROp::Add:
+        result = constant(type, bitsOf(arithmetic::add(a, b)));
+        return true;
+      case IROp::Subtract:
+        result = constant(type, bitsOf(arithmetic::subtract(a, b)));
+        return true;
+      case IROp::Multiply:
+        result = constant(type, bitsOf(arithmetic::multiply(a, b)));
+        return true;
+      case IROp::Divide:
+        if (b == 0) {
+          return false;
+        }
+        result = constant(type, bitsOf(arithmetic::divide(a, b)));
+        return true;
+      case IROp::Less:
+        result = constant(DataType::Int, a < b);
+        return true;
+      case IROp::Greater:
+        result = constant(DataType::Int, a > b);
+        return true;
+      case IROp::Equal:
+        result = constant(DataType::Int, a == b);
+        return true;
+      case IROp::NotEqual:
+        result = constant(DataType::Int, a != b);
+        return true;
+      default:
+        return false;
+    }
+  }
+
+  std::int32_t a = intOf(left);
+  std::int32_t b = intOf(right);
+  switch (op) {
+    case IROp::Add:
+      result = constant(type, bitsOf(arithmetic::add(a, b)));
+      return true;
+    case IROp::Subtract:
+      result = constant(type, bitsOf(arithmetic::subtract(a, b)));
+      return true;
+    case IROp::Multiply:
+      result = constant(type, bitsOf(arithmetic::multiply(a, b)));
+      return true;
+    case IROp::Divide:
+      if (b == 0) {
+        return false;
+      }
+      result = constant(type, bitsOf(arithmetic::divide(a, b)));
+      return true;
+    case IROp::Less:
+      result = constant(type, a < b);
+      return true;
+    case IROp::Greater:
+      result = constant(type, a > b);
+      return true;
+    case IROp::Equal:
+      result = constant(type, a == b);
+      return true;
+    case IROp::NotEqual:
+      result = constant(type, a != b);
+      return true;
+    default:
+      return false;
+  }
+}
+
+ValueId SSAOptimizer::addValue(IROp op,
+                               DataType type,
+                               std::uint32_t slot,
+                               std::vector<ValueId> operands) {
+  ValueId value = static_cast<ValueId>(ir.values.size());
+  ir.values.push_back({op, type, slot, 0, std::move(operands), value});
+  return value;
+}
+
+SSAOptimizer::DefId SSAOptimizer::addMerge(std::vector<DefId> uses) {
+  DefId def = static_cast<DefId>(definitions.size());
+  definitions.push_back({IR_NONE, block, 0, std::move(uses), false});
+  return def;
+}
+
+void SSAOptimizer::popScope(std::size_t mark) {
+  while (scope.size() > mark) {
+    numbering.erase(scope.back());
+    scope.pop_back();
+  }
+}
+
+std::uint32_t SSAOptimizer::addBlock() {
+  ir.blocks.emplace_back();
+  return static_cast<std::uint32_t>(ir.blocks.size() - 1);
+}
+
+std::size_t SSAOptimizer::emit(IRKind kind,
+                               ValueId value,
+                               std::uint32_t operand) {
+  std::vector<IRInstruction>& code = ir.blocks[block].code;
+  code.push_back({kind, value, operand, {IR_NONE, IR_NONE}, false});
+  return code.size() - 1;
+}
+
+void SSAOptimizer::jump(std::uint32_t target) {
+  std::size_t index = emit(IRKind::Jump, IR_NONE);
+  ir.blocks[block].code[index].targets[0] = target;
+  ir.blocks[target].predecessors.push_back(block);
+}
@@ -0,0 +1,430 @@
+#include "sweep.h"
+#include <charconv>
+#include <stdexcept>
+#include <unordered_map>
+#include "arithmetic.h"
+#include "error.h"
+
+namespace {
+
+std::string trim(const std::string& text) {
+  std::size_t start = text.find_first_not_of(" \t\r");
+  if (start == std::string::npos) {
+    return "";
+  }
+  return text.substr(start, text.find_last_not_of(" \t\r") - start + 1);
+}
+
+std::vector<std::string> splitFields(const std::string& line) {
+  std::vector<std::string> fields;
+  std::size_t start = 0;
+  while (true) {
+    std::size_t comma = line.find(',', start);
+    fields.push_back(trim(line.substr(start, comma - start)));
+    if (comma == std::string::npos) {
+      return fields;
+    }
+    start = comma + 1;
+  }
+}
+
+template <typename T>
+bool parseNumber(const std::string& text, T& value) {
+  const char* end = text.data() + text.size();
+  auto result = std::from_chars(text.data(), end, value);
+  return result.ec == std::errc() && result.ptr == end && !text.empty();
+}
+
+}  // namespace
+
+bool SweepInputs::read(std::istream& csv,
+                       const AST& ast,
+                       SweepInputs& inputs,
+                       std::string& error) {
+  std::unordered_map<std::string, std::uint32_t> declared;
+  for (const NodeId* child = ast.beginChildren(ast.getRoot());
+       child != ast.endChildren(ast.getRoot()); child++) {
+    if (ast[*child].type == NodeType::VarDeclaration) {
+      std::uint32_t slot = ast[ast.getChild(*child, 1)].value;
+      declared.emplace(ast.getSlotName(slot), slot);
+    }
+  }
+
+  std::vector<std::string> names;
+  std::string line;
+  for (std::size_t lineNumber = 1; std::getline(csv, line); lineNumber++) {
+    if (trim(line).empty()) {
+      continue;
+    }
+    std::vector<std::string> fields = splitFields(line);
+    if (names.empty()) {
+      for (const std::string& name : fields) {
+        auto it = declared.find(name);
+        if (it == declared.end()) {
+          error = "Not a top-level variable: '" + name + "'";
+          return false;
+        }
+        for (std::uint32_t slot : inputs.slots) {
+          if (slot == it->second) {
+            error = "Variable given twice: '" + name + "'";
+            return false;
+          }
+        }
+        inputs.slots.push_back(it->second);
+      }
+      names = std::move(fields);
+      continue;
+    }
+
+    if (fields.size() != names.size()) {
+      error = "Expected " + std::to_string(names.size()) + " values on line " +
+              std::to_string(lineNumber);
+      return false;
+    }
+    std::vector<Value> row(fields.size());
+    for (std::size_t column = 0; column < fields.size(); column++) {
+      bool parsed = ast.getSlotType(inputs.slots[column]) == DataType::Float
+                        ? parseNumber(fields[column], row[column].f)
+                        : parseNumber(fields[column], row[column].i);
+      if (!parsed) {
+        error = "Invalid value for '" + names[column] + "' on line " +
+                std::to_string(lineNumber) + ": '" + fields[column] + "'";
+        return false;
+      }
+    }
+    inputs.rows.push_back(std::move(row));
+  }
+  if (names.empty()) {
+    error = "Missing header row";
+    return false;
+  }
+  return true;
+}
+
+LaneInterpreter::LaneInterpreter(const AST& ast, const SweepInputs& inputs)
+    : ast(ast), inputs(inputs), columns(ast.getSlotCount(), -1), first(0) {
+  for (std::size_t column = 0; column < inputs.slots.size(); column++) {
+    columns[inputs.slots[column]] = static_cast<int>(column);
+  }
+}
+
+template <>
+Lanes<std::int32_t>& LaneInterpreter::variable<std::int32_t>(
+    std::uint32_t slot) {
+  return ints[slot];
+}
+
+template <>
+Lanes<double>& LaneInterpreter::variable<double>(std::uint32_t slot) {
+  return floats[slot];
+}
+
+template <>
+Lanes<std::int32_t> LaneInterpreter::visitLiteral<std::int32_t>(NodeId node) {
+  return lanes::broadcast(static_cast<std::int32_t>(ast[node].value));
+}
+
+template <>
+Lanes<double> LaneInterpreter::visitLiteral<double>(NodeId node) {
+  return lanes::broadcast(ast.getFloat(ast[node].value));
+}
+
+template <>
+Lanes<std::int32_t> LaneInterpreter::visitConvert<std::int32_t>(NodeId node) {
+  return lanes::toInt(visit<double>(ast.getChild(node, 0)));
+}
+
+template <>
+Lanes<double> LaneInterpreter::visitConvert<double>(NodeId node) {
+  return lanes::toFloat(visit<std::int32_t>(ast.getChild(node, 0)));
+}
+
+void LaneInterpreter::run(std::size_t first) {
+  if (!ast.isResolved()) {
+    throw std::runtime_error("AST has not been resolved");
+  }
+  this->first = first;
+  ints.assign(ast.getSlotCount(), lanes::broadcast<std::int32_t>(0));
+  floats.assign(ast.getSlotCount(), lanes::broadcast(0.0));
+  failed = lanes::broadcast<std::int32_t>(0);
+  for (std::size_t lane = 0; lane < LANES; lane++) {
+    active.v[lane] = first + lane < inputs.rows.size() ? -1 : 0;
+    outputs[lane].str("");
+    errors[lane].clear();
+  }
+
+  NodeId root = ast.getRoot();
+  if (ast.size() == 0 || ast[root].type != NodeType::Program) {
+    throw std::runtime_error("Invalid AST");
+  }
+  for (const NodeId* child = ast.beginChildren(root);
+       child != ast.endChildren(root); child++) {
+    if (ast[*child].type == NodeType::VarDeclaration &&
+        columns[ast[ast.getChild(*child, 1)].value] >= 0) {
+      executeInput(*child);
+    } else {
+      executeStatement(*child);
+    }
+  }
+}
+
+std::string LaneInterpreter::getOutput(std::size_t lane) const {
+  return outputs[lane].str();
+}
+
+const std::string& LaneInterpreter::getError(std::size_t lane) const {
+  return errors[lane];
+}
+
+Mask LaneInterpreter::live() const {
+  return lanes::without(active, failed);
+}
+
+void LaneInterpreter::fail(std::size_t lane, NodeId node) {
+  Position position = ast.getPosition(node);
+  errors[lane] =
+      RuntimeError(position, position, "Division by zero.").asString();
+  failed.v[lane] = -1;
+}
+
+void LaneInterpreter::executeStatement(NodeId node) {
+  switch (ast[node].type) {
+    case NodeType::VarDeclaration:
+      if (ast[node].childCount > 2) {
+        store(ast.getChild(node, 1), ast.getChild(node, 2));
+      }
+      break;
+    case NodeType::Assignment:
+      store(ast.getChild(node, 0), ast.getChild(node, 1));
+      break;
+    case NodeType::PrintStatement:
+      visitPrintStatement(node);
+      break;
+    case NodeType::IfStatement:
+      executeIfStatement(node);
+      break;
+    case NodeType::WhileStatement:
+      executeWhileStatement(node);
+      break;
+    case NodeType::StatementList:
+      executeStatementList(node);
+      break;
+    default:
+      throw std::runtime_error("Unknown statement type.");
+  }
+}
+
+void LaneInterpreter::executeStatementList(NodeId node) {
+  for (const NodeId* child = ast.beginChildren(node);
+       child != ast.endChildren(node) && lanes::any(live()); child++) {
+    executeStatement(*child);
+  }
+}
+
+void LaneInterpreter::executeInput(NodeId node) {
+  std::uint32_t slot = ast[ast.getChild(node, 1)].value;
+  std::size_t column = static_cast<std::size_t>(columns[slot]);
+  Mask mask = live();
+  for (std::size_t lane = 0; lane < LANES; lane++) {
+    if (mask.v[lane] == 0) {
+      continue;
+    }
+    const Value& value = inputs.rows[first + lane][column];
+    if (ast.getSlotType(slot) == DataType::Float) {
+      floats[slot].v[lane] = value.f;
+    } else {
+      ints[slot].v[lane] = value.i;
+    }
+  }
+}
+
+// Each clause runs for the instances whose conditions so far were all false
+// and whose own condition is true.
+void LaneInterpreter::executeIfStatement(NodeId node) {
+  Mask entry = active;
+  Mask remaining = live();
+  for (std::uint32_t i = 1; i < ast[node].childCount && lanes::any(remaining);
+       i++) {
+    NodeId clause = (i == 1) ? node : ast.getChild(node, i);
+    active = remaining;
+    if (ast[clause].type == NodeType::ElseStatement) {
+      executeStatementList(ast.getChild(clause, 0));
+      break;
+    }
+    Mask taken =
+        lanes::both(evaluateCondition(ast.getChild(clause, 0)), live());
+    remaining = lanes::without(live(), taken);
+    if (lanes::any(taken)) {
+      active = taken;
+      executeStatementList(ast.getChild(clause, 1));
+    }
+  }
+  active = entry;
+}
+
+// Instances leave the loop as their condition turns false; it ends once
+// none is left.
+void LaneInterpreter::executeWhileStatement(NodeId node) {
+  Mask entry = active;
+  NodeId condition = ast.getChild(node, 0);
+  NodeId body = ast.getChild(node, 1);
+  while (true) {
+    Mask running = lanes::both(evaluateCondition(condition), live());
+    if (!lanes::any(running)) {
+      break;
+    }
+    active = running;
+    executeStatementList(body);
+  }
+  active = entry;
+}
+
+void LaneInterpreter::store(NodeId identifier, NodeId expression) {
+  std::uint32_t slot = ast[identifier].value;
+  if (ast[identifier].dataType == DataType::Float) {
+    Lanes<double> value = visit<double>(expression);
+    floats[slot] = lanes::select(live(), value, floats[slot]);
+  } else {
+    Lanes<std::int32_t> value = visit<std::int32_t>(expression);
+    ints[slot] = lanes::select(live(), value, ints[slot]);
+  }
+}
+
+// Evaluate first, so a failing expression prints nothing.
+void LaneInterpreter::visitPrintStatement(NodeId node) {
+  NodeId child = ast.getChild(node, 0);
+  if (ast[child].type == NodeType::StringLiteral) {
+    Mask mask = live();
+    for (std::size_t lane = 0; lane < LANES; lane++) {
+      if (mask.v[lane] != 0) {
+        outputs[lane] << "> " << ast.getString(ast[child].value) << '\n';
+      }
+    }
+  } else if (ast[child].dataType == DataType::Float) {
+    Lanes<double> value = visit<double>(child);
+    Mask mask = live();
+    for (std::size_t lane = 0; lane < LANES; lane++) {
+      if (mask.v[lane] != 0) {
+        outputs[lane] << "> " << value.v[lane] << '\n';
+      }
+    }
+  } else {
+    Lanes<std::int32_t> value = visit<std::int32_t>(child);
+    Mask mask = live();
+    for (std::size_t lane = 0; lane < LANES; lane++) {
+      if (mask.v[lane] != 0) {
+        outputs[lane] << "> " << value.v[lane] << '\n';
+      }
+    }
+  }
+}
+
+Mask LaneInterpreter::evaluateCondition(NodeId node) {
+  if (ast[node].dataType == DataType::Float) {
+    return compare<double>(node);
+  }
+  return compare<std::int32_t>(node);
+}
+
+template <typename T>
+Mask LaneInterpreter::compare(NodeId node) {
+  Lanes<T> left = visit<T>(ast.getChild(node, 0));
+  Lanes<T> right = visit<T>(ast.getChild(node, 2));
+  switch (static_cast<Comparator>(ast[ast.getChild(node, 1)].op)) {
+    case Comparator::Less:
+      return lanes::less(left, right);
+    case Comparator::Greater:
+      return lanes::greater(left, right);
+    case Comparator::Equal:
+      return lanes::equal(left, right);
+    case Comparator::NotEqual:
+      return lanes::notEqual(left, right);
+  }
+  throw std::runtime_error("Invalid comparator in comparison.");
+}
+
+template <typename T>
+Lanes<T> LaneInterpreter::visit(NodeId node) {
+  switch (ast[node].type) {
+    case NodeType::Identifier:
+      return variable<T>(ast[node].value);
+    case NodeType::Expression:
+      return visitExpression<T>(node);
+    case NodeType::Term:
+      return visitTerm<T>(node);
+    case NodeType::Literal:
+      return visitLiteral<T>(node);
+    case NodeType::UnaryMinus:
+      return lanes::negate(visit<T>(ast.getChild(node, 0)));
+    case NodeType::Convert:
+      return visitConvert<T>(node);
+    default:
+      throw std::runtime_error("Unknown node type.");
+  }
+}
+
+template <typename T>
+Lanes<T> LaneInterpreter::visitExpression(NodeId node) {
+  Lanes<T> result = visit<T>(ast.getChild(node, 0));
+  for (std::uint32_t i = 1; i < ast[node].childCount; i += 2) {
+    Operator op = static_cast<Operator>(ast[ast.getChild(node, i)].op);
+    Lanes<T> right = visit<T>(ast.getChild(node, i + 1));
+    if (op == Operator::Add) {
+      result = lanes::add(result, right);
+    } else if (op == Operator::Subtract) {
+      result = lanes::subtract(result, right);
+    }
+  }
+  return result;
+}
+
+template <typename T>
+Lanes<T> LaneInterpreter::visitTerm(NodeId node) {
+  Lanes<T> result = visit<T>(ast.getChild(node, 0));
+  for (std::uint32_t i = 1; i < ast[node].childCount; i += 2) {
+    NodeId opNode = ast.getChild(node, i);
+    Operator op = static_cast<Operator>(ast[opNode].op);
+    Lanes<T> right = visit<T>(ast.getChild(node, i + 1));
+    if (op == Operator::Multiply) {
+      result = lanes::multiply(result, right);
+    } else if (op == Operator::Divide) {
+      result = divide(result, right, opNode);
+    }
+  }
+  return result;
+}
+
+// No instruction set here divides ints, so int division goes lane by lane.
+Lanes<std::int32_t> LaneInterpreter::divide(const Lanes<std::int32_t>& left,
+                                            const Lanes<std::int32_t>& right,
+                                            NodeId node) {
+  Mask mask = live();
+  Lanes<std::int32_t> result;
+  for (std::size_t lane = 0; lane < LANES; lane++) {
+    if (right.v[lane] != 0) {
+      result.v[lane] = arithmetic::divide(left.v[lane], right.v[lane]);
+    } else {
+      if (mask.v[lane] != 0) {
+        fail(lane, node);
+      }
+      result.v[lane] = 0;
+    }
+  }
+  return result;
+}
+
+Lanes<double> LaneInterpreter::divide(const Lanes<double>& left,
+                                      const Lanes<double>& right,
+                                      NodeId node) {
+  Lanes<double> zero = lanes::broadcast(0.0);
+  Mask byZero = lanes::equal(right, zero);
+  if (lanes::any(byZero)) {
+    Mask failing = lanes::both(byZero, live());
+    for (std::size_t lane = 0; lane < LANES; lane++) {
+      if (failing.v[lane] != 0) {
+        fail(lane, node);
+      }
+    }
+  }
+  return lanes::select(byZero, zero, lanes::divide(left, right));
+}
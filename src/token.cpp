@@ -2,33 +2,26 @@
 #include "position.h"
 
 Token::Token(TokenType type,
-             const std::string& value,
              const Position& posStart,
-             const Position& posEnd)
-    : type(type),
-      value(value),
-      tokenName(tokenNames[type]),
-      posStart(posStart),
-      posEnd(posEnd) {}
-
-std::map<TokenType, std::string> Token::tokenNames = {
-    {TOKEN_KEYWORD, "TOKEN_KEYWORD"},
-    {TOKEN_PARENTHESIS, "TOKEN_PARENTHESIS"},
-    {TOKEN_COLON, "TOKEN_COLON"},
-    {TOKEN_IDENTIFIER, "TOKEN_IDENTIFIER"},
-    {TOKEN_INTEGER, "TOKEN_INTEGER"},
-    {TOKEN_OPERATOR, "TOKEN_OPERATOR"},
-    {TOKEN_COMPARATOR, "TOKEN_COMPARATOR"},
-    {TOKEN_INTEGER, "TOKEN_INTEGER"},
-    {TOKEN_FLOAT, "TOKEN_FLOAT"},
-    {TOKEN_NEWLINE, "TOKEN_NEWLINE"},
-    {TOKEN_STRING, "TOKEN_STRING"},
-    {TOKEN_INDENT, "TOKEN_INDENT"},
-    {TOKEN_EOF, "TOKEN_EOF"}};
+             const Position& posEnd,
+             std::uint32_t id)
+    : type(type), id(id), posStart(posStart), posEnd(posEnd) {}
+
+const char* Token::getTypeName(TokenType type) {
+  static const char* const tokenNames[] = {
+      "TOKEN_KEYWORD",     "TOKEN_OPERATOR", "TOKEN_COMPARATOR",
+      "TOKEN_IDENTIFIER",  "TOKEN_INTEGER",  "TOKEN_FLOAT",
+      "TOKEN_PARENTHESIS", "TOKEN_COLON",    "TOKEN_NEWLINE",
+      "TOKEN_INVALID",     "TOKEN_STRING",   "TOKEN_INDENT",
+      "TOKEN_EOF"};
+  return tokenNames[type];
+}
 
 std::string Token::asString() const {
-  return "Token(" + tokenName + ", '" + value + "' ln:col " +
-         std::to_string(posStart.getLine()) + ":" +
+  std::string value =
+      (type == TOKEN_NEWLINE) ? "\\n" : std::string(getValue());
+  return std::string("Token(") + getTypeName(type) + ", '" + value +
+         "' ln:col " + std::to_string(posStart.getLine()) + ":" +
          std::to_string(posStart.getCol()) + " " +
          std::to_string(posEnd.getLine()) + ":" +
          std::to_string(posEnd.getCol()) + ")";
@@ -38,8 +31,20 @@ TokenType Token::getType() const {
   return type;
 }
 
-const std::string& Token::getValue() const {
-  return value;
+std::uint32_t Token::getId() const {
+  return id;
+}
+
+std::string_view Token::getValue() const {
+  const Source* source = posStart.getSource();
+  if (source == nullptr) {
+    return {};
+  }
+  if (type == TOKEN_STRING) {
+    // Leave out the surrounding quotes.
+    return source->getText(posStart.getIndex() + 1, posEnd.getIndex() - 1);
+  }
+  return source->getText(posStart.getIndex(), posEnd.getIndex());
 }
 
 const Position& Token::getPosStart() const {
@@ -50,23 +55,68 @@ const Position& Token::getPosEnd() const {
   return posEnd;
 }
 
-Position::Position(int index, int line, int column, std::string inputText)
-    : index(index), line(line), column(column), inputText(inputText) {}
+TokenBuffer::TokenBuffer(const Source* source) : source(source) {}
 
-Position Position::advance(char currentChar) {
-  index++;
-  column++;
+void TokenBuffer::push(TokenType type,
+                       std::uint32_t offset,
+                       std::uint32_t length,
+                       std::uint32_t id) {
+  types.push_back(type);
+  offsets.push_back(offset);
+  lengths.push_back(length);
+  ids.push_back(id);
+}
 
-  if (currentChar == '\n') {
-    line++;
-    column = 0;
-  }
+void TokenBuffer::clear() {
+  types.clear();
+  offsets.clear();
+  lengths.clear();
+  ids.clear();
+}
+
+void TokenBuffer::reserve(std::size_t count) {
+  types.reserve(count);
+  offsets.reserve(count);
+  lengths.reserve(count);
+  ids.reserve(count);
+}
+
+std::size_t TokenBuffer::size() const {
+  return types.size();
+}
 
+TokenType TokenBuffer::getType(std::size_t i) const {
+  return types[i];
+}
+
+std::uint32_t TokenBuffer::getOffset(std::size_t i) const {
+  return offsets[i];
+}
+
+std::uint32_t TokenBuffer::getLength(std::size_t i) const {
+  return lengths[i];
+}
+
+std::uint32_t TokenBuffer::getId(std::size_t i) const {
+  return ids[i];
+}
+
+Token TokenBuffer::get(std::size_t i) const {
+  int start = static_cast<int>(offsets[i]);
+  return {types[i], Position(start, source),
+          Position(start + static_cast<int>(lengths[i]), source), ids[i]};
+}
+
+Position::Position(int index, const Source* source)
+    : index(index), source(source) {}
+
+Position Position::advance() {
+  index++;
   return *this;
 }
 
 Position Position::copy() {
-  return Position(index, line, column, inputText);
+  return Position(index, source);
 }
 
 int Position::getIndex() const {
@@ -74,13 +124,13 @@ int Position::getIndex() const {
 }
 
 int Position::getLine() const {
-  return line;
+  return (source != nullptr) ? source->lineOf(index) : 0;
 }
 
 int Position::getCol() const {
-  return column;
+  return (source != nullptr) ? source->columnOf(index) : index;
 }
 
-const std::string& Position::getInputText() const {
-  return inputText;
+const Source* Position::getSource() const {
+  return source;
 }
@@ -0,0 +1,147 @@
+#include "typechecker.h"
+#include <algorithm>
+#include <stdexcept>
+
+TypeChecker::TypeChecker(AST& ast) : ast(ast) {}
+
+void TypeChecker::check() {
+  if (!ast.isResolved()) {
+    throw std::runtime_error("AST has not been resolved");
+  }
+  declared.assign(ast.getSlotCount(), false);
+  std::fill_n(declared.begin(), ast.getGlobalCount(), true);
+  checkStatementList(ast.getRoot());
+}
+
+void TypeChecker::checkStatement(NodeId node) {
+  switch (ast[node].type) {
+    case NodeType::VarDeclaration: {
+      DataType type = static_cast<DataType>(ast[ast.getChild(node, 0)].op);
+      NodeId identifier = ast.getChild(node, 1);
+      std::uint32_t slot = ast[identifier].value;
+      if (ast[node].childCount > 2) {  // Check for expression
+        checkExpression(ast.getChild(node, 2));
+      }
+      if (declared[slot] && ast.getSlotType(slot) != type) {
+        fail(identifier, "Variable redeclared with a different type: " +
+                             ast.getSlotName(slot));
+      }
+      declared[slot] = true;
+      ast.setSlotType(slot, type);
+      ast[identifier].dataType = type;
+      if (ast[node].childCount > 2) {
+        convert(ast.getChild(node, 2), type);
+      }
+      break;
+    }
+    case NodeType::Assignment: {
+      NodeId identifier = ast.getChild(node, 0);
+      DataType type = ast.getSlotType(ast[identifier].value);
+      ast[identifier].dataType = type;
+      checkExpression(ast.getChild(node, 1));
+      convert(ast.getChild(node, 1), type);
+      break;
+    }
+    case NodeType::PrintStatement:
+      if (ast[ast.getChild(node, 0)].type != NodeType::StringLiteral) {
+        checkExpression(ast.getChild(node, 0));
+      }
+      break;
+    case NodeType::IfStatement:
+      checkCondition(ast.getChild(node, 0));
+      checkStatementList(ast.getChild(node, 1));
+      for (std::uint32_t i = 2; i < ast[node].childCount; i++) {
+        NodeId child = ast.getChild(node, i);
+        if (ast[child].type == NodeType::ElifStatement) {
+          checkCondition(ast.getChild(child, 0));
+          checkStatementList(ast.getChild(child, 1));
+        } else {
+          checkStatementList(ast.getChild(child, 0));
+        }
+      }
+      break;
+    case NodeType::WhileStatement:
+      checkCondition(ast.getChild(node, 0));
+      checkStatementList(ast.getChild(node, 1));
+      break;
+    case NodeType::StatementList:
+      checkStatementList(node);
+      break;
+    default:
+      throw std::runtime_error("Unknown statement type.");
+  }
+}
+
+void TypeChecker::checkStatementList(NodeId node) {
+  // Inserting conversions appends to the AST's arrays, so children are
+  // visited by index rather than through pointers into them.
+  for (std::uint32_t i = 0; i < ast[node].childCount; i++) {
+    checkStatement(ast.getChild(node, i));
+  }
+}
+
+// Both sides of a comparison are compared as floats unless both are ints.
+void TypeChecker::checkCondition(NodeId node) {
+  DataType left = checkExpression(ast.getChild(node, 0));
+  DataType right = checkExpression(ast.getChild(node, 2));
+  DataType type = (left == DataType::Float || right == DataType::Float)
+                      ? DataType::Float
+                      : DataType::Int;
+  convert(ast.getChild(node, 0), type);
+  convert(ast.getChild(node, 2), type);
+  ast[node].dataType = type;
+}
+
+DataType TypeChecker::checkExpression(NodeId node) {
+  DataType type = DataType::Int;
+  switch (ast[node].type) {
+    case NodeType::Literal:
+      type = static_cast<DataType>(ast[node].op);
+      break;
+    case NodeType::Identifier:
+      type = ast.getSlotType(ast[node].value);
+      break;
+    case NodeType::UnaryMinus:
+      type = checkExpression(ast.getChild(node, 0));
+      break;
+    case NodeType::Expression:
+    case NodeType::Term:
+      for (std::uint32_t i = 0; i < ast[node].childCount; i += 2) {
+        if (checkExpression(ast.getChild(node, i)) == DataType::Float) {
+          type = DataType::Float;
+        }
+      }
+      for (std::uint32_t i = 0; i < ast[node].childCount; i += 2) {
+        convert(ast.getChild(node, i), type);
+      }
+      break;
+    case NodeType::Convert:
+      type = ast[node].dataType;
+      break;
+    default:
+      throw std::runtime_error("Invalid node type in expression.");
+  }
+  ast[node].dataType = type;
+  return type;
+}
+
+// Turns the node into a Convert of a copy of itself, so that whatever
+// refers to the node now sees the converted value.
+void TypeChecker::convert(NodeId node, DataType type) {
+  if (ast[node].dataType == type) {
+    return;
+  }
+  NodeId operand = ast.copyNode(node);
+  ast.setChildren(node, &operand, 1);
+  ast[node].type = NodeType::Convert;
+  ast[node].op = 0;
+  ast[node].dataType = type;
+  ast[node].value = 0;
+}
+
+void TypeChecker::fail(NodeId node, const std::string& details) const {
+  Position posStart = ast.getPosition(node);
+  int length = static_cast<int>(ast.getIdentifierName(node).size());
+  Position posEnd(posStart.getIndex() + length, posStart.getSource());
+  throw SemanticError(posStart, posEnd, details);
+}
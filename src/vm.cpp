@@ -0,0 +1,304 @@
+#include "vm.h"
+#include <iostream>
+#include "arithmetic.h"
+
+VM::VM(Output& out) : out(out), threadedId(0) {}
+
+int VM::interpret(const Chunk& chunk) {
+  variables.assign(chunk.slotCount, Value{});
+  run(chunk, variables.data());
+  return 0;
+}
+
+void VM::run(const Chunk& chunk, Value* variables) {
+  stack.resize(chunk.maxStack + 1);
+  Value* sp = stack.data();
+#ifdef VM_COUNT_DISPATCH
+  std::uint64_t dispatched = 0;
+#define COUNT_DISPATCH() dispatched++
+#else
+#define COUNT_DISPATCH()
+#endif
+
+#ifdef VM_THREADED_DISPATCH
+  // Direct threading: every instruction is rewritten to carry the address of
+  // its handler, and each handler jumps straight to the next one.
+  static const void* const handlers[] = {
+      &&op_Constant,      &&op_ConstantFloat, &&op_Load,
+      &&op_Store,         &&op_Add,           &&op_Subtract,
+      &&op_Multiply,      &&op_Divide,        &&op_Negate,
+      &&op_AddFloat,      &&op_SubtractFloat, &&op_MultiplyFloat,
+      &&op_DivideFloat,   &&op_NegateFloat,   &&op_IntToFloat,
+      &&op_FloatToInt,    &&op_Less,          &&op_Greater,
+      &&op_Equal,         &&op_NotEqual,      &&op_LessFloat,
+      &&op_GreaterFloat,  &&op_EqualFloat,    &&op_NotEqualFloat,
+      &&op_TripCountLess, &&op_TripCountGreater,
+      &&op_TripCountEqual, &&op_TripCountNotEqual,
+      &&op_BranchLess,    &&op_BranchGreater, &&op_BranchEqual,
+      &&op_BranchNotEqual, &&op_BranchLessConstant,
+      &&op_BranchGreaterConstant, &&op_BranchEqualConstant,
+      &&op_BranchNotEqualConstant, &&op_AddConstant,
+      &&op_SubtractConstant,
+      &&op_Jump,          &&op_JumpIfFalse,   &&op_Print,
+      &&op_PrintFloat,    &&op_PrintString,   &&op_Native,
+      &&op_Halt};
+  static_assert(sizeof(handlers) / sizeof(handlers[0]) ==
+                    static_cast<std::size_t>(OpCode::Halt) + 1,
+                "every OpCode needs a handler");
+
+  // The rewritten code is kept for running the same chunk again.
+  if (threadedId != chunk.id.get()) {
+    threaded.resize(chunk.code.size());
+    for (std::size_t i = 0; i < chunk.code.size(); i++) {
+      threaded[i] = {handlers[static_cast<int>(chunk.code[i].op)],
+                     chunk.code[i].operand};
+    }
+    threadedId = chunk.id.get();
+  }
+  const ThreadedInstruction* code = threaded.data();
+  const ThreadedInstruction* ip = code;
+  const ThreadedInstruction* instruction;
+
+#define CASE(name) op_##name:
+#define DISPATCH()              \
+  do {                          \
+    COUNT_DISPATCH();           \
+    instruction = ip++;         \
+    goto *instruction->handler; \
+  } while (0)
+
+  DISPATCH();
+#else
+  const Instruction* code = chunk.code.data();
+  const Instruction* ip = code;
+  const Instruction* instruction;
+
+#define CASE(name) case OpCode::name:
+#define DISPATCH() break
+
+  while (true) {
+    COUNT_DISPATCH();
+    instruction = ip++;
+    switch (instruction->op) {
+#endif
+      CASE(Constant)
+        (sp++)->i = instruction->operand;
+        DISPATCH();
+      CASE(ConstantFloat)
+        (sp++)->f = chunk.floats[instruction->operand];
+        DISPATCH();
+      CASE(Load)
+        *sp++ = variables[instruction->operand];
+        DISPATCH();
+      CASE(Store)
+        variables[instruction->operand] = *--sp;
+        DISPATCH();
+      CASE(Add)
+        sp--;
+        sp[-1].i = arithmetic::add(sp[-1].i, sp[0].i);
+        DISPATCH();
+      CASE(Subtract)
+        sp--;
+        sp[-1].i = arithmetic::subtract(sp[-1].i, sp[0].i);
+        DISPATCH();
+      CASE(Multiply)
+        sp--;
+        sp[-1].i = arithmetic::multiply(sp[-1].i, sp[0].i);
+        DISPATCH();
+      CASE(Divide)
+        sp--;
+        if (sp[0].i == 0) {
+          fail(chunk, instruction - code, "Division by zero.");
+        }
+        sp[-1].i = arithmetic::divide(sp[-1].i, sp[0].i);
+        DISPATCH();
+      CASE(Negate)
+        sp[-1].i = arithmetic::negate(sp[-1].i);
+        DISPATCH();
+      CASE(AddFloat)
+        sp--;
+        sp[-1].f = arithmetic::add(sp[-1].f, sp[0].f);
+        DISPATCH();
+      CASE(SubtractFloat)
+        sp--;
+        sp[-1].f = arithmetic::subtract(sp[-1].f, sp[0].f);
+        DISPATCH();
+      CASE(MultiplyFloat)
+        sp--;
+        sp[-1].f = arithmetic::multiply(sp[-1].f, sp[0].f);
+        DISPATCH();
+      CASE(DivideFloat)
+        sp--;
+        if (sp[0].f == 0) {
+          fail(chunk, instruction - code, "Division by zero.");
+        }
+        sp[-1].f = arithmetic::divide(sp[-1].f, sp[0].f);
+        DISPATCH();
+      CASE(NegateFloat)
+        sp[-1].f = arithmetic::negate(sp[-1].f);
+        DISPATCH();
+      CASE(IntToFloat)
+        sp[-1].f = arithmetic::toFloat(sp[-1].i);
+        DISPATCH();
+      CASE(FloatToInt)
+        sp[-1].i = arithmetic::toInt(sp[-1].f);
+        DISPATCH();
+      CASE(Less)
+        sp--;
+        sp[-1].i = sp[-1].i < sp[0].i;
+        DISPATCH();
+      CASE(Greater)
+        sp--;
+        sp[-1].i = sp[-1].i > sp[0].i;
+        DISPATCH();
+      CASE(Equal)
+        sp--;
+        sp[-1].i = sp[-1].i == sp[0].i;
+        DISPATCH();
+      CASE(NotEqual)
+        sp--;
+        sp[-1].i = sp[-1].i != sp[0].i;
+        DISPATCH();
+      CASE(LessFloat)
+        sp--;
+        sp[-1].i = sp[-1].f < sp[0].f;
+        DISPATCH();
+      CASE(GreaterFloat)
+        sp--;
+        sp[-1].i = sp[-1].f > sp[0].f;
+        DISPATCH();
+      CASE(EqualFloat)
+        sp--;
+        sp[-1].i = sp[-1].f == sp[0].f;
+        DISPATCH();
+      CASE(NotEqualFloat)
+        sp--;
+        sp[-1].i = sp[-1].f != sp[0].f;
+        DISPATCH();
+      CASE(TripCountLess)
+        sp--;
+        sp[-1].i =
+            arithmetic::tripCountLess(sp[-1].i, sp[0].i, instruction->operand);
+        DISPATCH();
+      CASE(TripCountGreater)
+        sp--;
+        sp[-1].i = arithmetic::tripCountGreater(sp[-1].i, sp[0].i,
+                                                instruction->operand);
+        DISPATCH();
+      CASE(TripCountEqual)
+        sp--;
+        sp[-1].i = arithmetic::tripCountEqual(sp[-1].i, sp[0].i,
+                                              instruction->operand);
+        DISPATCH();
+      CASE(TripCountNotEqual)
+        sp--;
+        sp[-1].i = arithmetic::tripCountNotEqual(sp[-1].i, sp[0].i,
+                                                 instruction->operand);
+        DISPATCH();
+      // The fused instructions follow as operands: ip[0] is the second
+      // Load or the Constant, ip[2] the JumpIfFalse or Store.
+      CASE(BranchLess)
+        ip = variables[instruction->operand].i < variables[ip[0].operand].i
+                 ? ip + 3
+                 : code + ip[2].operand;
+        DISPATCH();
+      CASE(BranchGreater)
+        ip = variables[instruction->operand].i > variables[ip[0].operand].i
+                 ? ip + 3
+                 : code + ip[2].operand;
+        DISPATCH();
+      CASE(BranchEqual)
+        ip = variables[instruction->operand].i == variables[ip[0].operand].i
+                 ? ip + 3
+                 : code + ip[2].operand;
+        DISPATCH();
+      CASE(BranchNotEqual)
+        ip = variables[instruction->operand].i != variables[ip[0].operand].i
+                 ? ip + 3
+                 : code + ip[2].operand;
+        DISPATCH();
+      CASE(BranchLessConstant)
+        ip = variables[instruction->operand].i < ip[0].operand
+                 ? ip + 3
+                 : code + ip[2].operand;
+        DISPATCH();
+      CASE(BranchGreaterConstant)
+        ip = variables[instruction->operand].i > ip[0].operand
+                 ? ip + 3
+                 : code + ip[2].operand;
+        DISPATCH();
+      CASE(BranchEqualConstant)
+        ip = variables[instruction->operand].i == ip[0].operand
+                 ? ip + 3
+                 : code + ip[2].operand;
+        DISPATCH();
+      CASE(BranchNotEqualConstant)
+        ip = variables[instruction->operand].i != ip[0].operand
+                 ? ip + 3
+                 : code + ip[2].operand;
+        DISPATCH();
+      CASE(AddConstant)
+        variables[ip[2].operand].i =
+            arithmetic::add(variables[instruction->operand].i, ip[0].operand);
+        ip += 3;
+        DISPATCH();
+      CASE(SubtractConstant)
+        variables[ip[2].operand].i = arithmetic::subtract(
+            variables[instruction->operand].i, ip[0].operand);
+        ip += 3;
+        DISPATCH();
+      CASE(Jump)
+        ip = code + instruction->operand;
+        DISPATCH();
+      CASE(JumpIfFalse)
+        if ((--sp)->i == 0) {
+          ip = code + instruction->operand;
+        }
+        DISPATCH();
+      CASE(Print)
+        out.printInt((--sp)->i);
+        DISPATCH();
+      CASE(PrintFloat)
+        out.printFloat((--sp)->f);
+        DISPATCH();
+      CASE(PrintString)
+        out.printString(chunk.strings[instruction->operand]);
+        DISPATCH();
+      CASE(Native) {
+        const NativeLoop& loop = chunk.natives[instruction->operand];
+        std::int32_t failed = loop.entry(variables);
+        if (failed >= 0) {
+          fail(chunk, failed, "Division by zero.");
+        }
+        ip = code + loop.exit;
+        DISPATCH();
+      }
+      CASE(Halt)
+#ifdef VM_COUNT_DISPATCH
+        std::cerr << "dispatched " << dispatched << " instructions"
+                  << std::endl;
+#endif
+        return;
+#ifndef VM_THREADED_DISPATCH
+    }
+  }
+#endif
+#undef CASE
+#undef DISPATCH
+#undef COUNT_DISPATCH
+}
+
+const char* VM::getDispatchName() {
+#ifdef VM_THREADED_DISPATCH
+  return "threaded";
+#else
+  return "switch";
+#endif
+}
+
+void VM::fail(const Chunk& chunk,
+              std::size_t pc,
+              const std::string& details) const {
+  Position position(static_cast<int>(chunk.positions[pc]), chunk.source.get());
+  throw RuntimeError(position, position, details);
+}
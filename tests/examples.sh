@@ -0,0 +1,67 @@
+#!/usr/bin/env bash
+# Runs every example under each engine, with and without the loop
+# optimizer, and checks that its output is that of the tree interpreter
+# with all optimizations off. The examples are also run from a --cache file
+# after it has been written, and compiled to native executables with
+# --compile when a C compiler is available.
+#
+# Usage: tests/examples.sh [dsl.out]
+#
+# Prints each mismatch as a diff and exits with 1 if there was any.
+set -uo pipefail
+
+cd "$(dirname "$0")/.."
+DSL=${1:-bin/dsl.out}
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+export TERM=dumb
+
+failures=0
+runs=0
+
+# Compares the output in $WORK/actual with $WORK/expected.
+check() {
+  local description=$1
+  runs=$((runs + 1))
+  if ! diff -u "$WORK/expected" "$WORK/actual" >"$WORK/diff"; then
+    echo "FAIL: $description"
+    cat "$WORK/diff"
+    failures=$((failures + 1))
+  fi
+}
+
+for example in examples/*.dsl; do
+  "$DSL" --engine=tree --no-loop-opt --no-ssa-opt "$example" \
+    </dev/null >"$WORK/expected" 2>&1
+
+  for engine in tree vm jit tiered; do
+    for loops in "" --no-loop-opt; do
+      "$DSL" --engine=$engine $loops "$example" \
+        </dev/null >"$WORK/actual" 2>&1
+      check "$example --engine=$engine $loops"
+    done
+  done
+
+  # The first run writes the cache and the second one runs from it.
+  rm -f "$WORK/cache.dslc"
+  for pass in write read; do
+    "$DSL" --engine=vm --cache="$WORK/cache.dslc" "$example" \
+      </dev/null >"$WORK/actual" 2>&1
+    check "$example --cache ($pass)"
+  done
+
+  if command -v "${CC:-cc}" >/dev/null; then
+    # The executable prints no echo of the script, nor does --batch after
+    # its header line.
+    "$DSL" --batch --engine=tree --no-loop-opt --no-ssa-opt "$example" \
+      2>&1 | tail -n +2 >"$WORK/expected"
+    if "$DSL" --compile="$WORK/native" "$example" </dev/null \
+      >"$WORK/actual" 2>&1; then
+      "$WORK/native" >"$WORK/actual" 2>&1
+    fi
+    check "$example --compile"
+  fi
+done
+
+echo "$((runs - failures)) of $runs runs matched"
+[ "$failures" -eq 0 ]